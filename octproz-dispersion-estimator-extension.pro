@@ -1,4 +1,4 @@
-QT += core gui widgets printsupport
+QT += core gui widgets printsupport concurrent
 QMAKE_PROJECT_DEPTH = 0
 
 TARGET = dispersionestimatorextension
@@ -28,26 +28,59 @@ DEFINES += \
 	DISPERSIONESTIMATION_LIBRARY \
 	QT_DEPRECATED_WARNINGS #emit warnings if depracted Qt features are used
 
+#uncomment to enable debug output for every evaluated dispersion candidate
+#DEFINES += DISPERSION_ESTIMATOR_VERBOSE_LOGGING
+
 SOURCES += \
 	src/dispersionestimator.cpp \
 	src/dispersionestimatorform.cpp \
 	src/dispersionestimationengine.cpp\
+	src/framering.cpp \
 	src/thirdparty/qcustomplot/qcustomplot.cpp \
 	src/lineplot.cpp \
+	src/performancedashboard.cpp \
 	src/octprocessor/processor.tpp \
 	src/octprocessor/processorcontroller.cpp\
-	src/ascanmetriccalculator.cpp
+	src/octprocessor/hardwarecounters.cpp \
+	src/octprocessor/allocationtracking.cpp \
+	src/octprocessor/memoryarena.cpp \
+	src/ascanmetriccalculator.cpp \
+	src/neldermeadoptimizer.cpp \
+	src/peakfitter.cpp \
+	src/parallelmetricevaluator.cpp \
+	src/metriccache.cpp \
+	src/ascanselector.cpp \
+	src/lbfgsoptimizer.cpp \
+	src/estimationrunreport.cpp \
+	src/tracerecorder.cpp \
+	src/processmemory.cpp
 
 HEADERS += \
 	src/dispersionestimator.h \
 	src/dispersionestimatorform.h \
 	src/dispersionestimatorparameters.h \
 	src/dispersionestimationengine.h\
+	src/framering.h \
 	src/thirdparty/qcustomplot/qcustomplot.h \
 	src/lineplot.h \
+	src/performancedashboard.h \
 	src/octprocessor/processor.h \
 	src/octprocessor/processorcontroller.h\
-	src/ascanmetriccalculator.h
+	src/octprocessor/stagetimings.h \
+	src/octprocessor/spectrumview.h \
+	src/octprocessor/hardwarecounters.h \
+	src/octprocessor/allocationtracking.h \
+	src/octprocessor/memoryarena.h \
+	src/ascanmetriccalculator.h \
+	src/neldermeadoptimizer.h \
+	src/peakfitter.h \
+	src/parallelmetricevaluator.h \
+	src/metriccache.h \
+	src/ascanselector.h \
+	src/lbfgsoptimizer.h \
+	src/estimationrunreport.h \
+	src/tracerecorder.h \
+	src/processmemory.h
 
 FORMS +=  \
 	src/dispersionestimatorform.ui
@@ -65,7 +98,7 @@ unix{
 	LIBS += -lfftw3
 }
 win32{
-	LIBS += -L$$PWD/src/thirdparty/fftw/ -llibfftw3-3
+	LIBS += -L$$PWD/src/thirdparty/fftw/ -llibfftw3-3 -lpsapi
 	DEPENDPATH += $$PWD/src/thirdparty/fftw
 }
 
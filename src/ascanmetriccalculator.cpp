@@ -63,6 +63,10 @@ float AscanMetricCalculator::calculateMetric(const QVector<float> &outputData, i
 			lineMetric = computeMeanSobel(lineData, validLineSize);
 			break;
 		}
+		case SUM_OF_SQUARED_INTENSITY: {
+			lineMetric = computeSumOfSquaredIntensity(lineData, validLineSize);
+			break;
+		}
 		default:
 		//todo addd more metrics
 			break;
@@ -126,3 +130,14 @@ float AscanMetricCalculator::computeMeanSobel(const float *lineData, int lineSiz
 
 	return (count > 0) ? (sumAbsGradient / count) : 0.0f;
 }
+
+float AscanMetricCalculator::computeSumOfSquaredIntensity(const float *lineData, int lineSize) const
+{
+	// For linear A-scans the samples are amplitudes, the intensity is the squared amplitude
+	float sum = 0.0f;
+	for (int i = 0; i < lineSize; ++i) {
+		float intensity = lineData[i] * lineData[i];
+		sum += intensity * intensity;
+	}
+	return sum;
+}
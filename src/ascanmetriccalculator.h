@@ -20,6 +20,7 @@ private:
 	float computeNumberOfSamplesAboveThreshold(const float *lineData, int lineSize) const;
 	float computePeakValue(const float *lineData, int lineSize) const;
 	float computeMeanSobel(const float *lineData, int lineSize) const;
+	float computeSumOfSquaredIntensity(const float *lineData, int lineSize) const;
 };
 
 #endif // ASCANMETRICCALCULATOR_H
@@ -0,0 +1,188 @@
+#include "ascanselector.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ASCAN_SELECTOR_SSE2
+#endif
+
+namespace {
+#ifdef ASCAN_SELECTOR_SSE2
+float horizontalSum(__m128 v)
+{
+	__m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 sums = _mm_add_ps(v, shuffled);
+	shuffled = _mm_movehl_ps(shuffled, sums);
+	return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+}
+#endif
+
+// background += line, returns the sum of the line
+float accumulateLine(const float* line, float* background, size_t samples)
+{
+	size_t i = 0;
+	float sum = 0.0f;
+#ifdef ASCAN_SELECTOR_SSE2
+	__m128 sums = _mm_setzero_ps();
+	for (; i + 4 <= samples; i += 4) {
+		__m128 x = _mm_loadu_ps(line + i);
+		_mm_storeu_ps(background + i, _mm_add_ps(_mm_loadu_ps(background + i), x));
+		sums = _mm_add_ps(sums, x);
+	}
+	sum = horizontalSum(sums);
+#endif
+	for (; i < samples; ++i) {
+		background[i] += line[i];
+		sum += line[i];
+	}
+	return sum;
+}
+
+// Sum of squares of line - gain * background and number of samples at or beyond the limits of the digitizer range
+float residualEnergy(const float* line, const float* background, float gain, float maxValue, size_t samples, int& clippedSamples)
+{
+	size_t i = 0;
+	float energy = 0.0f;
+	float clipped = 0.0f;
+#ifdef ASCAN_SELECTOR_SSE2
+	const __m128 gains = _mm_set1_ps(gain);
+	const __m128 maxValues = _mm_set1_ps(maxValue);
+	const __m128 zeros = _mm_setzero_ps();
+	const __m128 ones = _mm_set1_ps(1.0f);
+	__m128 energies = _mm_setzero_ps();
+	__m128 clippedCounts = _mm_setzero_ps();
+	for (; i + 4 <= samples; i += 4) {
+		__m128 x = _mm_loadu_ps(line + i);
+		__m128 residual = _mm_sub_ps(x, _mm_mul_ps(gains, _mm_loadu_ps(background + i)));
+		energies = _mm_add_ps(energies, _mm_mul_ps(residual, residual));
+		__m128 isClipped = _mm_or_ps(_mm_cmpge_ps(x, maxValues), _mm_cmple_ps(x, zeros));
+		clippedCounts = _mm_add_ps(clippedCounts, _mm_and_ps(isClipped, ones));
+	}
+	energy = horizontalSum(energies);
+	clipped = horizontalSum(clippedCounts);
+#endif
+	for (; i < samples; ++i) {
+		float residual = line[i] - gain * background[i];
+		energy += residual * residual;
+		clipped += (line[i] >= maxValue || line[i] <= 0.0f) ? 1.0f : 0.0f;
+	}
+	clippedSamples = static_cast<int>(clipped);
+	return energy;
+}
+}
+
+AscanSelector::AscanSelector()
+{
+}
+
+void AscanSelector::measure(const void* frame, size_t lineStrideBytes, size_t samplesPerLine, size_t linesPerFrame, int bitDepth)
+{
+	qualities_.assign(linesPerFrame, LineQuality());
+	if (samplesPerLine == 0 || linesPerFrame == 0) {
+		return;
+	}
+	const char* frameData = static_cast<const char*>(frame);
+	float maxValue = static_cast<float>(bitDepth >= 32 ? 4294967295.0 : std::ldexp(1.0, bitDepth) - 1.0);
+
+	// First pass: average spectrum of the frame (source spectrum and fixed pattern) and mean level of every line
+	background_.assign(samplesPerLine, 0.0f);
+	lineSamples_.resize(samplesPerLine);
+	lineMeans_.resize(linesPerFrame);
+	for (size_t line = 0; line < linesPerFrame; ++line) {
+		convertLine(frameData + line * lineStrideBytes, samplesPerLine, bitDepth, lineSamples_.data());
+		lineMeans_[line] = accumulateLine(lineSamples_.data(), background_.data(), samplesPerLine) / static_cast<float>(samplesPerLine);
+	}
+	double backgroundSum = 0.0;
+	for (float& value : background_) {
+		value /= static_cast<float>(linesPerFrame);
+		backgroundSum += value;
+	}
+	float backgroundMean = static_cast<float>(backgroundSum / static_cast<double>(samplesPerLine));
+
+	// Second pass: the background is scaled to the level of each line, so lines that are only brighter or darker do not count as fringes
+	for (size_t line = 0; line < linesPerFrame; ++line) {
+		convertLine(frameData + line * lineStrideBytes, samplesPerLine, bitDepth, lineSamples_.data());
+		float gain = backgroundMean > 0.0f ? lineMeans_[line] / backgroundMean : 1.0f;
+		LineQuality& quality = qualities_[line];
+		quality.fringeEnergy = residualEnergy(lineSamples_.data(), background_.data(), gain, maxValue, samplesPerLine, quality.clippedSamples)
+				/ static_cast<float>(samplesPerLine);
+		// Amplitude of a cosine fringe with this energy relative to the line level
+		quality.fringeContrast = lineMeans_[line] > 0.0f ? std::sqrt(2.0f * quality.fringeEnergy) / lineMeans_[line] : 0.0f;
+	}
+}
+
+std::vector<size_t> AscanSelector::bestLines(size_t numberOfLines) const
+{
+	std::vector<size_t> lines(qualities_.size());
+	for (size_t i = 0; i < lines.size(); ++i) {
+		lines[i] = i;
+	}
+	numberOfLines = std::min(numberOfLines, lines.size());
+	std::partial_sort(lines.begin(), lines.begin() + numberOfLines, lines.end(), [this](size_t a, size_t b) {
+		const LineQuality& qualityA = qualities_[a];
+		const LineQuality& qualityB = qualities_[b];
+		if (qualityA.clippedSamples != qualityB.clippedSamples) {
+			return qualityA.clippedSamples < qualityB.clippedSamples;
+		}
+		return qualityA.fringeEnergy > qualityB.fringeEnergy;
+	});
+	lines.resize(numberOfLines);
+	std::sort(lines.begin(), lines.end());
+	return lines;
+}
+
+const std::vector<AscanSelector::LineQuality>& AscanSelector::getLineQualities() const
+{
+	return qualities_;
+}
+
+int AscanSelector::countClippedLines() const
+{
+	return static_cast<int>(std::count_if(qualities_.begin(), qualities_.end(), [](const LineQuality& quality) {
+		return quality.clippedSamples > 0;
+	}));
+}
+
+void AscanSelector::convertLine(const char* line, size_t samples, int bitDepth, float* output)
+{
+	size_t i = 0;
+	if (bitDepth <= 8) {
+		const uint8_t* in = reinterpret_cast<const uint8_t*>(line);
+#ifdef ASCAN_SELECTOR_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 16 <= samples; i += 16) {
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+			__m128i low = _mm_unpacklo_epi8(bytes, zero);
+			__m128i high = _mm_unpackhi_epi8(bytes, zero);
+			_mm_storeu_ps(output + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)));
+			_mm_storeu_ps(output + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)));
+			_mm_storeu_ps(output + i + 8, _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)));
+			_mm_storeu_ps(output + i + 12, _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)));
+		}
+#endif
+		for (; i < samples; ++i) {
+			output[i] = static_cast<float>(in[i]);
+		}
+	} else if (bitDepth <= 16) {
+		const uint16_t* in = reinterpret_cast<const uint16_t*>(line);
+#ifdef ASCAN_SELECTOR_SSE2
+		const __m128i zero = _mm_setzero_si128();
+		for (; i + 8 <= samples; i += 8) {
+			__m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+			_mm_storeu_ps(output + i, _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero)));
+			_mm_storeu_ps(output + i + 4, _mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero)));
+		}
+#endif
+		for (; i < samples; ++i) {
+			output[i] = static_cast<float>(in[i]);
+		}
+	} else {
+		// Unsigned 32 bit samples do not fit the signed SSE2 conversion
+		const uint32_t* in = reinterpret_cast<const uint32_t*>(line);
+		for (; i < samples; ++i) {
+			output[i] = static_cast<float>(in[i]);
+		}
+	}
+}
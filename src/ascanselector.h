@@ -0,0 +1,41 @@
+#ifndef ASCANSELECTOR_H
+#define ASCANSELECTOR_H
+
+#include <vector>
+#include <cstddef>
+
+// Ranks the raw spectra (A-scans) of a frame by how much they can contribute to a dispersion estimate. For every line it
+// measures the fringe energy, i.e. the mean squared deviation from the average spectrum of the frame scaled to the level of
+// the line, the number of clipped samples (at the top of the digitizer range or at 0) and the fringe contrast, i.e. the
+// fringe amplitude relative to the mean level of the line. Lines without clipped samples are preferred and ordered by
+// fringe energy, lines with clipped samples are only taken if there are not enough other lines.
+// Samples are read with 1, 2 or 4 bytes like the processor reads them. Not thread-safe.
+class AscanSelector
+{
+public:
+	struct LineQuality {
+		float fringeEnergy;
+		float fringeContrast;
+		int clippedSamples;
+	};
+
+	AscanSelector();
+
+	void measure(const void* frame, size_t lineStrideBytes, size_t samplesPerLine, size_t linesPerFrame, int bitDepth);
+
+	// Indices of the best numberOfLines lines of the last measured frame in ascending order
+	std::vector<size_t> bestLines(size_t numberOfLines) const;
+
+	const std::vector<LineQuality>& getLineQualities() const;
+	int countClippedLines() const;
+
+private:
+	std::vector<float> background_; // average spectrum of the frame
+	std::vector<float> lineSamples_;
+	std::vector<float> lineMeans_;
+	std::vector<LineQuality> qualities_;
+
+	static void convertLine(const char* line, size_t samples, int bitDepth, float* output);
+};
+
+#endif // ASCANSELECTOR_H
@@ -1,136 +1,1226 @@
 #include "dispersionestimationengine.h"
+#include "tracerecorder.h"
+#include "processmemory.h"
+#include "octprocessor/hardwarecounters.h"
 #include <QtMath>
 #include <QDebug>
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+
+// Debug output inside the candidate evaluation loop is only compiled in if DISPERSION_ESTIMATOR_VERBOSE_LOGGING is defined
+#ifdef DISPERSION_ESTIMATOR_VERBOSE_LOGGING
+	#define VERBOSE_DEBUG(message) qDebug() << message
+#else
+	#define VERBOSE_DEBUG(message) do {} while (0)
+#endif
+
+// Minimum time between two progress updates that are sent to the GUI
+#define PROGRESS_UPDATE_INTERVAL_MS 30
+
+// Number of start points per dimension that are evaluated before the gradient-based search
+#define GRADIENT_SEED_GRID_SIZE 3
+
+// Number of candidates that are handed to each worker thread before results are streamed to the GUI
+#define CANDIDATES_PER_THREAD_AND_BATCH 2
+
+// Live tracking: samples per coefficient and window, initial window half width as fraction of the configured range
+// and the relative metric improvement that is needed before new coefficients are sent to OCTproZ
+#define TRACKING_SAMPLES_PER_AXIS 5
+#define TRACKING_INITIAL_WINDOW_FRACTION 0.05
+#define TRACKING_MAX_WINDOW_FRACTION 0.25
+#define TRACKING_HYSTERESIS 0.02
+
+// Coordinate descent: samples per line search
+#define COORDINATE_SAMPLES_PER_LINE 9
+
+// Successive halving: number of candidates that is scored on the full set of A-scans at the end of each sweep
+#define HALVING_MIN_SURVIVORS 3
+// Fixed seed of the A-scan order, so repeated runs on the same frame give the same result
+#define HALVING_ASCAN_ORDER_SEED 20240611u
 
 DispersionEstimationEngine::DispersionEstimationEngine(QObject *parent)
 	: QObject(parent),
-	isPeakFitting(false)
+	isPeakFitting(false),
+	cancellationRequested(0),
+	estimationRunning(0),
+	pooledFrames(1),
+	saturatedAscans(0),
+	hasTrackingStart(false),
+	trackedD2(0),
+	trackedD3(0),
+	trackingWindowD2(0),
+	trackingWindowD3(0),
+	trackingFailing(false),
+	evaluatedCandidates(0),
+	totalCandidates(0)
 {
 	this->processorController = new ProcessorController(this);
+	this->settingsFilePath = SETTINGS_PATH;
+	this->resamplingCurveFilePath = SETTINGS_PATH_RESAMPLING_FILE;
+
+	// The stage timers only read the clock, so they stay enabled for the run report
+	this->processorController->setStageTimingEnabled(true);
+	this->parallelEvaluator.setStageTimingEnabled(true);
 
 	this->bestMetricValueD2 = 0;
 	this->bestD2 = 0;
 	this->bestMetricValueD3 = 0;
 	this->bestD3 = 0;
 	this->calculatedD1 = 0;
+	this->curvatureD2 = 0;
+	this->curvatureD3 = 0;
+}
+
+void DispersionEstimationEngine::requestCancellation() {
+	this->cancellationRequested.storeRelease(1);
+}
+
+bool DispersionEstimationEngine::isEstimationRunning() const {
+	return this->estimationRunning.loadAcquire() != 0;
+}
+
+void DispersionEstimationEngine::setSettingsFilePaths(const QString &settingsFilePath, const QString &resamplingCurveFilePath) {
+	this->settingsFilePath = settingsFilePath;
+	this->resamplingCurveFilePath = resamplingCurveFilePath;
+}
+
+void DispersionEstimationEngine::setRunReportLogFilePath(const QString &filePath) {
+	this->runReportLogFilePath = filePath;
+}
+
+void DispersionEstimationEngine::finishPhase(EstimationRunReport::Phase phase, const QElapsedTimer &phaseTimer) {
+	qint64 elapsed = phaseTimer.nsecsElapsed();
+	this->runReport.addPhase(phase, elapsed);
+	TraceRecorder::instance().addCompletedEvent(EstimationRunReport::phaseName(phase), "engine", elapsed);
+}
+
+void DispersionEstimationEngine::recordCacheAndThreadStatistics() {
+	this->runReport.cacheHits = this->metricCache.getHits();
+	this->runReport.cacheMisses = this->metricCache.getMisses();
+	ParallelMetricEvaluator::Utilization utilization = this->parallelEvaluator.takeUtilization();
+	this->runReport.workerBusyNanoseconds = utilization.busyNanoseconds;
+	this->runReport.parallelWallNanoseconds = utilization.wallNanoseconds;
+}
+
+void DispersionEstimationEngine::releaseWorkspaces(bool recordStatistics) {
+	if (recordStatistics) {
+		OCTSignalProcessing::ArenaStatistics workspace = this->processorController->getWorkspaceStatistics();
+		workspace += this->parallelEvaluator.getWorkspaceStatistics();
+		this->runReport.workspaceReservedBytes = static_cast<qint64>(workspace.reservedBytes);
+		this->runReport.workspaceHugePageBytes = static_cast<qint64>(workspace.hugePageBytes);
+		this->runReport.workspacePeakBytes = static_cast<qint64>(workspace.peakUsedBytes);
+	}
+	this->processorController->releaseWorkspace();
+	this->parallelEvaluator.releaseWorkspaces();
+}
+
+bool DispersionEstimationEngine::isCancellationRequested() const {
+	return this->cancellationRequested.loadAcquire() != 0;
 }
 
 void DispersionEstimationEngine::setParams(DispersionEstimatorParameters params) {
 	this->params = params;
+	this->isPeakFitting = params.peakFitting;
+	this->processorController->setHardwareCountersEnabled(params.hardwareCounters);
+	this->parallelEvaluator.setHardwareCountersEnabled(params.hardwareCounters);
 }
 
-void DispersionEstimationEngine::startDispersionEstimation(void *frameBuffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame)
+void DispersionEstimationEngine::startDispersionEstimation(void *frameBuffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int numberOfFrames)
 {
+	// Cancellation requests that arrived before this run started belong to a previous run
+	this->cancellationRequested.storeRelease(0);
+	this->estimationRunning.storeRelease(1);
+
 	emit statusUpdate(tr("Estimation process started..."));
 	emit estimationProcessStarted();
 
+	// Timings of earlier runs and of live tracking do not belong to this run
+	QElapsedTimer runTimer;
+	runTimer.start();
+	this->runReport.reset();
+	this->processorController->takeStageTimings();
+	this->parallelEvaluator.takeStageTimings();
+	this->parallelEvaluator.takeUtilization();
+	this->runReport.residentBytesAtStart = ProcessMemory::residentBytes();
+	this->runReport.peakResidentBytesOfRun = ProcessMemory::resetPeakResidentBytes();
+
+	OCTSignalProcessing::SpectrumView rawData = this->prepareProcessing(frameBuffer, bitDepth, samplesPerLine, linesPerFrame, numberOfFrames);
+	this->runReport.strategy = this->params.estimationStrategy;
+	this->runReport.samplesPerLine = static_cast<int>(samplesPerLine);
+	this->runReport.numberOfAscans = this->numberOfAscansIn(rawData);
+	if (numberOfFrames > 1) {
+		emit info(tr("Dispersion Estimator: Estimating with ") + QString::number(this->numberOfAscansIn(rawData)) + tr(" A-scans from ") + QString::number(numberOfFrames) + tr(" frames."));
+	}
+	if (this->params.ascanSelection == BEST_ASCANS && this->saturatedAscans > 0) {
+		emit info(tr("Dispersion Estimator: ") + QString::number(this->saturatedAscans) + tr(" of the selected A-scans contain saturated samples, there are not enough unsaturated A-scans."));
+	}
+
+	// Initialize dispersion parameters
+	this->bestD2 = 0;
+	this->bestD3 = 0;
+	this->bestMetricValueD2 = 0;
+	this->bestMetricValueD3 = 0;
+	this->curvatureD2 = 0;
+	this->curvatureD3 = 0;
+	this->bestHigherOrderCoefficients.clear();
+	this->pendingPointsD2.clear();
+	this->pendingPointsD3.clear();
+	this->evaluatedCandidates = 0;
+	this->totalCandidates = this->params.estimationStrategy == SEQUENTIAL_SWEEP ? 2 * this->params.numberOfDispersionSamples : this->params.numberOfDispersionSamples;
+	this->progressTimer.start();
+
+	// Set initial dispersion coefficients
+	this->processorController->setDispersionCoefficients(this->params.d2start, this->params.d3start);
+
+	// Set metric calculator parameters once
+	this->calculator.setParameters(this->params);
+
+	// Metric values of earlier runs on the same data are reused
+	this->metricCache.resetStatistics();
+	if (!this->params.metricCache) {
+		this->metricCache.clear();
+	}
+
+	// Every worker of the parallel evaluator gets its own copy of the processing settings
+	if (this->params.parallelEvaluation) {
+		this->parallelEvaluator.setThreadCount(this->params.numberOfThreads);
+		this->parallelEvaluator.prepare(this->processorController->settings_, this->params);
+	}
+	this->runReport.numberOfThreads = this->params.parallelEvaluation ? this->parallelEvaluator.getThreadCount() : 1;
+
+	// Sweeps time their d2 and d3 phases themselves
+	QElapsedTimer searchTimer;
+	searchTimer.start();
+	bool estimated = true;
+	switch (this->params.estimationStrategy) {
+	case NELDER_MEAD_2D:
+		this->estimateWithNelderMead(rawData);
+		this->finishPhase(EstimationRunReport::JOINT_SEARCH, searchTimer);
+		break;
+	case GRADIENT_LBFGS:
+		this->estimateWithGradient(rawData);
+		this->finishPhase(EstimationRunReport::JOINT_SEARCH, searchTimer);
+		break;
+	case SUCCESSIVE_HALVING:
+		this->estimateWithSuccessiveHalving(rawData);
+		break;
+	case COORDINATE_DESCENT:
+		estimated = this->estimateWithCoordinateDescent(rawData);
+		this->finishPhase(EstimationRunReport::JOINT_SEARCH, searchTimer);
+		break;
+	case SEQUENTIAL_SWEEP:
+	default:
+		this->estimateWithSequentialSweep(rawData);
+		break;
+	}
+
+	this->flushProgress(true);
+
+	// A stopped or failed run does not apply its (incomplete) result
+	if (this->isCancellationRequested() || !estimated) {
+		this->releaseWorkspaces(false);
+		this->estimationRunning.storeRelease(0);
+		emit estimationProcessStopped();
+		emit statusUpdate(estimated ? tr("Estimation stopped. Ready for next operation.") : tr("Estimation failed. Ready for next operation."));
+		return;
+	}
+
+	// Generate Ascan without dispersion compensation and one with disp. compensation using bestD2 and bestD3 and plot both
+	QElapsedTimer previewTimer;
+	previewTimer.start();
+	QVector<float> ascanWithoutDispersionCompensation = this->processFirstLineOnly(rawData, 0, 0);
+	QVector<float> ascanWithBestDispersion = this->processFirstLineOnly(rawData, this->bestD2, this->bestD3, this->bestHigherOrderCoefficients);
+	this->finishPhase(EstimationRunReport::ASCAN_PREVIEW, previewTimer);
+	emit ascanWithoutDispersionCalculated(ascanWithoutDispersionCompensation);
+	emit ascanWithBestDispersionCalculated(ascanWithBestDispersion);
+
+	// calculate d1
+	double* d1Ptr = nullptr;
+	if(params.autoCalcD1){
+		this->calculatedD1 = -(bestD2 + bestD3);
+		d1Ptr = &(this->calculatedD1);
+		emit d1Calculated(this->calculatedD1);
+	}
+
+	// transfer and display best dispersion values
+	emit dispersionEstimationReady(nullptr, d1Ptr, &this->bestD2, &this->bestD3);
+	emit bestD2Estimated(this->bestD2);
+	emit bestD3Estimated(this->bestD3);
+	emit higherOrderCoefficientsEstimated(this->bestHigherOrderCoefficients);
+	if (this->metricCache.getHits() > 0) {
+		emit info(tr("Dispersion Estimator: ") + QString::number(this->metricCache.getHits()) + tr(" of ") + QString::number(this->metricCache.getHits() + this->metricCache.getMisses()) + tr(" metric values were taken from the cache."));
+	}
+	if (this->isPeakFitting) {
+		emit info(tr("Dispersion Estimator: Metric curvature at peak: d2: ") + QString::number(this->curvatureD2) + tr(", d3: ") + QString::number(this->curvatureD3));
+	}
+
+	// Live tracking continues from this result
+	this->hasTrackingStart = true;
+	this->trackedD2 = this->bestD2;
+	this->trackedD3 = this->bestD3;
+	this->trackingWindowD2 = TRACKING_INITIAL_WINDOW_FRACTION * qAbs(this->params.d2end - this->params.d2start);
+	this->trackingWindowD3 = TRACKING_INITIAL_WINDOW_FRACTION * qAbs(this->params.d3end - this->params.d3start);
+	this->trackingFailing = false;
+
+	// Run report: stage timings of the engine thread and of all workers
+	this->runReport.evaluatedCandidates = this->evaluatedCandidates;
+	this->runReport.totalNanoseconds = runTimer.nsecsElapsed();
+	this->runReport.stageTimings = this->processorController->takeStageTimings();
+	this->runReport.stageTimings += this->parallelEvaluator.takeStageTimings();
+	this->runReport.peakResidentBytes = ProcessMemory::peakResidentBytes();
+	this->recordCacheAndThreadStatistics();
+	this->releaseWorkspaces(true);
+	this->runReport.hardwareCountersRequested = this->params.hardwareCounters;
+	if (this->params.hardwareCounters && !OCTSignalProcessing::HardwareCounters::forCurrentThread().isAvailable()) {
+		this->runReport.hardwareCounterError = QString::fromStdString(OCTSignalProcessing::HardwareCounters::forCurrentThread().errorString());
+	}
+	TraceRecorder::instance().addCompletedEvent("estimation_run", "engine", this->runReport.totalNanoseconds);
+	emit runReportReady(this->runReport);
+	if (!this->runReportLogFilePath.isEmpty() && !this->runReport.appendToFile(this->runReportLogFilePath)) {
+		emit error(tr("Dispersion Estimator: Could not write run report to ") + this->runReportLogFilePath);
+	}
+
+	this->estimationRunning.storeRelease(0);
+	emit statusUpdate(tr("Ready for next operation. ") + this->runReport.summary());
+}
+
+void DispersionEstimationEngine::trackDispersion(void *frameBuffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame)
+{
+	// Without a previous result there is nothing to start from, so the first tracking frame gets a full estimation
+	if (!this->hasTrackingStart) {
+		this->startDispersionEstimation(frameBuffer, bitDepth, samplesPerLine, linesPerFrame, 1);
+		return;
+	}
+
+	this->cancellationRequested.storeRelease(0);
+	this->estimationRunning.storeRelease(1);
+	TraceScope trace("live_tracking", "engine");
+
+	// Tracking runs get a report too, so the performance panel can show whether they keep up with the frame rate
+	QElapsedTimer runTimer;
+	runTimer.start();
+	this->runReport.reset();
+	this->runReport.liveTracking = true;
+	this->processorController->takeStageTimings();
+	this->parallelEvaluator.takeUtilization();
+	this->metricCache.resetStatistics();
+
+	OCTSignalProcessing::SpectrumView rawData = this->prepareProcessing(frameBuffer, bitDepth, samplesPerLine, linesPerFrame, 1);
+	this->calculator.setParameters(this->params);
+	this->runReport.strategy = this->params.estimationStrategy;
+	this->runReport.samplesPerLine = static_cast<int>(samplesPerLine);
+	this->runReport.numberOfAscans = this->numberOfAscansIn(rawData);
+
+	// d2 and d3 are re-tuned one after the other in small windows around the values that are currently applied.
+	// Tracking runs serially on the engine thread to keep its CPU load low.
+	float currentMetricValue = 0.0f;
+	float trackedMetricValue = 0.0f;
+	bool ok = true;
+	QElapsedTimer phaseTimer;
+	phaseTimer.start();
+	double newD2 = this->trackCoefficient(rawData, this->trackedD2, this->trackedD3, true, currentMetricValue, trackedMetricValue, ok);
+	this->finishPhase(EstimationRunReport::D2_SWEEP, phaseTimer);
+	this->runReport.evaluatedCandidates = TRACKING_SAMPLES_PER_AXIS;
+	double newD3 = this->trackedD3;
+	if (ok && !this->isCancellationRequested()) {
+		float unused = 0.0f;
+		phaseTimer.restart();
+		newD3 = this->trackCoefficient(rawData, newD2, this->trackedD3, false, unused, trackedMetricValue, ok);
+		this->finishPhase(EstimationRunReport::D3_SWEEP, phaseTimer);
+		this->runReport.evaluatedCandidates += TRACKING_SAMPLES_PER_AXIS;
+	}
+	if (this->isCancellationRequested()) {
+		this->estimationRunning.storeRelease(0);
+		return;
+	}
+	if (!ok) {
+		if (!this->trackingFailing) {
+			this->trackingFailing = true;
+			emit error(tr("Dispersion Estimator: Live tracking failed, the frame could not be processed. Tracking continues with the next frame."));
+		}
+		this->estimationRunning.storeRelease(0);
+		emit statusUpdate(tr("Live tracking failed, keeping d2 = ") + QString::number(this->trackedD2) + tr(", d3 = ") + QString::number(this->trackedD3));
+		return;
+	}
+	if (this->trackingFailing) {
+		this->trackingFailing = false;
+		emit info(tr("Dispersion Estimator: Live tracking works again."));
+	}
+
+	// Not appended to the run log, one entry per tracking frame would flood it
+	this->runReport.totalNanoseconds = runTimer.nsecsElapsed();
+	this->runReport.stageTimings = this->processorController->takeStageTimings();
+	this->runReport.peakResidentBytes = ProcessMemory::peakResidentBytes();
+	this->recordCacheAndThreadStatistics();
+	emit runReportReady(this->runReport);
+
+	// Hysteresis: small metric gains caused by noise must not make the coefficients jitter
+	bool improved = trackedMetricValue - currentMetricValue > TRACKING_HYSTERESIS * qAbs(currentMetricValue);
+	if (improved) {
+		this->trackedD2 = newD2;
+		this->trackedD3 = newD3;
+		this->bestD2 = newD2;
+		this->bestD3 = newD3;
+
+		double* d1Ptr = nullptr;
+		if (this->params.autoCalcD1) {
+			this->calculatedD1 = -(this->bestD2 + this->bestD3);
+			d1Ptr = &(this->calculatedD1);
+			emit d1Calculated(this->calculatedD1);
+		}
+		emit dispersionEstimationReady(nullptr, d1Ptr, &this->bestD2, &this->bestD3);
+		emit bestD2Estimated(this->bestD2);
+		emit bestD3Estimated(this->bestD3);
+	}
+
+	this->estimationRunning.storeRelease(0);
+	emit statusUpdate(tr("Live tracking: d2 = ") + QString::number(this->trackedD2) + tr(", d3 = ") + QString::number(this->trackedD3) + (improved ? tr(" (updated)") : QString()));
+}
+
+double DispersionEstimationEngine::trackCoefficient(const OCTSignalProcessing::SpectrumView &rawData, double d2, double d3, bool isD2, float &centerMetricValue, float &bestMetricValue, bool &ok)
+{
+	double center = isD2 ? d2 : d3;
+	double &window = isD2 ? this->trackingWindowD2 : this->trackingWindowD3;
+	qreal rangeStart = isD2 ? this->params.d2start : this->params.d3start;
+	qreal rangeEnd = isD2 ? this->params.d2end : this->params.d3end;
+	qreal range = qAbs(rangeEnd - rangeStart);
+
+	// The window never gets finer than the sample spacing of a full estimation and never wider than a quarter of the range
+	double minWindow = range / static_cast<double>(qMax(1, this->params.numberOfDispersionSamples)) * (TRACKING_SAMPLES_PER_AXIS - 1) / 2.0;
+	double maxWindow = qMax(minWindow, TRACKING_MAX_WINDOW_FRACTION * range);
+	window = qBound(minWindow, window, maxWindow);
+
+	std::vector<double> coeffs;
+	std::vector<double> metricValues;
+	int bestIndex = 0;
+	for (int i = 0; i < TRACKING_SAMPLES_PER_AXIS; i++) {
+		// Not cached, every tracking frame has new data and its values would only push reusable ones out of the cache
+		double coeff = center + window * (2.0 * i / (TRACKING_SAMPLES_PER_AXIS - 1) - 1.0);
+		float metricValue = isD2 ? this->computeMetric(rawData, coeff, d3, &ok) : this->computeMetric(rawData, d2, coeff, &ok);
+		if (!ok) {
+			return center;
+		}
+		coeffs.push_back(coeff);
+		metricValues.push_back(metricValue);
+		if (metricValue > metricValues[bestIndex]) {
+			bestIndex = i;
+		}
+	}
+	centerMetricValue = static_cast<float>(metricValues[TRACKING_SAMPLES_PER_AXIS / 2]);
+	bestMetricValue = static_cast<float>(metricValues[bestIndex]);
+
+	// Widen the window if the optimum ran away to its border, narrow it down if the optimum is stable
+	if (bestIndex == 0 || bestIndex == TRACKING_SAMPLES_PER_AXIS - 1) {
+		window = qMin(window * 2.0, maxWindow);
+		return coeffs[bestIndex];
+	}
+	if (bestIndex == TRACKING_SAMPLES_PER_AXIS / 2) {
+		window = qMax(window * 0.5, minWindow);
+	}
+
+	if (this->isPeakFitting) {
+		PeakFitter::Peak1D peak = PeakFitter::fitParabola(coeffs, metricValues);
+		if (peak.valid) {
+			return peak.position;
+		}
+	}
+	return coeffs[bestIndex];
+}
+
+OCTSignalProcessing::SpectrumView DispersionEstimationEngine::prepareProcessing(void *frameBuffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int numberOfFrames)
+{
 	// Load processing settings
-	qDebug() << "Loading processing settings...";
-	this->processorController->loadSettingsFromFile(SETTINGS_PATH);
+	VERBOSE_DEBUG("Loading processing settings...");
+	QElapsedTimer phaseTimer;
+	phaseTimer.start();
+	this->processorController->loadSettingsFromFile(this->settingsFilePath);
 	if(this->params.useLinearAscans){
 		this->processorController->settings_.processingOptions.logScale = false;
 	} else {
 		this->processorController->settings_.processingOptions.logScale = true;
 	}
 	if(this->processorController->settings_.processingOptions.useCustomResamplingCurve){
-			this->processorController->loadCustomResamplingCurveFromFile(SETTINGS_PATH_RESAMPLING_FILE); //this loads the resampling curve data that is used by OCTproZ
+			this->processorController->loadCustomResamplingCurveFromFile(this->resamplingCurveFilePath); //this loads the resampling curve data that is used by OCTproZ
 	}
 	unsigned int centerAscans = qMin(static_cast<unsigned int>(this->params.numberOfCenterAscans), linesPerFrame);
 	this->processorController->settings_.samplesPerSpectrum = samplesPerLine;
 	this->processorController->settings_.spectraPerFrame = centerAscans;
 	this->processorController->settings_.bitDepth = bitDepth;
+	this->finishPhase(EstimationRunReport::SETTINGS_LOAD, phaseTimer);
+	phaseTimer.restart();
 
-	// Calculate offsets for extracting the center region
+	// Calculate offsets of the center region
 	unsigned int offsetAscans = 0;
 	if (centerAscans < linesPerFrame) {
 		offsetAscans = (linesPerFrame - centerAscans) / 2;
 	}
 
-	// Calculate byte offsets
+	// The A-scans are read in place from the frame buffer, which stays valid until the run returns. Several frames are
+	// listed line by line, each frame stays a block of consecutive entries.
 	size_t bytesPerSample = static_cast<size_t>(ceil(static_cast<double>(bitDepth)/8.0));
 	size_t lineSizeBytes = samplesPerLine * bytesPerSample;
-	size_t offsetBytes = offsetAscans * lineSizeBytes;
-	size_t partialBytes = centerAscans * lineSizeBytes;
+	size_t frameSizeBytes = lineSizeBytes * linesPerFrame;
+	this->pooledFrames = static_cast<int>(qMax(1u, numberOfFrames));
+	this->saturatedAscans = 0;
+	this->metricCache.invalidateData();
+	OCTSignalProcessing::SpectrumView rawData;
+	if (this->params.ascanSelection == BEST_ASCANS) {
+		// Every frame is ranked on its own, so pooled frames contribute the same number of A-scans
+		this->ascanLines.resize(static_cast<size_t>(centerAscans) * this->pooledFrames);
+		for (int frame = 0; frame < this->pooledFrames; frame++) {
+			this->ascanSelector.measure(reinterpret_cast<const char*>(frameBuffer) + frame * frameSizeBytes, lineSizeBytes, samplesPerLine, linesPerFrame, static_cast<int>(bitDepth));
+			std::vector<size_t> bestLines = this->ascanSelector.bestLines(centerAscans);
+			for (unsigned int i = 0; i < centerAscans; i++) {
+				this->ascanLines[frame * centerAscans + i] = static_cast<size_t>(frame) * linesPerFrame + bestLines[i];
+				if (this->ascanSelector.getLineQualities()[bestLines[i]].clippedSamples > 0) {
+					this->saturatedAscans++;
+				}
+			}
+		}
+		rawData = OCTSignalProcessing::SpectrumView(frameBuffer, lineSizeBytes, this->ascanLines.size(), this->ascanLines.data());
+	} else if (this->pooledFrames == 1) {
+		rawData = OCTSignalProcessing::SpectrumView(reinterpret_cast<const char*>(frameBuffer) + offsetAscans * lineSizeBytes, lineSizeBytes, centerAscans);
+	} else {
+		this->ascanLines.resize(static_cast<size_t>(centerAscans) * this->pooledFrames);
+		for (int frame = 0; frame < this->pooledFrames; frame++) {
+			for (unsigned int i = 0; i < centerAscans; i++) {
+				this->ascanLines[frame * centerAscans + i] = static_cast<size_t>(frame) * linesPerFrame + offsetAscans + i;
+			}
+		}
+		rawData = OCTSignalProcessing::SpectrumView(frameBuffer, lineSizeBytes, this->ascanLines.size(), this->ascanLines.data());
+	}
+	this->finishPhase(EstimationRunReport::FRAME_COPY, phaseTimer);
+	return rawData;
+}
 
-	// Extract center A-scans into QByteArray
-	QByteArray rawData(
-		reinterpret_cast<const char*>(frameBuffer) + offsetBytes,
-		static_cast<int>(partialBytes)
-	);
+void DispersionEstimationEngine::estimateWithSequentialSweep(const OCTSignalProcessing::SpectrumView &rawData)
+{
+	qreal stepSizeD2 = qAbs(this->params.d2end - this->params.d2start) / static_cast<qreal>(this->params.numberOfDispersionSamples);
+	qreal stepSizeD3 = qAbs(this->params.d3end - this->params.d3start) / static_cast<qreal>(this->params.numberOfDispersionSamples);
+	QVector<ParallelMetricEvaluator::Candidate> candidates(this->params.numberOfDispersionSamples);
 
-	// Initialize dispersion parameters
-	this->bestD2 = 0;
-	this->bestD3 = 0;
+	// Process dispersion for d2
+	QElapsedTimer phaseTimer;
+	phaseTimer.start();
+	this->bestMetricValueD2 = 0;
+	this->bestMetricValueD3 = 0;
+	this->clearSamples();
+	for (int i = 0; i < this->params.numberOfDispersionSamples; i++) {
+		candidates[i] = qMakePair(this->params.d2start + i * stepSizeD2, 0.0);
+	}
+	this->sweepCandidates(rawData, candidates, true);
+	if (this->isPeakFitting) {
+		this->refineSweepPeak(this->sampledD2, this->bestD2, this->curvatureD2);
+	}
+
+	this->finishPhase(EstimationRunReport::D2_SWEEP, phaseTimer);
+
+	// Process dispersion for d3
+	phaseTimer.restart();
 	this->bestMetricValueD2 = 0;
 	this->bestMetricValueD3 = 0;
-	qreal d2 = this->params.d2start;
-	qreal d3 = this->params.d3start;
-	qreal d3_zero = 0.0;
+	this->clearSamples();
+	for (int j = 0; j < this->params.numberOfDispersionSamples; j++) {
+		candidates[j] = qMakePair(this->bestD2, this->params.d3start + j * stepSizeD3);
+	}
+	this->sweepCandidates(rawData, candidates, false);
+	if (this->isPeakFitting) {
+		this->refineSweepPeak(this->sampledD3, this->bestD3, this->curvatureD3);
+	}
+	this->finishPhase(EstimationRunReport::D3_SWEEP, phaseTimer);
+}
+
+void DispersionEstimationEngine::estimateWithNelderMead(const OCTSignalProcessing::SpectrumView &rawData)
+{
+	// Joint search over (d2, d3). The evaluation budget matches a single 1D sweep, which is half of what the sequential sweep needs.
+	qreal d2Min = qMin(this->params.d2start, this->params.d2end);
+	qreal d2Max = qMax(this->params.d2start, this->params.d2end);
+	qreal d3Min = qMin(this->params.d3start, this->params.d3end);
+	qreal d3Max = qMax(this->params.d3start, this->params.d3end);
+
+	std::vector<double> start = {(d2Min + d2Max) / 2.0, (d3Min + d3Max) / 2.0};
+	std::vector<double> initialStep = {(d2Max - d2Min) / 4.0, (d3Max - d3Min) / 4.0};
+	std::vector<double> lowerBound = {d2Min, d3Min};
+	std::vector<double> upperBound = {d2Max, d3Max};
+
+	// Stop once the simplex is smaller than one sweep step of the corresponding 1D search
+	NelderMeadOptimizer optimizer;
+	optimizer.setMaxEvaluations(this->params.numberOfDispersionSamples);
+	optimizer.setTolerance(4.0 / static_cast<double>(qMax(1, this->params.numberOfDispersionSamples)));
+	optimizer.setStopCondition([this]() { return this->isCancellationRequested(); });
+
+	this->clearSamples();
+	NelderMeadOptimizer::Objective objective = [this, &rawData](const std::vector<double> &coeffs) {
+		bool ok = false;
+		float metricValue = this->evaluateMetric(rawData, coeffs[0], coeffs[1], &ok);
+		if (ok) {
+			this->sampledD2.push_back(coeffs[0]);
+			this->sampledD3.push_back(coeffs[1]);
+			this->sampledMetric.push_back(metricValue);
+			this->queueProgress(coeffs[0], metricValue, true);
+			this->queueProgress(coeffs[1], metricValue, false);
+		}
+		this->evaluatedCandidates++;
+		this->flushProgress(false);
+		return static_cast<double>(metricValue);
+	};
+
+	NelderMeadOptimizer::Result result = optimizer.maximize(objective, start, initialStep, lowerBound, upperBound);
+	this->bestD2 = result.position[0];
+	this->bestD3 = result.position[1];
+	this->bestMetricValueD2 = static_cast<float>(result.value);
+	this->bestMetricValueD3 = static_cast<float>(result.value);
+
+	emit info(tr("Dispersion Estimator: Nelder-Mead finished after ") + QString::number(result.evaluations) + tr(" evaluations and ") + QString::number(result.restarts) + tr(" restarts."));
+
+	if (this->isPeakFitting) {
+		this->refineJointPeak();
+	}
+}
+
+void DispersionEstimationEngine::estimateWithGradient(const OCTSignalProcessing::SpectrumView &rawData)
+{
+	// The search runs in normalized coordinates: -1 and 1 correspond to the borders of the d2 and d3 ranges
+	qreal centerD2 = (this->params.d2start + this->params.d2end) / 2.0;
+	qreal centerD3 = (this->params.d3start + this->params.d3end) / 2.0;
+	qreal halfRangeD2 = qMax(qAbs(this->params.d2end - this->params.d2start) / 2.0, 1e-9);
+	qreal halfRangeD3 = qMax(qAbs(this->params.d3end - this->params.d3start) / 2.0, 1e-9);
+	int evaluationBudget = qMax(GRADIENT_SEED_GRID_SIZE * GRADIENT_SEED_GRID_SIZE + 1, this->params.numberOfDispersionSamples);
+	this->clearSamples();
+
+	LbfgsOptimizer::Objective objective = [&](const std::vector<double> &position, std::vector<double> &gradient) {
+		qreal d2 = centerD2 + position[0] * halfRangeD2;
+		qreal d3 = centerD3 + position[1] * halfRangeD3;
+		std::vector<float> metricGradient;
+		bool ok = false;
+		float metricValue = this->evaluateMetricGradient(rawData, d2, d3, metricGradient, &ok);
+		gradient.assign(2, 0.0);
+		if (ok) {
+			gradient[0] = static_cast<double>(metricGradient[0]) * halfRangeD2;
+			gradient[1] = static_cast<double>(metricGradient[1]) * halfRangeD3;
+			this->sampledD2.push_back(d2);
+			this->sampledD3.push_back(d3);
+			this->sampledMetric.push_back(metricValue);
+			this->queueProgress(d2, metricValue, true);
+			this->queueProgress(d3, metricValue, false);
+		}
+		this->evaluatedCandidates++;
+		this->flushProgress(false);
+		return static_cast<double>(metricValue);
+	};
+
+	// The metric landscape is not convex over the whole range, so the start point is taken from a coarse grid
+	std::vector<double> start = {0.0, 0.0};
+	double bestSeedValue = -1.0;
+	std::vector<double> unusedGradient;
+	for (int i = 0; i < GRADIENT_SEED_GRID_SIZE && !this->isCancellationRequested(); i++) {
+		for (int j = 0; j < GRADIENT_SEED_GRID_SIZE; j++) {
+			std::vector<double> seed = {
+				-1.0 + (2.0 * i + 1.0) / GRADIENT_SEED_GRID_SIZE,
+				-1.0 + (2.0 * j + 1.0) / GRADIENT_SEED_GRID_SIZE
+			};
+			double seedValue = objective(seed, unusedGradient);
+			if (seedValue > bestSeedValue) {
+				bestSeedValue = seedValue;
+				start = seed;
+			}
+		}
+	}
+
+	LbfgsOptimizer optimizer;
+	optimizer.setMaxEvaluations(evaluationBudget - GRADIENT_SEED_GRID_SIZE * GRADIENT_SEED_GRID_SIZE);
+	optimizer.setInitialStepLength(1.0 / GRADIENT_SEED_GRID_SIZE);
+	optimizer.setTolerance(1.0 / static_cast<double>(qMax(1, this->params.numberOfDispersionSamples)));
+	optimizer.setStopCondition([this]() { return this->isCancellationRequested(); });
+	LbfgsOptimizer::Result result = optimizer.maximize(objective, start, {-1.0, -1.0}, {1.0, 1.0});
+
+	this->bestD2 = centerD2 + result.position[0] * halfRangeD2;
+	this->bestD3 = centerD3 + result.position[1] * halfRangeD3;
+	this->bestMetricValueD2 = static_cast<float>(result.value);
+	this->bestMetricValueD3 = static_cast<float>(result.value);
+	if (this->isPeakFitting) {
+		this->refineJointPeak();
+	}
+
+	emit info(tr("Dispersion Estimator: L-BFGS finished after ") + QString::number(result.iterations) + tr(" iterations and ") + QString::number(result.evaluations) + tr(" evaluations."));
+}
+
+void DispersionEstimationEngine::estimateWithSuccessiveHalving(const OCTSignalProcessing::SpectrumView &rawData)
+{
+	// Same candidates as the sequential sweep, but each sweep scores them on growing random subsets of the A-scans
+	// and only the better half is scored again on the next, twice as large subset
 	qreal stepSizeD2 = qAbs(this->params.d2end - this->params.d2start) / static_cast<qreal>(this->params.numberOfDispersionSamples);
 	qreal stepSizeD3 = qAbs(this->params.d3end - this->params.d3start) / static_cast<qreal>(this->params.numberOfDispersionSamples);
+	QVector<ParallelMetricEvaluator::Candidate> candidates(this->params.numberOfDispersionSamples);
 
-	// Set initial dispersion coefficients
-	this->processorController->setDispersionCoefficients(d2, d3);
-
-	// Set metric calculator parameters once
-	this->calculator.setParameters(this->params);
+	QVector<QPair<int, int>> schedule = this->halvingSchedule(this->params.numberOfDispersionSamples, this->numberOfAscansIn(rawData));
+	int transformsPerSweep = 0;
+	this->totalCandidates = 0;
+	for (const QPair<int, int> &round : schedule) {
+		this->totalCandidates += 2 * round.first;
+		transformsPerSweep += round.first * round.second;
+	}
+	if (this->isPeakFitting) {
+		this->totalCandidates += 2 * 2;
+	}
 
 	// Process dispersion for d2
+	QElapsedTimer phaseTimer;
+	phaseTimer.start();
 	this->bestMetricValueD2 = 0;
 	this->bestMetricValueD3 = 0;
+	this->clearSamples();
 	for (int i = 0; i < this->params.numberOfDispersionSamples; i++) {
-		this->processDispersionMetric(rawData, d2, d3_zero, stepSizeD2, true);
+		candidates[i] = qMakePair(this->params.d2start + i * stepSizeD2, 0.0);
 	}
+	this->halveCandidates(rawData, candidates, true);
+	if (this->isPeakFitting) {
+		this->refineHalvingPeak(rawData, this->params.d2start, stepSizeD2, true);
+	}
+
+	this->finishPhase(EstimationRunReport::D2_SWEEP, phaseTimer);
 
 	// Process dispersion for d3
+	phaseTimer.restart();
 	this->bestMetricValueD2 = 0;
 	this->bestMetricValueD3 = 0;
+	this->clearSamples();
 	for (int j = 0; j < this->params.numberOfDispersionSamples; j++) {
-		processDispersionMetric(rawData, this->bestD2, d3, stepSizeD3, false);
+		candidates[j] = qMakePair(this->bestD2, this->params.d3start + j * stepSizeD3);
 	}
+	this->halveCandidates(rawData, candidates, false);
+	if (this->isPeakFitting) {
+		this->refineHalvingPeak(rawData, this->params.d3start, stepSizeD3, false);
+	}
+	this->finishPhase(EstimationRunReport::D3_SWEEP, phaseTimer);
 
-	// Generate Ascan without dispersion compensation and one with disp. compensation using bestD2 and bestD3 and plot both
-	QVector<float> ascanWithoutDispersionCompensation = this->processFirstLineOnly(rawData, 0, 0);
-	emit ascanWithoutDispersionCalculated(ascanWithoutDispersionCompensation);
-	QVector<float> ascanWithBestDispersion = this->processFirstLineOnly(rawData, this->bestD2, this->bestD3);
-	emit ascanWithBestDispersionCalculated(ascanWithBestDispersion);
+	int fullTransformsPerSweep = this->params.numberOfDispersionSamples * this->numberOfAscansIn(rawData);
+	emit info(tr("Dispersion Estimator: Successive halving needed ") + QString::number(transformsPerSweep) + tr(" instead of ") + QString::number(fullTransformsPerSweep) + tr(" A-scan transforms per sweep."));
+}
 
-	// calculate d1
-	double* d1Ptr = nullptr;
-	if(params.autoCalcD1){
-		this->calculatedD1 = -(bestD2 + bestD3);
-		d1Ptr = &(this->calculatedD1);
-		emit d1Calculated(this->calculatedD1);
+void DispersionEstimationEngine::refineHalvingPeak(const OCTSignalProcessing::SpectrumView &rawData, qreal gridStart, qreal stepSize, bool isD2)
+{
+	// The survivors of the last round are the best candidates, not neighbouring grid samples, and can lie far apart or
+	// around a secondary peak. The parabola is fitted through the best survivor and its two grid neighbours instead,
+	// which are scored on all A-scans here.
+	double &bestCoeff = isD2 ? this->bestD2 : this->bestD3;
+	double &curvature = isD2 ? this->curvatureD2 : this->curvatureD3;
+	float &bestMetricValue = isD2 ? this->bestMetricValueD2 : this->bestMetricValueD3;
+	curvature = 0;
+	int bestIndex = stepSize > 0.0 ? qRound((bestCoeff - gridStart) / stepSize) : 0;
+	if (bestIndex <= 0 || bestIndex >= this->params.numberOfDispersionSamples - 1 || this->isCancellationRequested()) {
+		return; // a peak at the edge of the range is not refined, like in a full sweep
 	}
 
-	// transfer and display best dispersion values
-	emit dispersionEstimationReady(nullptr, d1Ptr, &this->bestD2, &this->bestD3);
-	emit bestD2Estimated(this->bestD2);
-	emit bestD3Estimated(this->bestD3);
+	QVector<ParallelMetricEvaluator::Candidate> neighbours;
+	for (int index : {bestIndex - 1, bestIndex + 1}) {
+		qreal coeff = gridStart + index * stepSize;
+		neighbours.append(isD2 ? qMakePair(coeff, 0.0) : qMakePair(this->bestD2, coeff));
+	}
+	QVector<bool> success;
+	QVector<float> metricValues = this->evaluateCandidates(rawData, neighbours, success);
+	this->evaluatedCandidates += neighbours.size();
+	for (int i = 0; i < neighbours.size(); i++) {
+		if (success.at(i)) {
+			this->queueProgress(isD2 ? neighbours.at(i).first : neighbours.at(i).second, metricValues.at(i), isD2);
+		}
+	}
+	this->flushProgress(true);
+	if (!success.at(0) || !success.at(1)) {
+		return;
+	}
+
+	// If a neighbour scores better on all A-scans than the best survivor, it is taken without a fit
+	std::vector<double> coeffs = {gridStart + (bestIndex - 1) * stepSize, bestCoeff, gridStart + (bestIndex + 1) * stepSize};
+	std::vector<double> values = {metricValues.at(0), bestMetricValue, metricValues.at(1)};
+	PeakFitter::Peak1D peak = PeakFitter::fitParabola(coeffs, values);
+	bestCoeff = peak.position;
+	bestMetricValue = static_cast<float>(peak.value);
+	if (peak.valid) {
+		curvature = peak.curvature;
+	}
+}
+
+void DispersionEstimationEngine::halveCandidates(const OCTSignalProcessing::SpectrumView &rawData, QVector<ParallelMetricEvaluator::Candidate> candidates, bool isD2)
+{
+	int numberOfAscans = this->numberOfAscansIn(rawData);
+	QVector<QPair<int, int>> schedule = this->halvingSchedule(candidates.size(), numberOfAscans);
+
+	// Subsets are prefixes of one shuffled order, so every subset contains the previous one
+	QVector<int> ascanOrder(numberOfAscans);
+	std::iota(ascanOrder.begin(), ascanOrder.end(), 0);
+	std::mt19937 randomGenerator(HALVING_ASCAN_ORDER_SEED);
+	std::shuffle(ascanOrder.begin(), ascanOrder.end(), randomGenerator);
+
+	int batchSize = 1;
+	if (this->params.parallelEvaluation) {
+		batchSize = this->parallelEvaluator.getThreadCount() * CANDIDATES_PER_THREAD_AND_BATCH;
+	}
+
+	std::vector<size_t> subsetLines;
+	for (int roundIndex = 0; roundIndex < schedule.size(); roundIndex++) {
+		int subsetSize = schedule.at(roundIndex).second;
+		bool isLastRound = roundIndex == schedule.size() - 1;
+		OCTSignalProcessing::SpectrumView subset = rawData;
+		if (!isLastRound) {
+			subset = this->selectAscans(rawData, ascanOrder.mid(0, subsetSize), subsetLines);
+			this->metricCache.invalidateData();
+		}
+
+		// Survivors of the last round are sorted by coefficient, so they are plotted in order
+		if (isLastRound) {
+			std::sort(candidates.begin(), candidates.end());
+		}
+
+		QVector<float> metricValues;
+		metricValues.reserve(candidates.size());
+		for (int batchStart = 0; batchStart < candidates.size(); batchStart += batchSize) {
+			if (this->isCancellationRequested()) {
+				return;
+			}
+			QVector<ParallelMetricEvaluator::Candidate> batch = candidates.mid(batchStart, batchSize);
+			QVector<bool> success;
+			QVector<float> batchValues = this->evaluateCandidates(subset, batch, success);
+			for (int i = 0; i < batch.size(); i++) {
+				if (!success.at(i)) {
+					metricValues.append(std::numeric_limits<float>::lowest());
+					continue;
+				}
+				metricValues.append(batchValues.at(i));
+				if (isLastRound) {
+					this->recordSweepResult(batch.at(i).first, batch.at(i).second, batchValues.at(i), isD2);
+				} else {
+					// The metric is a sum over A-scans, scaling it to the full set keeps the plotted values comparable
+					float scaledValue = batchValues.at(i) * static_cast<float>(numberOfAscans) / static_cast<float>(subsetSize);
+					qreal coeff = isD2 ? batch.at(i).first : batch.at(i).second;
+					this->queueProgress(coeff, scaledValue, isD2);
+				}
+			}
+			this->evaluatedCandidates += batch.size();
+			this->flushProgress(false);
+		}
+
+		if (isLastRound) {
+			break;
+		}
+
+		// Keep the best candidates for the next round
+		int survivors = schedule.at(roundIndex + 1).first;
+		QVector<int> ranking(candidates.size());
+		std::iota(ranking.begin(), ranking.end(), 0);
+		std::partial_sort(ranking.begin(), ranking.begin() + survivors, ranking.end(), [&metricValues](int a, int b) {
+			return metricValues.at(a) > metricValues.at(b);
+		});
+		QVector<ParallelMetricEvaluator::Candidate> nextCandidates;
+		nextCandidates.reserve(survivors);
+		for (int i = 0; i < survivors; i++) {
+			nextCandidates.append(candidates.at(ranking.at(i)));
+		}
+		candidates = nextCandidates;
+	}
+	this->flushProgress(true);
+}
+
+QVector<QPair<int, int>> DispersionEstimationEngine::halvingSchedule(int numberOfCandidates, int numberOfAscans) const
+{
+	// Each round is a pair of (number of candidates, number of A-scans they are scored on).
+	// The first subset is chosen so that the subset reaches the full set when about HALVING_MIN_SURVIVORS candidates are left.
+	QVector<QPair<int, int>> schedule;
+	numberOfAscans = qMax(1, numberOfAscans);
+	int rounds = 0;
+	while ((numberOfCandidates >> (rounds + 1)) >= HALVING_MIN_SURVIVORS && (numberOfAscans >> (rounds + 1)) >= 1) {
+		rounds++;
+	}
+	int subsetSize = qMax(1, (numberOfAscans + (1 << rounds) - 1) >> rounds);
+	int remainingCandidates = numberOfCandidates;
+	while (true) {
+		subsetSize = qMin(subsetSize, numberOfAscans);
+		schedule.append(qMakePair(remainingCandidates, subsetSize));
+		if (subsetSize >= numberOfAscans) {
+			break;
+		}
+		int nextCandidates = qMin(remainingCandidates, qMax(HALVING_MIN_SURVIVORS, (remainingCandidates + 1) / 2));
+		subsetSize = nextCandidates < remainingCandidates ? subsetSize * 2 : numberOfAscans;
+		remainingCandidates = nextCandidates;
+	}
+	return schedule;
+}
+
+OCTSignalProcessing::SpectrumView DispersionEstimationEngine::selectAscans(const OCTSignalProcessing::SpectrumView &rawData, QVector<int> ascanIndices, std::vector<size_t> &lines) const
+{
+	// A-scans are listed in their original order to keep memory access sequential
+	std::sort(ascanIndices.begin(), ascanIndices.end());
+	lines.resize(static_cast<size_t>(ascanIndices.size()));
+	for (int i = 0; i < ascanIndices.size(); i++) {
+		lines[i] = rawData.line(static_cast<size_t>(ascanIndices.at(i)));
+	}
+	return OCTSignalProcessing::SpectrumView(rawData.base, rawData.lineStrideBytes, lines.size(), lines.data());
+}
+
+int DispersionEstimationEngine::numberOfAscansIn(const OCTSignalProcessing::SpectrumView &rawData) const
+{
+	return static_cast<int>(rawData.numberOfLines);
+}
+
+bool DispersionEstimationEngine::estimateWithCoordinateDescent(const OCTSignalProcessing::SpectrumView &rawData)
+{
+	// Conversion, DC removal and k-linearization do not depend on the dispersion coefficients, so they only run once
+	ProcessorController::PreparedSpectra spectra;
+	if (!this->processorController->prepareSpectra(rawData, spectra)) {
+		emit error(tr("Dispersion Estimator: Preparing spectra failed."));
+		return false;
+	}
+	if (this->params.metricCache) {
+		this->metricCache.setContext(rawData, this->processorController->settings_, this->params);
+	}
+
+	// Coefficients d2 to dN start in the center of their ranges
+	int highestOrder = qBound(3, this->params.highestDispersionOrder, MAX_DISPERSION_ORDER);
+	int numberOfCoefficients = highestOrder - 1;
+	qreal samples = static_cast<qreal>(qMax(1, this->params.numberOfDispersionSamples));
+	ParallelMetricEvaluator::CoefficientVector coefficients(numberOfCoefficients);
+	for (int c = 0; c < numberOfCoefficients; c++) {
+		coefficients[c] = (this->params.dispersionRangeStart(c + 2) + this->params.dispersionRangeEnd(c + 2)) / 2.0;
+	}
+
+	// Windows are halved after every cycle until the sample spacing is as fine as the one of a full sweep
+	int cycles = 1 + qMax(0, qCeil(std::log2(samples / (COORDINATE_SAMPLES_PER_LINE - 1))));
+	this->totalCandidates = cycles * numberOfCoefficients * COORDINATE_SAMPLES_PER_LINE;
+	this->descendCoordinates(spectra, coefficients, numberOfCoefficients, cycles);
+
+	this->bestD2 = coefficients.at(0);
+	this->bestD3 = coefficients.at(1);
+	this->bestHigherOrderCoefficients.clear();
+	bool hasHigherOrders = false;
+	for (int c = 2; c < numberOfCoefficients; c++) {
+		this->bestHigherOrderCoefficients.append(coefficients.at(c));
+		hasHigherOrders = hasHigherOrders || coefficients.at(c) != 0.0;
+	}
+
+	// OCTproZ only applies d2 and d3, but these are tuned for the higher orders of the fit. The applied pair is searched
+	// again with d4 and d5 at 0, the full fit is only reported.
+	if (hasHigherOrders && !this->isCancellationRequested()) {
+		QString fullFit = tr("d2: ") + QString::number(this->bestD2) + tr(", d3: ") + QString::number(this->bestD3);
+		for (int c = 2; c < numberOfCoefficients; c++) {
+			fullFit += tr(", d") + QString::number(c + 2) + ": " + QString::number(coefficients.at(c));
+		}
+		emit info(tr("Dispersion Estimator: Full fit ") + fullFit + tr(". d2 and d3 are estimated again without higher orders, since OCTproZ only applies d2 and d3."));
+		this->bestHigherOrderCoefficients.clear();
+		for (int c = 0; c < numberOfCoefficients; c++) {
+			coefficients[c] = c < 2 ? (this->params.dispersionRangeStart(c + 2) + this->params.dispersionRangeEnd(c + 2)) / 2.0 : 0.0;
+		}
+		this->totalCandidates += cycles * 2 * COORDINATE_SAMPLES_PER_LINE;
+		this->descendCoordinates(spectra, coefficients, 2, cycles);
+		this->bestD2 = coefficients.at(0);
+		this->bestD3 = coefficients.at(1);
+	}
+	return true;
+}
+
+void DispersionEstimationEngine::descendCoordinates(const ProcessorController::PreparedSpectra &spectra, ParallelMetricEvaluator::CoefficientVector &coefficients, int numberOfSearchedCoefficients, int cycles)
+{
+	// Line searches start with windows that cover the whole ranges, coefficients after the searched ones stay fixed
+	QVector<qreal> windows(numberOfSearchedCoefficients);
+	for (int c = 0; c < numberOfSearchedCoefficients; c++) {
+		windows[c] = qAbs(this->params.dispersionRangeEnd(c + 2) - this->params.dispersionRangeStart(c + 2)) / 2.0;
+	}
+
+	for (int cycle = 0; cycle < cycles; cycle++) {
+		for (int c = 0; c < numberOfSearchedCoefficients; c++) {
+			if (this->isCancellationRequested()) {
+				return;
+			}
+			QVector<ParallelMetricEvaluator::CoefficientVector> candidates(COORDINATE_SAMPLES_PER_LINE, coefficients);
+			for (int i = 0; i < COORDINATE_SAMPLES_PER_LINE; i++) {
+				candidates[i][c] = coefficients.at(c) + windows.at(c) * (2.0 * i / (COORDINATE_SAMPLES_PER_LINE - 1) - 1.0);
+			}
+			QVector<bool> success;
+			QVector<float> metricValues = this->evaluatePreparedCandidates(spectra, candidates, success);
+
+			std::vector<double> lineCoeffs;
+			std::vector<double> lineMetricValues;
+			for (int i = 0; i < COORDINATE_SAMPLES_PER_LINE; i++) {
+				if (!success.at(i)) {
+					continue;
+				}
+				lineCoeffs.push_back(candidates.at(i).at(c));
+				lineMetricValues.push_back(metricValues.at(i));
+				// Only d2 and d3 have a curve in the plot
+				if (c < 2) {
+					this->queueProgress(candidates.at(i).at(c), metricValues.at(i), c == 0);
+				}
+			}
+			this->evaluatedCandidates += COORDINATE_SAMPLES_PER_LINE;
+			this->flushProgress(false);
+			if (lineCoeffs.empty()) {
+				continue;
+			}
+
+			PeakFitter::Peak1D peak = PeakFitter::fitParabola(lineCoeffs, lineMetricValues);
+			coefficients[c] = this->isPeakFitting ? peak.position : lineCoeffs.at(std::max_element(lineMetricValues.begin(), lineMetricValues.end()) - lineMetricValues.begin());
+			if (c == 0) {
+				this->bestMetricValueD2 = static_cast<float>(peak.value);
+				this->curvatureD2 = peak.curvature;
+			} else if (c == 1) {
+				this->bestMetricValueD3 = static_cast<float>(peak.value);
+				this->curvatureD3 = peak.curvature;
+			}
+		}
+		for (qreal &window : windows) {
+			window *= 0.5;
+		}
+	}
+}
+
+QVector<float> DispersionEstimationEngine::evaluatePreparedCandidates(const ProcessorController::PreparedSpectra &spectra, const QVector<ParallelMetricEvaluator::CoefficientVector> &candidates, QVector<bool> &success)
+{
+	// The cache context is set by the caller from the raw data the spectra were prepared from
+	QVector<float> metricValues(candidates.size(), 0.0f);
+	success.fill(false, candidates.size());
+	QVector<ParallelMetricEvaluator::CoefficientVector> uncachedCandidates;
+	QVector<int> uncachedIndices;
+	for (int i = 0; i < candidates.size(); i++) {
+		if (this->params.metricCache && this->metricCache.lookup(candidates.at(i), metricValues[i])) {
+			success[i] = true;
+		} else {
+			uncachedCandidates.append(candidates.at(i));
+			uncachedIndices.append(i);
+		}
+	}
+
+	QVector<bool> uncachedSuccess;
+	QVector<float> uncachedMetricValues = this->computePreparedCandidates(spectra, uncachedCandidates, uncachedSuccess);
+	for (int i = 0; i < uncachedIndices.size(); i++) {
+		int index = uncachedIndices.at(i);
+		metricValues[index] = uncachedMetricValues.at(i);
+		success[index] = uncachedSuccess.at(i);
+		if (this->params.metricCache && uncachedSuccess.at(i)) {
+			this->metricCache.insert(uncachedCandidates.at(i), uncachedMetricValues.at(i));
+		}
+	}
+	return metricValues;
+}
+
+QVector<float> DispersionEstimationEngine::computePreparedCandidates(const ProcessorController::PreparedSpectra &spectra, const QVector<ParallelMetricEvaluator::CoefficientVector> &candidates, QVector<bool> &success)
+{
+	if (candidates.isEmpty()) {
+		success.clear();
+		return QVector<float>();
+	}
+	if (this->params.parallelEvaluation) {
+		return this->parallelEvaluator.evaluatePrepared(spectra, candidates, success);
+	}
+
+	int samplesPerLine = static_cast<int>(this->processorController->settings_.samplesPerSpectrum / 2);
+	QVector<float> metricValues(candidates.size(), 0.0f);
+	success.fill(false, candidates.size());
+	for (int i = 0; i < candidates.size(); i++) {
+		TraceScope trace("candidate", "evaluation");
+		for (int j = 0; j < candidates.at(i).size(); j++) {
+			this->processorController->setDispersionCoefficient(j + 2, candidates.at(i).at(j));
+		}
+		QVector<float> outputData;
+		if (this->processorController->processPreparedSpectra(spectra, outputData)) {
+			metricValues[i] = this->calculator.calculateMetric(outputData, samplesPerLine);
+			success[i] = true;
+		}
+	}
+	return metricValues;
+}
 
-	emit statusUpdate(tr("Ready for next operation."));
+float DispersionEstimationEngine::evaluateMetricGradient(const OCTSignalProcessing::SpectrumView &rawData, qreal d2, qreal d3, std::vector<float> &gradient, bool *ok)
+{
+	TraceScope trace("candidate_gradient", "evaluation");
+	this->processorController->setDispersionCoefficients(d2, d3);
+	float metricValue = 0.0f;
+	bool success = this->processorController->processIntensityMetricGradient(rawData, this->params.numberOfAscanSamplesToIgnore, {2, 3}, metricValue, gradient);
+	if (ok != nullptr) {
+		*ok = success;
+	}
+	if (!success) {
+		VERBOSE_DEBUG("Processing failed!");
+		return 0.0f;
+	}
+	return metricValue;
 }
 
-void DispersionEstimationEngine::processDispersionMetric(QByteArray &rawData, qreal &d2, qreal &d3, qreal stepSize, bool isD2)
+void DispersionEstimationEngine::clearSamples()
 {
-	// Update the coefficient being tested
+	this->sampledD2.clear();
+	this->sampledD3.clear();
+	this->sampledMetric.clear();
+}
+
+void DispersionEstimationEngine::refineSweepPeak(const std::vector<double> &sampledCoeffs, double &bestCoeff, double &curvature)
+{
+	PeakFitter::Peak1D peak = PeakFitter::fitParabola(sampledCoeffs, this->sampledMetric);
+	if (!peak.valid) {
+		curvature = 0;
+		return;
+	}
+	bestCoeff = peak.position;
+	curvature = peak.curvature;
+}
+
+void DispersionEstimationEngine::refineJointPeak()
+{
+	// Distances between samples are normalized by one sweep step so that d2 and d3 contribute equally
+	qreal samples = static_cast<qreal>(qMax(1, this->params.numberOfDispersionSamples));
+	qreal scaleD2 = qMax(qAbs(this->params.d2end - this->params.d2start) / samples, 1e-9);
+	qreal scaleD3 = qMax(qAbs(this->params.d3end - this->params.d3start) / samples, 1e-9);
+
+	PeakFitter::Peak2D peak = PeakFitter::fitQuadraticSurface(this->sampledD2, this->sampledD3, this->sampledMetric, scaleD2, scaleD3);
+	if (!peak.valid) {
+		this->curvatureD2 = 0;
+		this->curvatureD3 = 0;
+		return;
+	}
+	this->bestD2 = peak.x;
+	this->bestD3 = peak.y;
+	this->curvatureD2 = peak.curvatureXX;
+	this->curvatureD3 = peak.curvatureYY;
+}
+
+float DispersionEstimationEngine::evaluateMetric(const OCTSignalProcessing::SpectrumView &rawData, qreal d2, qreal d3, bool *ok)
+{
+	if (!this->params.metricCache) {
+		return this->computeMetric(rawData, d2, d3, ok);
+	}
+
+	this->metricCache.setContext(rawData, this->processorController->settings_, this->params);
+	QVector<qreal> coefficients = {d2, d3};
+	float metricValue = 0.0f;
+	if (this->metricCache.lookup(coefficients, metricValue)) {
+		if (ok != nullptr) {
+			*ok = true;
+		}
+		return metricValue;
+	}
+
+	bool success = false;
+	metricValue = this->computeMetric(rawData, d2, d3, &success);
+	if (success) {
+		this->metricCache.insert(coefficients, metricValue);
+	}
+	if (ok != nullptr) {
+		*ok = success;
+	}
+	return metricValue;
+}
+
+float DispersionEstimationEngine::computeMetric(const OCTSignalProcessing::SpectrumView &rawData, qreal d2, qreal d3, bool *ok)
+{
+	// Single evaluations on pooled frames are spread over the worker threads frame by frame
+	if (this->pooledFrames > 1 && this->params.parallelEvaluation) {
+		bool success = false;
+		float metricValue = this->parallelEvaluator.evaluateFrames(rawData, qMakePair(d2, d3), this->pooledFrames, success);
+		if (ok != nullptr) {
+			*ok = success;
+		}
+		return metricValue;
+	}
+
+	// Update the coefficients being tested
+	TraceScope trace("candidate", "evaluation");
 	this->processorController->setDispersionCoefficients(d2, d3);
 
-	// Process QByteArray with raw data
+	// Process raw data
 	QVector<float> outputData;
-	qDebug() << "Processing OCT data...";
-	emit statusUpdate(tr("Processing OCT data..."));
+	VERBOSE_DEBUG("Processing OCT data...");
 	bool success = this->processorController->processData(rawData, outputData);
+	if (ok != nullptr) {
+		*ok = success;
+	}
 	if (!success) {
-		qDebug() << "Processing failed!";
+		VERBOSE_DEBUG("Processing failed!");
 		emit statusUpdate(tr("Processing Ofailed"));
-		return;
+		return 0.0f;
 	}
 
 	// Calculate Ascan sharpness metric
-	qDebug() << "Calculating metric value...";
+	VERBOSE_DEBUG("Calculating metric value...");
 	int samplesPerLine = static_cast<int>(this->processorController->settings_.samplesPerSpectrum / 2);
-	float metricValue = this->calculator.calculateMetric(outputData, samplesPerLine);
+	return this->calculator.calculateMetric(outputData, samplesPerLine);
+}
+
+QVector<float> DispersionEstimationEngine::evaluateCandidates(const OCTSignalProcessing::SpectrumView &rawData, const QVector<ParallelMetricEvaluator::Candidate> &candidates, QVector<bool> &success)
+{
+	if (this->params.parallelEvaluation) {
+		if (!this->params.metricCache) {
+			return this->parallelEvaluator.evaluate(rawData, candidates, success);
+		}
+
+		// Only candidates that are not in the cache are handed to the workers
+		this->metricCache.setContext(rawData, this->processorController->settings_, this->params);
+		QVector<float> metricValues(candidates.size(), 0.0f);
+		success.fill(true, candidates.size());
+		QVector<ParallelMetricEvaluator::Candidate> uncachedCandidates;
+		QVector<int> uncachedIndices;
+		for (int i = 0; i < candidates.size(); i++) {
+			if (!this->metricCache.lookup({candidates.at(i).first, candidates.at(i).second}, metricValues[i])) {
+				uncachedCandidates.append(candidates.at(i));
+				uncachedIndices.append(i);
+			}
+		}
+		if (uncachedCandidates.isEmpty()) {
+			return metricValues;
+		}
+		QVector<bool> uncachedSuccess;
+		QVector<float> uncachedMetricValues = this->parallelEvaluator.evaluate(rawData, uncachedCandidates, uncachedSuccess);
+		for (int i = 0; i < uncachedIndices.size(); i++) {
+			int index = uncachedIndices.at(i);
+			metricValues[index] = uncachedMetricValues.at(i);
+			success[index] = uncachedSuccess.at(i);
+			if (uncachedSuccess.at(i)) {
+				this->metricCache.insert({uncachedCandidates.at(i).first, uncachedCandidates.at(i).second}, uncachedMetricValues.at(i));
+			}
+		}
+		return metricValues;
+	}
+
+	QVector<float> metricValues(candidates.size());
+	success.resize(candidates.size());
+	for (int i = 0; i < candidates.size(); i++) {
+		bool ok = false;
+		metricValues[i] = this->evaluateMetric(rawData, candidates.at(i).first, candidates.at(i).second, &ok);
+		success[i] = ok;
+	}
+	return metricValues;
+}
+
+void DispersionEstimationEngine::sweepCandidates(const OCTSignalProcessing::SpectrumView &rawData, const QVector<ParallelMetricEvaluator::Candidate> &candidates, bool isD2)
+{
+	// Candidates are evaluated in batches, results of each batch are streamed to the GUI before the next batch starts
+	int batchSize = 1;
+	if (this->params.parallelEvaluation) {
+		batchSize = this->parallelEvaluator.getThreadCount() * CANDIDATES_PER_THREAD_AND_BATCH;
+	}
+
+	for (int batchStart = 0; batchStart < candidates.size(); batchStart += batchSize) {
+		if (this->isCancellationRequested()) {
+			return;
+		}
+		QVector<ParallelMetricEvaluator::Candidate> batch = candidates.mid(batchStart, batchSize);
+		QVector<bool> success;
+		QVector<float> metricValues = this->evaluateCandidates(rawData, batch, success);
+		for (int i = 0; i < batch.size(); i++) {
+			if (success.at(i)) {
+				this->recordSweepResult(batch.at(i).first, batch.at(i).second, metricValues.at(i), isD2);
+			}
+		}
+		this->evaluatedCandidates += batch.size();
+		this->flushProgress(false);
+	}
+	this->flushProgress(true);
+}
+
+void DispersionEstimationEngine::recordSweepResult(qreal d2, qreal d3, float metricValue, bool isD2)
+{
+	this->sampledD2.push_back(d2);
+	this->sampledD3.push_back(d3);
+	this->sampledMetric.push_back(metricValue);
 
 	// Emit metric value signal based on the coefficient being changed
 	if (isD2) {
@@ -138,54 +1228,60 @@ void DispersionEstimationEngine::processDispersionMetric(QByteArray &rawData, qr
 			this->bestMetricValueD2 = metricValue;
 			this->bestD2 = d2;
 		}
-		emit metricValueCalculatedD2(d2, metricValue);
-		d2 += stepSize;
+		this->queueProgress(d2, metricValue, true);
 	} else {
 		if(this->bestMetricValueD3 < metricValue){
 			this->bestMetricValueD3 = metricValue;
 			this->bestD3 = d3;
 		}
-		emit metricValueCalculatedD3(d3, metricValue);
-		d3 += stepSize;
+		this->queueProgress(d3, metricValue, false);
 	}
+}
 
-	QCoreApplication::processEvents();
+void DispersionEstimationEngine::queueProgress(qreal coeff, float metricValue, bool isD2)
+{
+	if (isD2) {
+		this->pendingPointsD2.append(QPointF(coeff, static_cast<qreal>(metricValue)));
+	} else {
+		this->pendingPointsD3.append(QPointF(coeff, static_cast<qreal>(metricValue)));
+	}
 }
 
-QVector<float> DispersionEstimationEngine::processFirstLineOnly(QByteArray &rawData, qreal d2, qreal d3)
+void DispersionEstimationEngine::flushProgress(bool force)
+{
+	if (!force && this->progressTimer.elapsed() < PROGRESS_UPDATE_INTERVAL_MS) {
+		return;
+	}
+	this->progressTimer.restart();
+
+	if (!this->pendingPointsD2.isEmpty()) {
+		emit metricValuesCalculatedD2(this->pendingPointsD2);
+		this->pendingPointsD2.clear();
+	}
+	if (!this->pendingPointsD3.isEmpty()) {
+		emit metricValuesCalculatedD3(this->pendingPointsD3);
+		this->pendingPointsD3.clear();
+	}
+	emit statusUpdate(tr("Processing OCT data... ") + QString::number(this->evaluatedCandidates) + "/" + QString::number(this->totalCandidates));
+}
+
+QVector<float> DispersionEstimationEngine::processFirstLineOnly(const OCTSignalProcessing::SpectrumView &rawData, qreal d2, qreal d3, const QVector<double> &higherOrderCoefficients)
 {
 	this->processorController->setDispersionCoefficients(d2, d3);
-	size_t originalSpectraPerFrame = this->processorController->settings_.spectraPerFrame;
-	size_t originalFramesPerVolume = this->processorController->settings_.framesPerVolume;
-	this->processorController->settings_.spectraPerFrame = 1;
-	this->processorController->settings_.framesPerVolume = 1;
-	size_t bytesPerSample = static_cast<size_t>(ceil(static_cast<double>(this->processorController->settings_.bitDepth) / 8.0));
-	size_t samplesPerSpectrum = this->processorController->settings_.samplesPerSpectrum;
-	size_t lineSizeBytes = samplesPerSpectrum * bytesPerSample;
-	
-	unsigned int centerAscans = qMin(static_cast<unsigned int>(this->params.numberOfCenterAscans), static_cast<unsigned int>(originalSpectraPerFrame));
-	unsigned int offsetAscans = 0;
-	
-	if (centerAscans < static_cast<unsigned int>(originalSpectraPerFrame)) {
-		offsetAscans = static_cast<unsigned int>((originalSpectraPerFrame - static_cast<size_t>(centerAscans)) / 2);
-	}
-	
-	size_t offsetBytes = static_cast<size_t>(offsetAscans) * lineSizeBytes;
-	
-	QByteArray firstCenterAscanData(
-		rawData.constData() + offsetBytes,
-		static_cast<int>(lineSizeBytes)
-	);
-	
+	for (int order = 4; order <= MAX_DISPERSION_ORDER; order++) {
+		int index = order - 4;
+		this->processorController->setDispersionCoefficient(order, index < higherOrderCoefficients.size() ? higherOrderCoefficients.at(index) : 0.0);
+	}
+
+	// The first evaluated A-scan is processed in place, a single spectrum is processed as one frame
+	OCTSignalProcessing::SpectrumView firstCenterAscanData = rawData.subView(0, qMin(static_cast<size_t>(1), rawData.numberOfLines));
+
 	QVector<float> outputData;
-	qDebug() << "Processing first center A-scan...";
+	VERBOSE_DEBUG("Processing first center A-scan...");
 	bool success = this->processorController->processData(firstCenterAscanData, outputData);
-	this->processorController->settings_.spectraPerFrame = originalSpectraPerFrame;
-	this->processorController->settings_.framesPerVolume = originalFramesPerVolume;
-	
+
 	if (!success) {
-		qDebug() << "Processing failed!";
-		emit statusUpdate(tr("Processing results failed!"));
+		emit error(tr("Dispersion Estimator: Processing the preview A-scan failed."));
 		return QVector<float>();
 	}
 	return outputData;
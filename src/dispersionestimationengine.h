@@ -4,12 +4,22 @@
 #include <QObject>
 #include <QVector>
 #include <QRect>
-#include <QApplication>
+#include <QAtomicInt>
 #include <QtMath>
 #include <QPair>
+#include <QPointF>
+#include <QElapsedTimer>
 #include "dispersionestimatorparameters.h"
 #include "octprocessor/processorcontroller.h"
+#include "octprocessor/spectrumview.h"
 #include "ascanmetriccalculator.h"
+#include "neldermeadoptimizer.h"
+#include "lbfgsoptimizer.h"
+#include "peakfitter.h"
+#include "parallelmetricevaluator.h"
+#include "metriccache.h"
+#include "estimationrunreport.h"
+#include "ascanselector.h"
 
 
 class DispersionEstimationEngine : public QObject
@@ -18,25 +28,105 @@ class DispersionEstimationEngine : public QObject
 public:
 	explicit DispersionEstimationEngine(QObject *parent = nullptr);
 
+	// Thread-safe, may be called directly from any thread while an estimation is running.
+	// The running estimation stops at the next candidate batch and does not apply its result.
+	void requestCancellation();
+	bool isEstimationRunning() const;
+
+	// Processing settings and the custom resampling curve are loaded from these files at the start of every estimation.
+	// By default these are the files of the running OCTproZ instance.
+	void setSettingsFilePaths(const QString &settingsFilePath, const QString &resamplingCurveFilePath);
+
+	// The report of every finished estimation is appended to this file. Empty (default) disables the log file.
+	void setRunReportLogFilePath(const QString &filePath);
+
 
 private:
 	bool isPeakFitting;
+	QAtomicInt cancellationRequested;
+	QAtomicInt estimationRunning;
 	DispersionEstimatorParameters params;
 	ProcessorController *processorController;
+	QString settingsFilePath;
+	QString resamplingCurveFilePath;
+	QString runReportLogFilePath;
+	EstimationRunReport runReport;
 	AscanMetricCalculator calculator;
+	ParallelMetricEvaluator parallelEvaluator;
+	MetricCache metricCache;
+	int pooledFrames;
+	std::vector<size_t> ascanLines; // frame buffer lines of the evaluated A-scans if several frames are pooled or the best A-scans are selected
+	AscanSelector ascanSelector;
+	int saturatedAscans; // selected A-scans with clipped samples
 	float bestMetricValueD2;
 	float bestMetricValueD3;
 	double bestD2;
 	double bestD3;
 	double calculatedD1;
+	double curvatureD2;
+	double curvatureD3;
+	QVector<double> bestHigherOrderCoefficients; // d4, d5, ...
+
+	// Live tracking state: coefficients currently applied in OCTproZ and half widths of the search windows around them
+	bool hasTrackingStart;
+	double trackedD2;
+	double trackedD3;
+	double trackingWindowD2;
+	double trackingWindowD3;
+	bool trackingFailing; // the error of a failing tracking run is only reported once until tracking works again
+
+	// Metric values are collected and sent to the GUI in chunks to limit cross-thread signal traffic and replots
+	QVector<QPointF> pendingPointsD2;
+	QVector<QPointF> pendingPointsD3;
+	QElapsedTimer progressTimer;
+	int evaluatedCandidates;
+	int totalCandidates;
+
+	// Samples of the current search, used for sub-sample peak fitting
+	std::vector<double> sampledD2;
+	std::vector<double> sampledD3;
+	std::vector<double> sampledMetric;
 
-	void processDispersionMetric(QByteArray &rawData, qreal &d2, qreal &d3, qreal stepSize, bool isD2);
-	QVector<float> processFirstLineOnly(QByteArray &rawData, qreal d2, qreal d3);
+	float evaluateMetric(const OCTSignalProcessing::SpectrumView &rawData, qreal d2, qreal d3, bool *ok = nullptr);
+	float computeMetric(const OCTSignalProcessing::SpectrumView &rawData, qreal d2, qreal d3, bool *ok = nullptr);
+	QVector<float> evaluateCandidates(const OCTSignalProcessing::SpectrumView &rawData, const QVector<ParallelMetricEvaluator::Candidate> &candidates, QVector<bool> &success);
+	void sweepCandidates(const OCTSignalProcessing::SpectrumView &rawData, const QVector<ParallelMetricEvaluator::Candidate> &candidates, bool isD2);
+	void recordSweepResult(qreal d2, qreal d3, float metricValue, bool isD2);
+	void estimateWithSequentialSweep(const OCTSignalProcessing::SpectrumView &rawData);
+	void estimateWithNelderMead(const OCTSignalProcessing::SpectrumView &rawData);
+	void estimateWithGradient(const OCTSignalProcessing::SpectrumView &rawData);
+	void estimateWithSuccessiveHalving(const OCTSignalProcessing::SpectrumView &rawData);
+	bool estimateWithCoordinateDescent(const OCTSignalProcessing::SpectrumView &rawData); // false if the spectra could not be prepared
+	void descendCoordinates(const ProcessorController::PreparedSpectra &spectra, ParallelMetricEvaluator::CoefficientVector &coefficients, int numberOfSearchedCoefficients, int cycles);
+	QVector<float> evaluatePreparedCandidates(const ProcessorController::PreparedSpectra &spectra, const QVector<ParallelMetricEvaluator::CoefficientVector> &candidates, QVector<bool> &success);
+	QVector<float> computePreparedCandidates(const ProcessorController::PreparedSpectra &spectra, const QVector<ParallelMetricEvaluator::CoefficientVector> &candidates, QVector<bool> &success);
+	void refineHalvingPeak(const OCTSignalProcessing::SpectrumView &rawData, qreal gridStart, qreal stepSize, bool isD2);
+	void halveCandidates(const OCTSignalProcessing::SpectrumView &rawData, QVector<ParallelMetricEvaluator::Candidate> candidates, bool isD2);
+	QVector<QPair<int, int>> halvingSchedule(int numberOfCandidates, int numberOfAscans) const;
+	// View of the given A-scans of rawData, the line list is stored in lines
+	OCTSignalProcessing::SpectrumView selectAscans(const OCTSignalProcessing::SpectrumView &rawData, QVector<int> ascanIndices, std::vector<size_t> &lines) const;
+	int numberOfAscansIn(const OCTSignalProcessing::SpectrumView &rawData) const;
+	float evaluateMetricGradient(const OCTSignalProcessing::SpectrumView &rawData, qreal d2, qreal d3, std::vector<float> &gradient, bool *ok = nullptr);
+	bool isCancellationRequested() const;
+	void finishPhase(EstimationRunReport::Phase phase, const QElapsedTimer &phaseTimer);
+	void recordCacheAndThreadStatistics();
+	// Gives the workspace arenas of the run back, optionally after recording their sizes in the run report.
+	// Tracking runs keep them, the next frame follows shortly.
+	void releaseWorkspaces(bool recordStatistics);
+	void queueProgress(qreal coeff, float metricValue, bool isD2);
+	void flushProgress(bool force);
+	void clearSamples();
+	void refineSweepPeak(const std::vector<double> &sampledCoeffs, double &bestCoeff, double &curvature);
+	void refineJointPeak();
+	OCTSignalProcessing::SpectrumView prepareProcessing(void* frameBuffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int numberOfFrames);
+	double trackCoefficient(const OCTSignalProcessing::SpectrumView &rawData, double d2, double d3, bool isD2, float &centerMetricValue, float &bestMetricValue, bool &ok);
+	QVector<float> processFirstLineOnly(const OCTSignalProcessing::SpectrumView &rawData, qreal d2, qreal d3, const QVector<double> &higherOrderCoefficients = QVector<double>());
 
 signals:
-	void metricValueCalculatedD2(float d2, float metricValue);
-	void metricValueCalculatedD3(float d3, float metricValue);
+	void metricValuesCalculatedD2(QVector<QPointF> d2AndMetricValues);
+	void metricValuesCalculatedD3(QVector<QPointF> d3AndMetricValues);
 	void estimationProcessStarted();
+	void estimationProcessStopped();
 	void info(QString);
 	void error(QString);
 	void statusUpdate(const QString &status);
@@ -47,10 +137,14 @@ signals:
 	void bestD2Estimated(double estimatedD2);
 	void bestD3Estimated(double estimateD3);
 	void d1Calculated(double d1);
+	void higherOrderCoefficientsEstimated(QVector<double> coefficients); // d4, d5, ... empty if only d2 and d3 were estimated or d2 and d3 were estimated again without them
 	void dispersionEstimationReady(double* d0, double* d1, double* d2, double* d3);
+	void runReportReady(EstimationRunReport report);
 
 public slots:
-	void startDispersionEstimation(void* frameBuffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
+	// frameBuffer contains numberOfFrames consecutive frames, the center A-scans of all of them are evaluated together
+	void startDispersionEstimation(void* frameBuffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int numberOfFrames);
+	void trackDispersion(void* frameBuffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
 	void setParams(DispersionEstimatorParameters params);
 };
 
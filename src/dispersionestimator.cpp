@@ -1,4 +1,5 @@
 #include "dispersionestimator.h"
+#include "tracerecorder.h"
 
 
 DispersionEstimator::DispersionEstimator()
@@ -6,16 +7,36 @@ DispersionEstimator::DispersionEstimator()
 	form(new DispersionEstimatorForm()),
 	estimationEngine(new DispersionEstimationEngine()),
 	frameNr(0),
-	active(false),
-	isCalculating(false),
+	bufferNr(0),
+	active(0),
+	liveTracking(0),
+	nthBuffer(10),
+	pooledFrames(1),
+	acquisitionCommands(0),
 	singleFetch(false),
-	copyBufferId(-1),
-	bytesPerFrameRaw(0),
-	bytesPerFrameProcessed(0),
-	lostBuffersProcessed(0)
+	liveTrackingBufferCounter(0),
+	pooledFramesCollected(0),
+	frameWriteBuffer(nullptr),
+	frameRing(FRAME_RING_CAPACITY),
+	frameRingPollTimer(nullptr),
+	discardQueuedFrames(0),
+	droppedFramesAtLastTracking(0),
+	acquiredFramesPerBuffer(0),
+	acquiredBuffersPerVolume(0),
+	invalidDimensionsCount(0),
+	collectedPooledFrames(0),
+	reportedFramesPerBuffer(0),
+	reportedBuffersPerVolume(0),
+	reportedInvalidDimensions(0),
+	reportedCollectedFrames(0),
+	reportedDroppedOldest(0),
+	reportedDroppedNewest(0)
 {
 	qRegisterMetaType<DispersionEstimatorParameters>("DispersionEstimatorParameters");
 	qRegisterMetaType<QVector<float>>("QVector<float>");
+	qRegisterMetaType<QVector<QPointF>>("QVector<QPointF>");
+	qRegisterMetaType<QVector<double>>("QVector<double>");
+	qRegisterMetaType<EstimationRunReport>("EstimationRunReport");
 
 	this->setType(EXTENSION);
 	this->displayStyle = SEPARATE_WINDOW;
@@ -24,7 +45,11 @@ DispersionEstimator::DispersionEstimator()
 
 	this->setupGuiConnections();
 	this->setupDispersionEstimatorEngine();
-	this->initializeFrameBuffers();
+
+	//the acquisition thread must not allocate, so it does not emit signals with strings or for drops. Its status is polled.
+	this->acquisitionStatusTimer.setInterval(ACQUISITION_STATUS_POLL_INTERVAL_MS);
+	connect(&this->acquisitionStatusTimer, &QTimer::timeout, this, &DispersionEstimator::reportAcquisitionStatus);
+	this->acquisitionStatusTimer.start();
 }
 
 DispersionEstimator::~DispersionEstimator() {
@@ -32,9 +57,6 @@ DispersionEstimator::~DispersionEstimator() {
 	estimatorEngineThread.wait();
 
 	delete this->form;
-
-	this->releaseFrameBuffers(this->frameBuffersProcessed);
-	this->releaseFrameBuffers(this->frameBuffersRaw);
 }
 
 QWidget* DispersionEstimator::getWidget() {
@@ -43,12 +65,12 @@ QWidget* DispersionEstimator::getWidget() {
 
 void DispersionEstimator::activateExtension() {
 	//this method is called by OCTproZ as soon as user activates the extension. If the extension controls hardware components, they can be prepared, activated, initialized or started here.
-	this->active = true;
+	this->active.storeRelease(1);
 }
 
 void DispersionEstimator::deactivateExtension() {
 	//this method is called by OCTproZ as soon as user deactivates the extension. If the extension controls hardware components, they can be deactivated, resetted or stopped here.
-	this->active = false;
+	this->active.storeRelease(0);
 }
 
 void DispersionEstimator::settingsLoaded(QVariantMap settings) {
@@ -65,63 +87,120 @@ void DispersionEstimator::setupGuiConnections() {
 	//store settings
 	connect(this->form, &DispersionEstimatorForm::paramsChanged, this, &DispersionEstimator::storeParameters);
 
+	//trace recording is shared by all threads, so it is switched here instead of in the engine
+	connect(this->form, &DispersionEstimatorForm::paramsChanged, this, [](DispersionEstimatorParameters params) {
+		TraceRecorder::instance().setEnabled(params.tracing);
+	});
+	connect(this->form, &DispersionEstimatorForm::paramsChanged, this, [this](DispersionEstimatorParameters params) {
+		this->frameRing.setDropPolicy(params.frameDropPolicy);
+	});
+	connect(this->form, &DispersionEstimatorForm::traceSaveRequested, this, [this]() {
+		this->saveTrace(TRACE_FILE_PATH);
+	});
+
 	//data acquisition settings inputs from the GUI
 	connect(this->form, &DispersionEstimatorForm::frameNrChanged, this, [this](int frameNr) {
-		this->frameNr = frameNr;
+		this->frameNr.storeRelease(frameNr);
 	});
 	connect(this->form, &DispersionEstimatorForm::bufferNrChanged, this, [this](int bufferNr) {
-		this->bufferNr = bufferNr;
+		this->bufferNr.storeRelease(bufferNr);
+	});
+	connect(this->form, &DispersionEstimatorForm::pooledFramesChanged, this, [this](int pooledFrames) {
+		this->pooledFrames.storeRelease(qMax(1, pooledFrames));
+		this->requestAcquisitionCommand(COMMAND_RESTART_COLLECTION);
 	});
 
 	connect(this->form, &DispersionEstimatorForm::singleFetchRequested, this, [this]() {
-		this->singleFetch = true;
+		//a new fetch replaces a running estimation, e.g. if the wrong frame has been fetched
+		if(this->estimationEngine->isEstimationRunning()){
+			this->estimationEngine->requestCancellation();
+		}
+		this->requestAcquisitionCommand(COMMAND_SINGLE_FETCH, COMMAND_STOP);
 		emit statusUpdate(tr("Waiting for data..."));
 	});
+	connect(this->form, &DispersionEstimatorForm::autoFetchRequested, this, [this](bool isRequested) {
+		this->liveTracking.storeRelease(isRequested ? 1 : 0);
+		this->requestAcquisitionCommand(COMMAND_RESTART_TRACKING);
+		emit statusUpdate(isRequested ? tr("Live tracking started.") : tr("Live tracking stopped."));
+	});
+	connect(this->form, &DispersionEstimatorForm::nthBufferChanged, this, [this](int nthBuffer) {
+		this->nthBuffer.storeRelease(nthBuffer);
+	});
+	connect(this->form, &DispersionEstimatorForm::stopRequested, this, [this]() {
+		this->requestAcquisitionCommand(COMMAND_STOP, COMMAND_SINGLE_FETCH);
+		this->discardQueuedFrames.storeRelease(1);
+		if(this->estimationEngine->isEstimationRunning()){
+			//the engine thread is busy with the estimation, so cancellation is requested directly instead of via a queued signal
+			this->estimationEngine->requestCancellation();
+			emit statusUpdate(tr("Stopping estimation..."));
+		} else {
+			emit statusUpdate(tr("Ready for next operation."));
+		}
+	});
 }
 
 void DispersionEstimator::setupDispersionEstimatorEngine() {
 	this->estimationEngine = new DispersionEstimationEngine();
+	this->estimatorEngineThread.setObjectName("Dispersion Estimator Engine");
+	this->estimationEngine->setRunReportLogFilePath(SETTINGS_DIR + "/dispersion_estimator_runs.log");
 	this->estimationEngine->moveToThread(&estimatorEngineThread);
 	connect(&estimatorEngineThread, &QThread::finished, this->estimationEngine, &QObject::deleteLater);
-	connect(this, &DispersionEstimator::newFrame, this->estimationEngine, &DispersionEstimationEngine::startDispersionEstimation);
+	//the acquisition thread must not post events, so the engine thread polls the frame ring for queued frames
+	this->frameRingPollTimer = new QTimer();
+	this->frameRingPollTimer->setInterval(FRAME_RING_POLL_INTERVAL_MS);
+	this->frameRingPollTimer->moveToThread(&estimatorEngineThread);
+	connect(this->frameRingPollTimer, &QTimer::timeout, this->estimationEngine, [this]() {
+		this->processQueuedFrames();
+	});
+	connect(&estimatorEngineThread, &QThread::started, this->frameRingPollTimer, [this]() {
+		this->frameRingPollTimer->start();
+	});
+	connect(&estimatorEngineThread, &QThread::finished, this->frameRingPollTimer, &QObject::deleteLater);
 	connect(this->form, &DispersionEstimatorForm::paramsChanged, this->estimationEngine, &DispersionEstimationEngine::setParams);
 	connect(this->estimationEngine, &DispersionEstimationEngine::info, this, &DispersionEstimator::info);
 	connect(this->estimationEngine, &DispersionEstimationEngine::error, this, &DispersionEstimator::error);
 	connect(this->estimationEngine, &DispersionEstimationEngine::estimationProcessStarted, this->form, &DispersionEstimatorForm::clearPlot);
-	connect(this->estimationEngine, &DispersionEstimationEngine::metricValueCalculatedD2, this->form, &DispersionEstimatorForm::addDataToD2Plot);
-	connect(this->estimationEngine, &DispersionEstimationEngine::metricValueCalculatedD3, this->form, &DispersionEstimatorForm::addDataToD3Plot);
+	connect(this->estimationEngine, &DispersionEstimationEngine::metricValuesCalculatedD2, this->form, &DispersionEstimatorForm::addDataToD2Plot);
+	connect(this->estimationEngine, &DispersionEstimationEngine::metricValuesCalculatedD3, this->form, &DispersionEstimatorForm::addDataToD3Plot);
 	connect(this->estimationEngine, &DispersionEstimationEngine::bestD2Estimated, this->form, &DispersionEstimatorForm::displayBestD2);
 	connect(this->estimationEngine, &DispersionEstimationEngine::bestD3Estimated, this->form, &DispersionEstimatorForm::displayBestD3);
 	connect(this->estimationEngine, &DispersionEstimationEngine::d1Calculated, this->form, &DispersionEstimatorForm::displayDerivedD1);
+	connect(this->estimationEngine, &DispersionEstimationEngine::higherOrderCoefficientsEstimated, this->form, &DispersionEstimatorForm::displayHigherOrderCoefficients);
 	connect(this->estimationEngine, &DispersionEstimationEngine::dispersionEstimationReady, this, &DispersionEstimator::setDispCompCoeffsRequest);
 
 	connect(this->estimationEngine, &DispersionEstimationEngine::ascanWithoutDispersionCalculated, this->form, &DispersionEstimatorForm::addAscanOneToPlot);
 	connect(this->estimationEngine, &DispersionEstimationEngine::ascanWithBestDispersionCalculated, this->form, &DispersionEstimatorForm::addAscanTwoToPlot);
 	connect(this->estimationEngine, &DispersionEstimationEngine::statusUpdate, this->form, &DispersionEstimatorForm::updateStatus);
+	connect(this->estimationEngine, &DispersionEstimationEngine::runReportReady, this->form, &DispersionEstimatorForm::displayRunReport);
+	connect(this, &DispersionEstimator::trackingFrameDispatched, this->form, &DispersionEstimatorForm::displayTrackingFrame);
+	connect(this, &DispersionEstimator::frameDropsChanged, this->form, &DispersionEstimatorForm::displayFrameDrops);
 	connect(this, &DispersionEstimator::statusUpdate, this->form, &DispersionEstimatorForm::updateStatus);
 
 	estimatorEngineThread.start();
-
-
-//todo parabolic peak fit, aber nicht hier sondern in estimator klasse
 }
 
-void DispersionEstimator::initializeFrameBuffers() {
-	this->frameBuffersRaw.resize(NUMBER_OF_BUFFERS);
-	this->frameBuffersProcessed.resize(NUMBER_OF_BUFFERS);
-	for(int i = 0; i < NUMBER_OF_BUFFERS; i++){
-		this->frameBuffersRaw[i] = nullptr;
-		this->frameBuffersProcessed[i] = nullptr;
+void DispersionEstimator::saveTrace(QString filePath) {
+	if(TraceRecorder::instance().eventCount() == 0){
+		emit info(this->name + ": " + tr("No trace events recorded. Enable \"Record trace\" first."));
+		return;
+	}
+	if(TraceRecorder::instance().writeChromeTrace(filePath)){
+		emit info(this->name + ": " + tr("Trace written to ") + filePath);
+	} else {
+		emit error(this->name + ": " + tr("Could not write trace to ") + filePath);
 	}
 }
 
-void DispersionEstimator::releaseFrameBuffers(QVector<void *> buffers) {
-	for (int i = 0; i < buffers.size(); i++) {
-		if (buffers[i] != nullptr) {
-			free(buffers[i]);
-			buffers[i] = nullptr;
-		}
+bool DispersionEstimator::isLiveTrackingDue() {
+	//use every n-th selected buffer, but not more often than the minimum tracking interval allows
+	this->liveTrackingBufferCounter++;
+	if(this->liveTrackingBufferCounter < static_cast<unsigned int>(qMax(1, this->nthBuffer.loadAcquire()))){
+		return false;
+	}
+	if(this->liveTrackingTimer.isValid() && this->liveTrackingTimer.elapsed() < LIVE_TRACKING_MIN_INTERVAL_MS){
+		return false;
 	}
+	return true;
 }
 
 void DispersionEstimator::storeParameters() {
@@ -131,62 +210,184 @@ void DispersionEstimator::storeParameters() {
 }
 
 void DispersionEstimator::rawDataReceived(void* buffer, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int framesPerBuffer, unsigned int buffersPerVolume, unsigned int currentBufferNr) {
-	if(this->active){
-		if((!this->isCalculating && this->singleFetch && this->rawGrabbingAllowed)){
-			//check if current buffer is selected. If it is not selected discard it and do nothing (just return).
-			if(this->bufferNr>static_cast<int>(buffersPerVolume-1)){
-				this->bufferNr = static_cast<int>(buffersPerVolume-1);
+	//runs on the acquisition thread. It must neither block nor allocate, so it does not emit signals. Queued frames are
+	//polled by the engine thread and everything the GUI shows is published through atomics and polled.
+	if(this->active.loadAcquire() != 0){
+		this->takeAcquisitionCommands();
+		if(((this->singleFetch || this->liveTracking.loadAcquire() != 0) && this->rawGrabbingAllowed)){
+			TraceScope trace("raw_data_received", "acquisition", true);
+			//the GUI updates the maximum frame and buffer number from these
+			this->acquiredFramesPerBuffer.storeRelease(static_cast<int>(framesPerBuffer));
+			this->acquiredBuffersPerVolume.storeRelease(static_cast<int>(buffersPerVolume));
+			if(bitDepth == 0 || samplesPerLine == 0 || linesPerFrame == 0 || framesPerBuffer == 0){
+				this->invalidDimensionsCount.ref();
+				return;
 			}
-			if(!(this->bufferNr == -1 || this->bufferNr == static_cast<int>(currentBufferNr))){
+
+			//check if current buffer is selected. If it is not selected discard it and do nothing (just return).
+			int bufferNr = qMin(this->bufferNr.loadAcquire(), static_cast<int>(buffersPerVolume-1));
+			if(!(bufferNr == -1 || bufferNr == static_cast<int>(currentBufferNr))){
 				return;
 			}
 
-			this->isCalculating = true;
+			//a requested single fetch has priority over live tracking
+			bool isTrackingFrame = !this->singleFetch;
+			if(isTrackingFrame && !this->isLiveTrackingDue()){
+				return;
+			}
 
-			//calculate size of single frame
+			//calculate size of single frame. A tracking frame needs one frame, a single fetch all frames that are pooled for one estimation
+			unsigned int pooledFrames = static_cast<unsigned int>(qMax(1, this->pooledFrames.loadAcquire()));
 			size_t bytesPerSample = static_cast<size_t>(ceil(static_cast<double>(bitDepth)/8.0));
 			size_t bytesPerFrame = samplesPerLine*linesPerFrame*bytesPerSample;
-
-			//check if number of frames per buffer has changed and emit maxFrames to update gui
-			if(this->framesPerBuffer != framesPerBuffer){
-				emit maxFrames(framesPerBuffer-1);
-				this->framesPerBuffer = framesPerBuffer;
-			}
-			//check if number of buffers per volume has changed and emit maxBuffers to update gui
-			if(this->buffersPerVolume != buffersPerVolume){
-				emit maxBuffers(buffersPerVolume-1);
-				this->buffersPerVolume = buffersPerVolume;
-			}
-
-			//check if buffer size changed and allocate buffer memory
-			if(this->frameBuffersRaw[0] == nullptr || this->bytesPerFrameProcessed != bytesPerFrame){
-				if(bitDepth == 0 || samplesPerLine == 0 || linesPerFrame == 0 || framesPerBuffer == 0){
-					emit error(this->name + ":  " + tr("Invalid data dimensions!"));
+			size_t bytesPerSlot = isTrackingFrame ? bytesPerFrame : bytesPerFrame*pooledFrames;
+
+			//get a slot of the frame ring. If there is none, the frame is dropped according to the drop policy and the next
+			//due frame is tried, a pending single fetch stays pending. A slot that is too small is grown by the engine thread.
+			if(isTrackingFrame || this->pooledFramesCollected == 0 || !this->frameRing.isWriting()){
+				this->pooledFramesCollected = 0;
+				this->frameWriteBuffer = this->frameRing.beginWrite(bytesPerSlot, isTrackingFrame);
+				if(this->frameWriteBuffer == nullptr){
 					return;
 				}
-				//(re)create copy buffers
-				if(this->frameBuffersRaw[0] != nullptr){
-					this->releaseFrameBuffers(this->frameBuffersRaw);
-				}
-				for (int i = 0; i < this->frameBuffersRaw.size(); i++) {
-					this->frameBuffersRaw[i] = static_cast<void*>(malloc(bytesPerFrame));
-				}
-				this->bytesPerFrameProcessed = bytesPerFrame;
+			}
+			if(isTrackingFrame){
+				this->liveTrackingBufferCounter = 0;
+				this->liveTrackingTimer.restart();
 			}
 
-			//copy single frame of received data and emit it for further processing
-			this->copyBufferId = (this->copyBufferId+1)%NUMBER_OF_BUFFERS;
+			//copy single frame of received data and queue it for further processing
 			char* frameInBuffer = static_cast<char*>(buffer);
-			if(this->frameNr>static_cast<int>(framesPerBuffer-1)){this->frameNr = static_cast<int>(framesPerBuffer-1);}
-			memcpy(this->frameBuffersRaw[this->copyBufferId], &(frameInBuffer[bytesPerFrame*this->frameNr]), bytesPerFrame);
-			emit newFrame(this->frameBuffersRaw[this->copyBufferId], bitDepth, samplesPerLine, linesPerFrame);
+			unsigned int frameNr = static_cast<unsigned int>(qBound(0, this->frameNr.loadAcquire(), static_cast<int>(framesPerBuffer-1)));
+			FrameRing::FrameInfo frameInfo = {bitDepth, samplesPerLine, linesPerFrame, 1, isTrackingFrame};
+			if(isTrackingFrame){
+				memcpy(this->frameWriteBuffer, &(frameInBuffer[bytesPerFrame*frameNr]), bytesPerFrame);
+				this->frameRing.commitWrite(frameInfo);
+				this->frameWriteBuffer = nullptr;
+				return;
+			}
 
-			this->isCalculating = false;
+			//frames of a single fetch are pooled. If all buffers are selected, the frames are spread over the buffers of a volume,
+			//otherwise they are taken from the selected buffer. Frames within a buffer are evenly spaced, starting at frameNr.
+			unsigned int framesStillNeeded = pooledFrames - this->pooledFramesCollected;
+			unsigned int framesFromThisBuffer = framesStillNeeded;
+			if(bufferNr == -1){
+				unsigned int buffers = qMax(1u, buffersPerVolume);
+				framesFromThisBuffer = (pooledFrames + buffers - 1) / buffers;
+			}
+			framesFromThisBuffer = qMin(qMin(framesFromThisBuffer, framesStillNeeded), framesPerBuffer);
+			for(unsigned int i = 0; i < framesFromThisBuffer; i++){
+				unsigned int frameIndex = (frameNr + i*framesPerBuffer/framesFromThisBuffer) % framesPerBuffer;
+				memcpy(&(this->frameWriteBuffer[bytesPerFrame*this->pooledFramesCollected]), &(frameInBuffer[bytesPerFrame*frameIndex]), bytesPerFrame);
+				this->pooledFramesCollected++;
+			}
+			if(this->pooledFramesCollected < pooledFrames){
+				this->collectedPooledFrames.storeRelease(static_cast<int>(this->pooledFramesCollected));
+				return;
+			}
+			frameInfo.numberOfFrames = this->pooledFramesCollected;
+			this->frameRing.commitWrite(frameInfo);
+			this->frameWriteBuffer = nullptr;
+			this->pooledFramesCollected = 0;
+			this->collectedPooledFrames.storeRelease(0);
 			this->singleFetch = false;
 		}
 	}
 }
 
+void DispersionEstimator::requestAcquisitionCommand(int command, int cancelledCommand) {
+	//runs on the GUI thread. A fetch cancels a pending stop and vice versa, so the acquisition thread never sees both.
+	if(cancelledCommand != 0){
+		this->acquisitionCommands.fetchAndAndOrdered(~cancelledCommand);
+	}
+	this->acquisitionCommands.fetchAndOrOrdered(command);
+}
+
+void DispersionEstimator::takeAcquisitionCommands() {
+	//runs on the acquisition thread, which owns the collection and tracking state
+	int commands = this->acquisitionCommands.fetchAndStoreOrdered(0);
+	if(commands == 0){
+		return;
+	}
+	if(commands & (COMMAND_SINGLE_FETCH | COMMAND_STOP | COMMAND_RESTART_COLLECTION)){
+		this->frameRing.abortWrite();
+		this->frameWriteBuffer = nullptr;
+		this->pooledFramesCollected = 0;
+		this->collectedPooledFrames.storeRelease(0);
+	}
+	if(commands & COMMAND_SINGLE_FETCH){
+		this->singleFetch = true;
+	}
+	if(commands & COMMAND_STOP){
+		this->singleFetch = false;
+	}
+	if(commands & COMMAND_RESTART_TRACKING){
+		this->liveTrackingBufferCounter = 0;
+		this->liveTrackingTimer.invalidate();
+	}
+}
+
+void DispersionEstimator::processQueuedFrames() {
+	//runs on the engine thread, takes out all frames that are waiting
+	this->frameRing.reserveSlotMemory();
+	FrameRing::FrameRef frame;
+	forever {
+		if(this->discardQueuedFrames.fetchAndStoreOrdered(0) != 0){
+			this->frameRing.discardWaiting();
+		}
+		if(!this->frameRing.takeNext(frame)){
+			break;
+		}
+		const FrameRing::FrameInfo &info = frame.info();
+		if(info.isTrackingFrame){
+			//the performance panel compares the rate of tracking runs with their duration
+			int droppedFrames = this->frameRing.getDroppedOldest() + this->frameRing.getDroppedNewest();
+			double intervalMs = this->trackingDispatchTimer.isValid() ? static_cast<double>(this->trackingDispatchTimer.elapsed()) : -1.0;
+			emit trackingFrameDispatched(intervalMs, droppedFrames - this->droppedFramesAtLastTracking);
+			this->droppedFramesAtLastTracking = droppedFrames;
+			this->trackingDispatchTimer.restart();
+			this->estimationEngine->trackDispersion(frame.data(), info.bitDepth, info.samplesPerLine, info.linesPerFrame);
+		} else {
+			this->estimationEngine->startDispersionEstimation(frame.data(), info.bitDepth, info.samplesPerLine, info.linesPerFrame, info.numberOfFrames);
+		}
+		frame.reset();
+	}
+}
+
+void DispersionEstimator::reportAcquisitionStatus() {
+	//runs on the GUI thread
+	int framesPerBuffer = this->acquiredFramesPerBuffer.loadAcquire();
+	if(framesPerBuffer > 0 && framesPerBuffer != this->reportedFramesPerBuffer){
+		this->reportedFramesPerBuffer = framesPerBuffer;
+		emit maxFrames(framesPerBuffer-1);
+	}
+	int buffersPerVolume = this->acquiredBuffersPerVolume.loadAcquire();
+	if(buffersPerVolume > 0 && buffersPerVolume != this->reportedBuffersPerVolume){
+		this->reportedBuffersPerVolume = buffersPerVolume;
+		emit maxBuffers(buffersPerVolume-1);
+	}
+	int invalidDimensions = this->invalidDimensionsCount.loadAcquire();
+	if(invalidDimensions != this->reportedInvalidDimensions){
+		this->reportedInvalidDimensions = invalidDimensions;
+		emit error(this->name + ":  " + tr("Invalid data dimensions!"));
+	}
+	int collectedFrames = this->collectedPooledFrames.loadAcquire();
+	if(collectedFrames != this->reportedCollectedFrames){
+		this->reportedCollectedFrames = collectedFrames;
+		if(collectedFrames > 0){
+			emit statusUpdate(tr("Collecting frames... ") + QString::number(collectedFrames) + "/" + QString::number(this->pooledFrames.loadAcquire()));
+		}
+	}
+
+	int droppedOldest = this->frameRing.getDroppedOldest();
+	int droppedNewest = this->frameRing.getDroppedNewest();
+	if(droppedOldest != this->reportedDroppedOldest || droppedNewest != this->reportedDroppedNewest){
+		this->reportedDroppedOldest = droppedOldest;
+		this->reportedDroppedNewest = droppedNewest;
+		emit frameDropsChanged(droppedOldest, droppedNewest);
+	}
+}
+
 void DispersionEstimator::processedDataReceived(void* buffer, unsigned bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame, unsigned int framesPerBuffer, unsigned int buffersPerVolume, unsigned int currentBufferNr) {
 	Q_UNUSED(buffer)
 	Q_UNUSED(bitDepth)
@@ -198,9 +399,20 @@ void DispersionEstimator::processedDataReceived(void* buffer, unsigned bitDepth,
 }
 
 void DispersionEstimator::receiveCommand(const QString &command, const QVariantMap &params) {
-	Q_UNUSED(params)
 	if(command == "startSingleFetch"){
 		emit this->form->singleFetchRequested();
 	}
+	if(command == "stopEstimation"){
+		emit this->form->stopRequested();
+	}
+	if(command == "startLiveTracking"){
+		this->form->setLiveTrackingEnabled(true);
+	}
+	if(command == "stopLiveTracking"){
+		this->form->setLiveTrackingEnabled(false);
+	}
+	if(command == "saveTrace"){
+		this->saveTrace(params.value("file_path", TRACE_FILE_PATH).toString());
+	}
 }
 
@@ -4,11 +4,35 @@
 
 #include <QCoreApplication>
 #include <QThread>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+#include <QTimer>
 #include "octproz_devkit.h"
 #include "dispersionestimatorform.h"
 #include "dispersionestimationengine.h"
+#include "framering.h"
 
-#define NUMBER_OF_BUFFERS 2
+//frame slots between acquisition and engine: one being written, one being processed and one waiting
+#define FRAME_RING_CAPACITY 3
+
+//how often the engine thread looks for frames that the acquisition thread put into the frame ring
+#define FRAME_RING_POLL_INTERVAL_MS 5
+
+//how often the status published by the acquisition thread (frame drops, frame counts, collected frames) is checked for the GUI
+#define ACQUISITION_STATUS_POLL_INTERVAL_MS 250
+
+//minimum time between two live tracking runs, limits the tracking rate to a few Hz
+#define LIVE_TRACKING_MIN_INTERVAL_MS 200
+
+#define TRACE_FILE_PATH SETTINGS_DIR + "/dispersion_estimator_trace.json"
+
+//requests from the GUI thread that the acquisition thread takes over at its next callback, combined as flags
+enum ACQUISITION_COMMAND{
+	COMMAND_SINGLE_FETCH = 1,
+	COMMAND_STOP = 2,
+	COMMAND_RESTART_COLLECTION = 4, //frames collected so far are discarded, e.g. because the number of pooled frames changed
+	COMMAND_RESTART_TRACKING = 8
+};
 
 
 class DispersionEstimator : public Extension
@@ -31,27 +55,50 @@ private:
 	DispersionEstimatorForm* form;
 	DispersionEstimationEngine* estimationEngine;
 
-	int frameNr;
-	int bufferNr;
-	bool active;
-	bool isCalculating;
+	//written by the GUI thread, read by the acquisition thread
+	QAtomicInt frameNr;
+	QAtomicInt bufferNr;
+	QAtomicInt active;
+	QAtomicInt liveTracking;
+	QAtomicInt nthBuffer;
+	QAtomicInt pooledFrames;
+	QAtomicInt acquisitionCommands; //ACQUISITION_COMMAND flags
+
+	//only used by the acquisition thread
 	bool singleFetch;
+	unsigned int liveTrackingBufferCounter;
+	unsigned int pooledFramesCollected;
+	QElapsedTimer liveTrackingTimer;
+	char* frameWriteBuffer; //slot of the frame that is currently collected
 
+	//frames are copied into the ring by the acquisition thread and taken out by the engine thread
+	FrameRing frameRing;
+	QTimer* frameRingPollTimer; //lives on the engine thread, the acquisition thread does not notify it
+	QAtomicInt discardQueuedFrames;
+	QElapsedTimer trackingDispatchTimer; //only used by the engine thread
+	int droppedFramesAtLastTracking; //only used by the engine thread
 
-	QVector<void*> frameBuffersRaw;
-	QVector<void*> frameBuffersProcessed;
-	int copyBufferId;
-	size_t bytesPerFrameRaw;
-	size_t bytesPerFrameProcessed;
-	int lostBuffersRaw;
-	int lostBuffersProcessed;
-	unsigned int framesPerBuffer;
-	unsigned int buffersPerVolume;
+	//published by the acquisition thread, which must not build strings or emit signals, and reported by the GUI thread
+	QAtomicInt acquiredFramesPerBuffer;
+	QAtomicInt acquiredBuffersPerVolume;
+	QAtomicInt invalidDimensionsCount;
+	QAtomicInt collectedPooledFrames;
+	QTimer acquisitionStatusTimer;
+	int reportedFramesPerBuffer;
+	int reportedBuffersPerVolume;
+	int reportedInvalidDimensions;
+	int reportedCollectedFrames;
+	int reportedDroppedOldest;
+	int reportedDroppedNewest;
 
 	void setupGuiConnections();
 	void setupDispersionEstimatorEngine();
-	void initializeFrameBuffers();
-	void releaseFrameBuffers(QVector<void*> buffers);
+	bool isLiveTrackingDue();
+	void requestAcquisitionCommand(int command, int cancelledCommand = 0);
+	void takeAcquisitionCommands();
+	void processQueuedFrames();
+	void reportAcquisitionStatus();
+	void saveTrace(QString filePath);
 
 public slots:
 	void storeParameters();
@@ -60,7 +107,8 @@ public slots:
 	void receiveCommand(const QString &command, const QVariantMap &params) override;
 
 signals:
-	void newFrame(void* frame, unsigned int bitDepth, unsigned int samplesPerLine, unsigned int linesPerFrame);
+	void trackingFrameDispatched(double intervalMs, int skippedFrames);
+	void frameDropsChanged(int droppedOldest, int droppedNewest);
 	void maxFrames(int max);
 	void maxBuffers(int max);
 	void statusUpdate(const QString &status);
@@ -1,5 +1,6 @@
 #include "dispersionestimatorform.h"
 #include "ui_dispersionestimatorform.h"
+#include "tracerecorder.h"
 #include <QtGlobal>
 
 DispersionEstimatorForm::DispersionEstimatorForm(QWidget *parent) :
@@ -15,6 +16,27 @@ DispersionEstimatorForm::DispersionEstimatorForm(QWidget *parent) :
 	this->ui->comboBox_imageMetric->addItem(tr("Samples Above Threshold"), static_cast<int>(SAMPLES_ABOVE_THRESHOLD));
 	this->ui->comboBox_imageMetric->addItem(tr("Peak Value"), static_cast<int>(PEAK_VALUE));
 	this->ui->comboBox_imageMetric->addItem(tr("Mean Sobel"), static_cast<int>(MEAN_SOBEL));
+	this->ui->comboBox_imageMetric->addItem(tr("Sum of Squared Intensity"), static_cast<int>(SUM_OF_SQUARED_INTENSITY));
+
+	// Fill the estimation strategy comboBox with the available search strategies
+	this->ui->comboBox_estimationStrategy->clear();
+	this->ui->comboBox_estimationStrategy->addItem(tr("Sequential sweep (d2, then d3)"), static_cast<int>(SEQUENTIAL_SWEEP));
+	this->ui->comboBox_estimationStrategy->addItem(tr("Joint 2D Nelder-Mead"), static_cast<int>(NELDER_MEAD_2D));
+	this->ui->comboBox_estimationStrategy->addItem(tr("Gradient (L-BFGS, squared intensity)"), static_cast<int>(GRADIENT_LBFGS));
+	this->ui->comboBox_estimationStrategy->addItem(tr("Successive halving (d2, then d3)"), static_cast<int>(SUCCESSIVE_HALVING));
+	this->ui->comboBox_estimationStrategy->addItem(tr("Coordinate descent (d2 to highest order)"), static_cast<int>(COORDINATE_DESCENT));
+
+	// Fill the A-scan selection comboBox
+	this->ui->comboBox_ascanSelection->clear();
+	this->ui->comboBox_ascanSelection->addItem(tr("Center of the frame"), static_cast<int>(CENTER_ASCANS));
+	this->ui->comboBox_ascanSelection->addItem(tr("Strongest signal, not saturated"), static_cast<int>(BEST_ASCANS));
+
+	// Fill the frame drop policy comboBox
+	this->ui->comboBox_frameDropPolicy->clear();
+	this->ui->comboBox_frameDropPolicy->addItem(tr("Drop oldest waiting frame"), static_cast<int>(DROP_OLDEST_FRAME));
+	this->ui->comboBox_frameDropPolicy->addItem(tr("Drop newest frame"), static_cast<int>(DROP_NEWEST_FRAME));
+
+	this->ui->label_resultHigherOrders->setVisible(false);
 
 	this->connectUiControls();
 	this->setupPlot();
@@ -30,6 +52,8 @@ void DispersionEstimatorForm::setSettings(QVariantMap settings) {
 	this->parameters.bufferNr = settings.value(DISPERSION_ESTIMATOR_BUFFER_NR, -1).toInt();
 	this->parameters.frameNr = settings.value(DISPERSION_ESTIMATOR_FRAME_NR, 0).toInt();
 	this->parameters.numberOfCenterAscans = settings.value(DISPERSION_ESTIMATOR_NUMBER_OF_CENTER_ASCANS,20).toInt();
+	this->parameters.ascanSelection = static_cast<ASCAN_SELECTION>(settings.value(DISPERSION_ESTIMATOR_ASCAN_SELECTION, 0).toInt());
+	this->parameters.numberOfPooledFrames = settings.value(DISPERSION_ESTIMATOR_NUMBER_OF_POOLED_FRAMES, 1).toInt();
 	this->parameters.useLinearAscans = settings.value(DISPERSION_ESTIMATOR_USE_LINEAR_ASCANS, true).toBool();
 	this->parameters.numberOfAscanSamplesToIgnore = settings.value(DISPERSION_ESTIMATOR_NUMBER_OF_ASCAN_SAMPLES_TO_IGNORE, 30).toInt();
 	this->parameters.autoCalcD1 = settings.value(DISPERSION_ESTIMATOR_AUTO_CALC_D1, false).toBool();
@@ -39,14 +63,31 @@ void DispersionEstimatorForm::setSettings(QVariantMap settings) {
 	this->parameters.d2end = settings.value(DISPERSION_ESTIMATOR_D2_END, 50.0).toReal();
 	this->parameters.d3start = settings.value(DISPERSION_ESTIMATOR_D3_START, -50.0).toReal();
 	this->parameters.d3end = settings.value(DISPERSION_ESTIMATOR_D3_END, 50.0).toReal();
+	this->parameters.d4start = settings.value(DISPERSION_ESTIMATOR_D4_START, -50.0).toReal();
+	this->parameters.d4end = settings.value(DISPERSION_ESTIMATOR_D4_END, 50.0).toReal();
+	this->parameters.d5start = settings.value(DISPERSION_ESTIMATOR_D5_START, -50.0).toReal();
+	this->parameters.d5end = settings.value(DISPERSION_ESTIMATOR_D5_END, 50.0).toReal();
+	this->parameters.highestDispersionOrder = settings.value(DISPERSION_ESTIMATOR_HIGHEST_DISPERSION_ORDER, 3).toInt();
 	this->parameters.numberOfDispersionSamples = settings.value(DISPERSION_ESTIMATOR_NUMBER_OF_DISPERSION_SAMPLES, 100).toInt();
+	this->parameters.estimationStrategy = static_cast<ESTIMATION_STRATEGY>(settings.value(DISPERSION_ESTIMATOR_ESTIMATION_STRATEGY, 0).toInt());
+	this->parameters.peakFitting = settings.value(DISPERSION_ESTIMATOR_PEAK_FITTING, false).toBool();
+	this->parameters.parallelEvaluation = settings.value(DISPERSION_ESTIMATOR_PARALLEL_EVALUATION, true).toBool();
+	this->parameters.numberOfThreads = settings.value(DISPERSION_ESTIMATOR_NUMBER_OF_THREADS, 0).toInt();
+	this->parameters.metricCache = settings.value(DISPERSION_ESTIMATOR_METRIC_CACHE, true).toBool();
+	this->parameters.liveTrackingNthBuffer = settings.value(DISPERSION_ESTIMATOR_LIVE_TRACKING_NTH_BUFFER, 10).toInt();
+	this->parameters.frameDropPolicy = static_cast<FRAME_DROP_POLICY>(settings.value(DISPERSION_ESTIMATOR_FRAME_DROP_POLICY, 0).toInt());
+	this->parameters.tracing = settings.value(DISPERSION_ESTIMATOR_TRACING, false).toBool();
+	this->parameters.hardwareCounters = settings.value(DISPERSION_ESTIMATOR_HARDWARE_COUNTERS, false).toBool();
 	this->parameters.windowState = settings.value(DISPERSION_ESTIMATOR_WINDOW_STATE).toByteArray();
 	this->parameters.guiVisible = settings.value(DISPERSION_ESTIMATOR_GUI_TOGGLE, true).toBool();
+	this->parameters.performancePanelVisible = settings.value(DISPERSION_ESTIMATOR_PERFORMANCE_PANEL_VISIBLE, false).toBool();
 
 	//update the UI elements accordingly.
 	this->ui->spinBox_buffer->setValue(parameters.bufferNr);
 	this->ui->spinBox_frame->setValue(parameters.frameNr);
 	this->ui->spinBox_numberOfAscans->setValue(parameters.numberOfCenterAscans);
+	this->ui->comboBox_ascanSelection->setCurrentIndex(static_cast<int>(parameters.ascanSelection));
+	this->ui->spinBox_pooledFrames->setValue(parameters.numberOfPooledFrames);
 	this->ui->checkBox_useLinear->setChecked(parameters.useLinearAscans);
 	this->ui->spinBox_samplesToIgnore->setValue(parameters.numberOfAscanSamplesToIgnore);
 	this->ui->checkBox_calcd1->setChecked(parameters.autoCalcD1);
@@ -56,17 +97,28 @@ void DispersionEstimatorForm::setSettings(QVariantMap settings) {
 	this->ui->doubleSpinBox_d2End->setValue(parameters.d2end);
 	this->ui->doubleSpinBox_d3Start->setValue(parameters.d3start);
 	this->ui->doubleSpinBox_d3End->setValue(parameters.d3end);
+	this->ui->doubleSpinBox_d4Start->setValue(parameters.d4start);
+	this->ui->doubleSpinBox_d4End->setValue(parameters.d4end);
+	this->ui->doubleSpinBox_d5Start->setValue(parameters.d5start);
+	this->ui->doubleSpinBox_d5End->setValue(parameters.d5end);
+	this->ui->spinBox_highestOrder->setValue(parameters.highestDispersionOrder);
+	this->updateHigherOrderRanges();
 	this->ui->spinBox_numberOfDispersionSamples->setValue(parameters.numberOfDispersionSamples);
+	this->ui->comboBox_estimationStrategy->setCurrentIndex(static_cast<int>(parameters.estimationStrategy));
+	this->ui->checkBox_peakFitting->setChecked(parameters.peakFitting);
+	this->ui->checkBox_parallelEvaluation->setChecked(parameters.parallelEvaluation);
+	this->ui->spinBox_numberOfThreads->setValue(parameters.numberOfThreads);
+	this->ui->checkBox_metricCache->setChecked(parameters.metricCache);
+	this->ui->spinBox_nthBuffer->setValue(parameters.liveTrackingNthBuffer);
+	this->ui->comboBox_frameDropPolicy->setCurrentIndex(static_cast<int>(parameters.frameDropPolicy));
+	this->ui->checkBox_tracing->setChecked(parameters.tracing);
+	this->ui->checkBox_hardwareCounters->setChecked(parameters.hardwareCounters);
+
+	this->ui->toolButton_performance->setChecked(parameters.performancePanelVisible);
 
 	ui->widget_settings_area->setVisible(this->parameters.guiVisible);
-	if (!this->parameters.guiVisible) {
-		this->adjustSize();
-		this->setFixedSize(this->size());
-	} else {
-		this->setMinimumSize(0, 0);
-		this->setMaximumSize(QWIDGETSIZE_MAX, QWIDGETSIZE_MAX);
-		this->adjustSize();
-	}
+	this->ui->widget_performanceDashboard->setVisible(this->parameters.performancePanelVisible);
+	this->fitToContents();
 
 	this->restoreGeometry(this->parameters.windowState);
 }
@@ -79,6 +131,8 @@ void DispersionEstimatorForm::getSettings(QVariantMap* settings) {
 	settings->insert(DISPERSION_ESTIMATOR_BUFFER_NR, this->parameters.bufferNr);
 	settings->insert(DISPERSION_ESTIMATOR_FRAME_NR, this->parameters.frameNr);
 	settings->insert(DISPERSION_ESTIMATOR_NUMBER_OF_CENTER_ASCANS, this->parameters.numberOfCenterAscans);
+	settings->insert(DISPERSION_ESTIMATOR_ASCAN_SELECTION, static_cast<int>(this->parameters.ascanSelection));
+	settings->insert(DISPERSION_ESTIMATOR_NUMBER_OF_POOLED_FRAMES, this->parameters.numberOfPooledFrames);
 	settings->insert(DISPERSION_ESTIMATOR_USE_LINEAR_ASCANS, this->parameters.useLinearAscans);
 	settings->insert(DISPERSION_ESTIMATOR_NUMBER_OF_ASCAN_SAMPLES_TO_IGNORE, this->parameters.numberOfAscanSamplesToIgnore);
 	settings->insert(DISPERSION_ESTIMATOR_AUTO_CALC_D1, this->parameters.autoCalcD1);
@@ -88,9 +142,24 @@ void DispersionEstimatorForm::getSettings(QVariantMap* settings) {
 	settings->insert(DISPERSION_ESTIMATOR_D2_END, this->parameters.d2end);
 	settings->insert(DISPERSION_ESTIMATOR_D3_START, this->parameters.d3start);
 	settings->insert(DISPERSION_ESTIMATOR_D3_END, this->parameters.d3end);
+	settings->insert(DISPERSION_ESTIMATOR_D4_START, this->parameters.d4start);
+	settings->insert(DISPERSION_ESTIMATOR_D4_END, this->parameters.d4end);
+	settings->insert(DISPERSION_ESTIMATOR_D5_START, this->parameters.d5start);
+	settings->insert(DISPERSION_ESTIMATOR_D5_END, this->parameters.d5end);
+	settings->insert(DISPERSION_ESTIMATOR_HIGHEST_DISPERSION_ORDER, this->parameters.highestDispersionOrder);
 	settings->insert(DISPERSION_ESTIMATOR_NUMBER_OF_DISPERSION_SAMPLES, this->parameters.numberOfDispersionSamples);
+	settings->insert(DISPERSION_ESTIMATOR_ESTIMATION_STRATEGY, static_cast<int>(this->parameters.estimationStrategy));
+	settings->insert(DISPERSION_ESTIMATOR_PEAK_FITTING, this->parameters.peakFitting);
+	settings->insert(DISPERSION_ESTIMATOR_PARALLEL_EVALUATION, this->parameters.parallelEvaluation);
+	settings->insert(DISPERSION_ESTIMATOR_NUMBER_OF_THREADS, this->parameters.numberOfThreads);
+	settings->insert(DISPERSION_ESTIMATOR_METRIC_CACHE, this->parameters.metricCache);
+	settings->insert(DISPERSION_ESTIMATOR_LIVE_TRACKING_NTH_BUFFER, this->parameters.liveTrackingNthBuffer);
+	settings->insert(DISPERSION_ESTIMATOR_FRAME_DROP_POLICY, static_cast<int>(this->parameters.frameDropPolicy));
+	settings->insert(DISPERSION_ESTIMATOR_TRACING, this->parameters.tracing);
+	settings->insert(DISPERSION_ESTIMATOR_HARDWARE_COUNTERS, this->parameters.hardwareCounters);
 	settings->insert(DISPERSION_ESTIMATOR_WINDOW_STATE, this->parameters.windowState);
 	settings->insert(DISPERSION_ESTIMATOR_GUI_TOGGLE, this->parameters.guiVisible);
+	settings->insert(DISPERSION_ESTIMATOR_PERFORMANCE_PANEL_VISIBLE, this->parameters.performancePanelVisible);
 }
 
 bool DispersionEstimatorForm::eventFilter(QObject *watched, QEvent *event) {
@@ -114,12 +183,14 @@ void DispersionEstimatorForm::setMaximumBufferNr(int maximum) {
 	this->ui->spinBox_buffer->setMaximum(maximum);
 }
 
-void DispersionEstimatorForm::addDataToD2Plot(qreal d2, float metricValue) {
-	this->linePlot->updateFirstCurve(d2, static_cast<double>(metricValue));
+void DispersionEstimatorForm::addDataToD2Plot(QVector<QPointF> d2AndMetricValues) {
+	TraceScope trace("plot_d2", "gui");
+	this->linePlot->appendToFirstCurve(d2AndMetricValues);
 }
 
-void DispersionEstimatorForm::addDataToD3Plot(qreal d3, float metricValue) {
-	this->linePlot->updateSecondCurve(d3, static_cast<double>(metricValue));
+void DispersionEstimatorForm::addDataToD3Plot(QVector<QPointF> d3AndMetricValues) {
+	TraceScope trace("plot_d3", "gui");
+	this->linePlot->appendToSecondCurve(d3AndMetricValues);
 }
 
 void DispersionEstimatorForm::clearPlot() {
@@ -134,15 +205,26 @@ void DispersionEstimatorForm::displayBestD3(double d3) {
 	this->ui->label_resultD3->setText(QString::number(d3));
 }
 
+void DispersionEstimatorForm::displayHigherOrderCoefficients(QVector<double> coefficients) {
+	QStringList results;
+	for (int i = 0; i < coefficients.size(); i++) {
+		results.append(QString("d<sub>%1</sub>: %2").arg(i + 4).arg(coefficients.at(i)));
+	}
+	this->ui->label_resultHigherOrders->setText(results.join("&nbsp;&nbsp;&nbsp;"));
+	this->ui->label_resultHigherOrders->setVisible(!coefficients.isEmpty());
+}
+
 void DispersionEstimatorForm::displayDerivedD1(double d1) {
 	this->ui->label_resultD1->setText(QString::number(d1));
 }
 
 void DispersionEstimatorForm::addAscanOneToPlot(QVector<float> ascan) {
+	TraceScope trace("plot_ascan", "gui");
 	this->ui->widget_linePlot_ascans->setFirstCurve(ascan);
 }
 
 void DispersionEstimatorForm::addAscanTwoToPlot(QVector<float> ascan) {
+	TraceScope trace("plot_ascan", "gui");
 	this->ui->widget_linePlot_ascans->setSecondCurve(ascan);
 }
 
@@ -150,14 +232,56 @@ void DispersionEstimatorForm::updateStatus(const QString &status) {
 	this->ui->label_status->setText(status);
 }
 
+void DispersionEstimatorForm::setLiveTrackingEnabled(bool enabled) {
+	this->ui->checkBox_liveTracking->setChecked(enabled);
+}
+
+void DispersionEstimatorForm::displayRunReport(EstimationRunReport report) {
+	this->ui->widget_performanceDashboard->showRunReport(report);
+}
+
+void DispersionEstimatorForm::displayTrackingFrame(double intervalMs, int skippedFrames) {
+	this->ui->widget_performanceDashboard->showTrackingFrame(intervalMs, skippedFrames);
+}
+
+void DispersionEstimatorForm::displayFrameDrops(int droppedOldest, int droppedNewest) {
+	this->ui->widget_performanceDashboard->showFrameDrops(droppedOldest, droppedNewest);
+}
+
+void DispersionEstimatorForm::updateHigherOrderRanges() {
+	// Only coordinate descent estimates orders above d3
+	bool higherOrdersUsed = this->parameters.estimationStrategy == COORDINATE_DESCENT;
+	bool d4Enabled = higherOrdersUsed && this->parameters.highestDispersionOrder >= 4;
+	bool d5Enabled = higherOrdersUsed && this->parameters.highestDispersionOrder >= 5;
+	this->ui->spinBox_highestOrder->setEnabled(higherOrdersUsed);
+	this->ui->doubleSpinBox_d4Start->setEnabled(d4Enabled);
+	this->ui->doubleSpinBox_d4End->setEnabled(d4Enabled);
+	this->ui->doubleSpinBox_d5Start->setEnabled(d5Enabled);
+	this->ui->doubleSpinBox_d5End->setEnabled(d5Enabled);
+}
+
 void DispersionEstimatorForm::toggleUIVisibility() {
 	// Toggle visibility state
 	this->parameters.guiVisible = !this->parameters.guiVisible;
 
 	// Hide or show the settings area and status label.
 	ui->widget_settings_area->setVisible(this->parameters.guiVisible);
+	this->fitToContents();
+	emit paramsChanged(this->parameters);
+}
+
+void DispersionEstimatorForm::setPerformancePanelVisible(bool visible) {
+	this->parameters.performancePanelVisible = visible;
+	this->ui->widget_performanceDashboard->setVisible(visible);
+	this->fitToContents();
+	emit paramsChanged(this->parameters);
+}
 
+void DispersionEstimatorForm::fitToContents() {
 	if (!this->parameters.guiVisible) {
+		// Remove the old fixed size first, the performance panel may have changed the minimum size
+		this->setMinimumSize(0, 0);
+		this->setMaximumSize(QWIDGETSIZE_MAX, QWIDGETSIZE_MAX);
 		// Recalculate the layout size and force the widget to shrink to its minimum size.
 		this->adjustSize();
 		// Fix the window size to the new minimum size.
@@ -168,7 +292,6 @@ void DispersionEstimatorForm::toggleUIVisibility() {
 		this->setMaximumSize(QWIDGETSIZE_MAX, QWIDGETSIZE_MAX);
 		this->adjustSize();
 	}
-	emit paramsChanged(this->parameters);
 }
 
 void DispersionEstimatorForm::connectUiControls() {
@@ -204,6 +327,21 @@ void DispersionEstimatorForm::connectUiControls() {
 			emit paramsChanged(this->parameters);
 		});
 
+	// Center A-scans or the A-scans with the strongest unsaturated signal of every frame
+	connect(ui->comboBox_ascanSelection, QOverload<int>::of(&QComboBox::currentIndexChanged),
+		this, [this](int index) {
+			this->parameters.ascanSelection = static_cast<ASCAN_SELECTION>(index);
+			emit paramsChanged(this->parameters);
+		});
+
+	// Number of frames whose center A-scans are pooled into one estimation
+	connect(ui->spinBox_pooledFrames, QOverload<int>::of(&QSpinBox::valueChanged),
+		this, [this](int value) {
+			this->parameters.numberOfPooledFrames = value;
+			emit pooledFramesChanged(value);
+			emit paramsChanged(this->parameters);
+		});
+
 	// Samples to ignore
 	connect(ui->spinBox_samplesToIgnore, QOverload<int>::of(&QSpinBox::valueChanged),
 		this, [this](int value) {
@@ -225,6 +363,14 @@ void DispersionEstimatorForm::connectUiControls() {
 			emit paramsChanged(this->parameters);
 		});
 
+	// Estimation strategy
+	connect(ui->comboBox_estimationStrategy, QOverload<int>::of(&QComboBox::currentIndexChanged),
+		this, [this](int index) {
+			this->parameters.estimationStrategy = static_cast<ESTIMATION_STRATEGY>(index);
+			this->updateHigherOrderRanges();
+			emit paramsChanged(this->parameters);
+		});
+
 	// Metric threshold
 	connect(ui->doubleSpinBox_metricThreshold, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
 		this, [this](double value) {
@@ -256,6 +402,34 @@ void DispersionEstimatorForm::connectUiControls() {
 			emit paramsChanged(this->parameters);
 		});
 
+	// Higher order coefficients
+	connect(ui->spinBox_highestOrder, QOverload<int>::of(&QSpinBox::valueChanged),
+		this, [this](int value) {
+			this->parameters.highestDispersionOrder = value;
+			this->updateHigherOrderRanges();
+			emit paramsChanged(this->parameters);
+		});
+	connect(ui->doubleSpinBox_d4Start, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+		this, [this](double value) {
+			this->parameters.d4start = value;
+			emit paramsChanged(this->parameters);
+		});
+	connect(ui->doubleSpinBox_d4End, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+		this, [this](double value) {
+			this->parameters.d4end = value;
+			emit paramsChanged(this->parameters);
+		});
+	connect(ui->doubleSpinBox_d5Start, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+		this, [this](double value) {
+			this->parameters.d5start = value;
+			emit paramsChanged(this->parameters);
+		});
+	connect(ui->doubleSpinBox_d5End, QOverload<double>::of(&QDoubleSpinBox::valueChanged),
+		this, [this](double value) {
+			this->parameters.d5end = value;
+			emit paramsChanged(this->parameters);
+		});
+
 	// Number of dispersion samples
 	connect(ui->spinBox_numberOfDispersionSamples, QOverload<int>::of(&QSpinBox::valueChanged),
 		this, [this](int value) {
@@ -263,9 +437,69 @@ void DispersionEstimatorForm::connectUiControls() {
 			emit paramsChanged(this->parameters);
 		});
 
+	// Sub-sample peak fitting
+	connect(ui->checkBox_peakFitting, &QCheckBox::toggled,
+		this, [this](bool checked) {
+			this->parameters.peakFitting = checked;
+			emit paramsChanged(parameters);
+		});
+
+	// Parallel candidate evaluation
+	this->ui->spinBox_numberOfThreads->setSpecialValueText(tr("Auto"));
+	connect(ui->checkBox_parallelEvaluation, &QCheckBox::toggled,
+		this, [this](bool checked) {
+			this->parameters.parallelEvaluation = checked;
+			this->ui->spinBox_numberOfThreads->setEnabled(checked);
+			emit paramsChanged(parameters);
+		});
+	connect(ui->spinBox_numberOfThreads, QOverload<int>::of(&QSpinBox::valueChanged),
+		this, [this](int value) {
+			this->parameters.numberOfThreads = value;
+			emit paramsChanged(this->parameters);
+		});
+
+	// Reuse of metric values from earlier runs
+	connect(ui->checkBox_metricCache, &QCheckBox::toggled,
+		this, [this](bool checked) {
+			this->parameters.metricCache = checked;
+			emit paramsChanged(this->parameters);
+		});
+
+	// Live tracking. It is not stored in the settings, so tracking never starts without user interaction.
+	connect(ui->checkBox_liveTracking, &QCheckBox::toggled, this, &DispersionEstimatorForm::autoFetchRequested);
+	connect(ui->spinBox_nthBuffer, QOverload<int>::of(&QSpinBox::valueChanged),
+		this, [this](int value) {
+			this->parameters.liveTrackingNthBuffer = value;
+			emit nthBufferChanged(value);
+			emit paramsChanged(this->parameters);
+		});
+	connect(this, &DispersionEstimatorForm::stopRequested, this, [this]() {
+		this->setLiveTrackingEnabled(false);
+	});
+	connect(ui->comboBox_frameDropPolicy, QOverload<int>::of(&QComboBox::currentIndexChanged),
+		this, [this](int index) {
+			this->parameters.frameDropPolicy = static_cast<FRAME_DROP_POLICY>(index);
+			emit paramsChanged(this->parameters);
+		});
+
+	// Trace recording
+	connect(ui->checkBox_tracing, &QCheckBox::toggled,
+		this, [this](bool checked) {
+			this->parameters.tracing = checked;
+			emit paramsChanged(this->parameters);
+		});
+	connect(ui->pushButton_saveTrace, &QPushButton::clicked, this, &DispersionEstimatorForm::traceSaveRequested);
+	connect(ui->checkBox_hardwareCounters, &QCheckBox::toggled,
+		this, [this](bool checked) {
+			this->parameters.hardwareCounters = checked;
+			emit paramsChanged(this->parameters);
+		});
+
 	// Buttons
 	connect(ui->pushButton_fetch, &QPushButton::clicked,this, &DispersionEstimatorForm::singleFetchRequested);
+	connect(ui->pushButton_stop, &QPushButton::clicked,this, &DispersionEstimatorForm::stopRequested);
 	connect(ui->toolButton_settings, &QToolButton::clicked, this, &DispersionEstimatorForm::toggleUIVisibility);
+	connect(ui->toolButton_performance, &QToolButton::toggled, this, &DispersionEstimatorForm::setPerformancePanelVisible);
 }
 
 void DispersionEstimatorForm::setupPlot() {
@@ -4,6 +4,7 @@
 #include <QWidget>
 #include <QRect>
 #include "dispersionestimatorparameters.h"
+#include "estimationrunreport.h"
 #include "lineplot.h"
 
 namespace Ui {
@@ -31,19 +32,25 @@ protected:
 public slots:
 	void setMaximumFrameNr(int maximum);
 	void setMaximumBufferNr(int maximum);
-	void addDataToD2Plot(qreal d2, float metricValue);
-	void addDataToD3Plot(qreal d3, float metricValue);
+	void addDataToD2Plot(QVector<QPointF> d2AndMetricValues);
+	void addDataToD3Plot(QVector<QPointF> d3AndMetricValues);
 	void clearPlot();
 	void displayBestD2(double d2);
 	void displayBestD3(double d3);
 	void displayDerivedD1(double d1);
+	void displayHigherOrderCoefficients(QVector<double> coefficients);
 
 	void addAscanOneToPlot(QVector<float> ascan);
 	void addAscanTwoToPlot(QVector<float> ascan);
 	void updateStatus(const QString &status);
+	void setLiveTrackingEnabled(bool enabled);
+	void displayRunReport(EstimationRunReport report);
+	void displayTrackingFrame(double intervalMs, int skippedFrames);
+	void displayFrameDrops(int droppedOldest, int droppedNewest);
 
 private slots:
 	void toggleUIVisibility();
+	void setPerformancePanelVisible(bool visible);
 
 private:
 	LinePlot* linePlot;
@@ -53,17 +60,22 @@ private:
 
 	void connectUiControls();
 	void setupPlot();
+	void updateHigherOrderRanges();
+	void fitToContents();
 
 signals:
 	void paramsChanged(DispersionEstimatorParameters);
 	void frameNrChanged(int);
 	void bufferNrChanged(int);
+	void pooledFramesChanged(int);
 	void featureChanged(int);
 	void bufferSourceChanged(BUFFER_SOURCE);
 	void roiChanged(QRect);
 	void singleFetchRequested();
+	void stopRequested();
 	void autoFetchRequested(bool isRequested);
 	void nthBufferChanged(int nthBuffer);
+	void traceSaveRequested();
 	void fitModeLogarithmEnabled(bool enabled);
 	void info(QString);
 	void error(QString);
@@ -16,6 +16,8 @@
 #define DISPERSION_ESTIMATOR_FRAME_NR "frame_nr"
 #define DISPERSION_ESTIMATOR_BUFFER_NR "buffer_nr"
 #define DISPERSION_ESTIMATOR_NUMBER_OF_CENTER_ASCANS "number_of_center_ascans"
+#define DISPERSION_ESTIMATOR_ASCAN_SELECTION "ascan_selection"
+#define DISPERSION_ESTIMATOR_NUMBER_OF_POOLED_FRAMES "number_of_pooled_frames"
 #define DISPERSION_ESTIMATOR_USE_LINEAR_ASCANS "use_linear_ascans"
 #define DISPERSION_ESTIMATOR_NUMBER_OF_ASCAN_SAMPLES_TO_IGNORE	"number_of_ascan_samples_to_ignore"
 #define DISPERSION_ESTIMATOR_AUTO_CALC_D1 "auto_calculate_d1"
@@ -25,9 +27,28 @@
 #define DISPERSION_ESTIMATOR_D2_END "d2_end"
 #define DISPERSION_ESTIMATOR_D3_START "d3_start"
 #define DISPERSION_ESTIMATOR_D3_END "d3_end"
+#define DISPERSION_ESTIMATOR_D4_START "d4_start"
+#define DISPERSION_ESTIMATOR_D4_END "d4_end"
+#define DISPERSION_ESTIMATOR_D5_START "d5_start"
+#define DISPERSION_ESTIMATOR_D5_END "d5_end"
+#define DISPERSION_ESTIMATOR_HIGHEST_DISPERSION_ORDER "highest_dispersion_order"
 #define DISPERSION_ESTIMATOR_NUMBER_OF_DISPERSION_SAMPLES "number_of_dispersion_samples"
+#define DISPERSION_ESTIMATOR_ESTIMATION_STRATEGY "estimation_strategy"
+#define DISPERSION_ESTIMATOR_PEAK_FITTING "peak_fitting"
+#define DISPERSION_ESTIMATOR_PARALLEL_EVALUATION "parallel_evaluation"
+#define DISPERSION_ESTIMATOR_NUMBER_OF_THREADS "number_of_threads"
+#define DISPERSION_ESTIMATOR_METRIC_CACHE "metric_cache"
+#define DISPERSION_ESTIMATOR_LIVE_TRACKING_NTH_BUFFER "live_tracking_nth_buffer"
+#define DISPERSION_ESTIMATOR_FRAME_DROP_POLICY "frame_drop_policy"
+#define DISPERSION_ESTIMATOR_TRACING "tracing"
+#define DISPERSION_ESTIMATOR_HARDWARE_COUNTERS "hardware_counters"
 #define DISPERSION_ESTIMATOR_WINDOW_STATE "dispersion_estimator_window_state"
 #define DISPERSION_ESTIMATOR_GUI_TOGGLE "gui_visible"
+#define DISPERSION_ESTIMATOR_PERFORMANCE_PANEL_VISIBLE "performance_panel_visible"
+
+
+//highest polynomial order of the dispersive phase that can be estimated. OCTproZ itself only applies coefficients up to d3.
+#define MAX_DISPERSION_ORDER 5
 
 
 enum BUFFER_SOURCE{
@@ -35,11 +56,32 @@ enum BUFFER_SOURCE{
 	PROCESSED
 };
 
+//which A-scans of a frame are used for the estimation
+enum ASCAN_SELECTION{
+	CENTER_ASCANS,
+	BEST_ASCANS //highest fringe energy, A-scans with clipped samples last
+};
+
 enum ASCAN_SHARPNESS_METRIC{
 	SUM_ABOVE_THRESHOLD,
 	SAMPLES_ABOVE_THRESHOLD,
 	PEAK_VALUE,
-	MEAN_SOBEL
+	MEAN_SOBEL,
+	SUM_OF_SQUARED_INTENSITY
+};
+
+//what happens to a frame from the acquisition if all frame slots are in use
+enum FRAME_DROP_POLICY{
+	DROP_OLDEST_FRAME,
+	DROP_NEWEST_FRAME
+};
+
+enum ESTIMATION_STRATEGY{
+	SEQUENTIAL_SWEEP,
+	NELDER_MEAD_2D,
+	GRADIENT_LBFGS,
+	SUCCESSIVE_HALVING,
+	COORDINATE_DESCENT
 };
 
 struct DispersionEstimatorParameters {
@@ -48,6 +90,8 @@ struct DispersionEstimatorParameters {
 	int frameNr;
 	int bufferNr;
 	int numberOfCenterAscans;
+	ASCAN_SELECTION ascanSelection;
+	int numberOfPooledFrames;
 	bool useLinearAscans;
 	int numberOfAscanSamplesToIgnore;
 	bool autoCalcD1;
@@ -57,9 +101,44 @@ struct DispersionEstimatorParameters {
 	qreal d2end;
 	qreal d3start;
 	qreal d3end;
+	qreal d4start;
+	qreal d4end;
+	qreal d5start;
+	qreal d5end;
+	int highestDispersionOrder;
 	int numberOfDispersionSamples;
+	ESTIMATION_STRATEGY estimationStrategy;
+	bool peakFitting;
+	bool parallelEvaluation;
+	int numberOfThreads;
+	bool metricCache;
+	int liveTrackingNthBuffer;
+	FRAME_DROP_POLICY frameDropPolicy;
+	bool tracing;
+	bool hardwareCounters;
 	QByteArray windowState;
 	bool guiVisible;
+	bool performancePanelVisible;
+
+	//sample range of the dispersion coefficient of the given polynomial order (2 to MAX_DISPERSION_ORDER)
+	qreal dispersionRangeStart(int order) const {
+		switch (order) {
+		case 2: return d2start;
+		case 3: return d3start;
+		case 4: return d4start;
+		case 5: return d5start;
+		default: return 0.0;
+		}
+	}
+	qreal dispersionRangeEnd(int order) const {
+		switch (order) {
+		case 2: return d2end;
+		case 3: return d3end;
+		case 4: return d4end;
+		case 5: return d5end;
+		default: return 0.0;
+		}
+	}
 };
 Q_DECLARE_METATYPE(DispersionEstimatorParameters)
 
@@ -0,0 +1,260 @@
+#include "estimationrunreport.h"
+#include <QFile>
+#include <QTextStream>
+
+#define MEBIBYTE (1024.0 * 1024.0)
+
+EstimationRunReport::EstimationRunReport()
+{
+	this->reset();
+}
+
+void EstimationRunReport::reset()
+{
+	this->startTime = QDateTime::currentDateTime();
+	this->liveTracking = false;
+	this->strategy = SEQUENTIAL_SWEEP;
+	this->samplesPerLine = 0;
+	this->numberOfAscans = 0;
+	this->numberOfThreads = 1;
+	this->evaluatedCandidates = 0;
+	this->totalNanoseconds = 0;
+	for (int i = 0; i < NUMBER_OF_PHASES; ++i) {
+		this->phaseNanoseconds[i] = 0;
+	}
+	this->stageTimings.reset();
+	this->hardwareCountersRequested = false;
+	this->hardwareCounterError.clear();
+	this->frameCopyBytes = 0;
+	this->residentBytesAtStart = -1;
+	this->peakResidentBytes = -1;
+	this->peakResidentBytesOfRun = false;
+	this->workspaceReservedBytes = 0;
+	this->workspaceHugePageBytes = 0;
+	this->workspacePeakBytes = 0;
+	this->cacheHits = 0;
+	this->cacheMisses = 0;
+	this->workerBusyNanoseconds = 0;
+	this->parallelWallNanoseconds = 0;
+}
+
+void EstimationRunReport::addPhase(Phase phase, qint64 nanoseconds)
+{
+	this->phaseNanoseconds[phase] += nanoseconds;
+}
+
+double EstimationRunReport::candidatesPerSecond() const
+{
+	qint64 searchNanoseconds = this->phaseNanoseconds[D2_SWEEP] + this->phaseNanoseconds[D3_SWEEP] + this->phaseNanoseconds[JOINT_SEARCH];
+	if (searchNanoseconds <= 0) {
+		return 0.0;
+	}
+	return static_cast<double>(this->evaluatedCandidates) * 1.0e9 / static_cast<double>(searchNanoseconds);
+}
+
+double EstimationRunReport::ascansPerSecond() const
+{
+	if (this->totalNanoseconds <= 0) {
+		return 0.0;
+	}
+	return static_cast<double>(this->stageTimings.calls[OCTSignalProcessing::STAGE_IFFT]) * 1.0e9 / static_cast<double>(this->totalNanoseconds);
+}
+
+double EstimationRunReport::cacheHitRate() const
+{
+	int lookups = this->cacheHits + this->cacheMisses;
+	if (lookups <= 0) {
+		return -1.0;
+	}
+	return static_cast<double>(this->cacheHits) / static_cast<double>(lookups);
+}
+
+double EstimationRunReport::threadUtilization() const
+{
+	if (this->parallelWallNanoseconds <= 0 || this->numberOfThreads <= 0) {
+		return -1.0;
+	}
+	return static_cast<double>(this->workerBusyNanoseconds) / (static_cast<double>(this->parallelWallNanoseconds) * this->numberOfThreads);
+}
+
+QString EstimationRunReport::summary() const
+{
+	QString text = QString("%1 ms, %2 candidates/s, %3 A-scans/s")
+			.arg(static_cast<double>(this->totalNanoseconds) / 1.0e6, 0, 'f', 1)
+			.arg(this->candidatesPerSecond(), 0, 'f', 1)
+			.arg(this->ascansPerSecond(), 0, 'f', 0);
+	if (this->peakResidentBytes >= 0) {
+		text += QString(", peak RSS %1 MiB").arg(static_cast<double>(this->peakResidentBytes) / MEBIBYTE, 0, 'f', 0);
+	}
+	return text;
+}
+
+QString EstimationRunReport::toText() const
+{
+	QString text;
+	QTextStream stream(&text);
+	stream << (this->liveTracking ? "Tracking run " : "Estimation run ") << this->startTime.toString(Qt::ISODate) << "\n";
+	stream << "  strategy: " << strategyName(this->strategy) << ", samples per line: " << this->samplesPerLine
+	       << ", A-scans: " << this->numberOfAscans << ", threads: " << this->numberOfThreads << "\n";
+	stream << "  total: " << this->totalNanoseconds << " ns, candidates: " << this->evaluatedCandidates
+	       << ", candidates/s: " << QString::number(this->candidatesPerSecond(), 'f', 1)
+	       << ", A-scans/s: " << QString::number(this->ascansPerSecond(), 'f', 0) << "\n";
+	for (int i = 0; i < NUMBER_OF_PHASES; ++i) {
+		if (this->phaseNanoseconds[i] > 0) {
+			stream << "  phase " << phaseName(static_cast<Phase>(i)) << ": " << this->phaseNanoseconds[i] << " ns\n";
+		}
+	}
+	for (int i = 0; i < OCTSignalProcessing::NUMBER_OF_PROCESSING_STAGES; ++i) {
+		if (this->stageTimings.calls[i] > 0) {
+			OCTSignalProcessing::ProcessingStage stage = static_cast<OCTSignalProcessing::ProcessingStage>(i);
+			stream << "  stage " << OCTSignalProcessing::StageTimings::stageName(stage) << ": " << this->stageTimings.nanoseconds[i]
+			       << " ns in " << this->stageTimings.calls[i] << " calls, allocations: " << this->stageTimings.allocations[i].allocations
+			       << " (" << this->stageTimings.allocations[i].bytes << " bytes)";
+			if (this->stageTimings.counterCalls[i] > 0) {
+				stream << ", IPC: " << QString::number(this->stageTimings.instructionsPerCycle(stage), 'f', 2)
+				       << ", cache misses/sample: " << QString::number(this->stageTimings.countsPerSample(stage, OCTSignalProcessing::COUNTER_CACHE_MISSES), 'g', 3)
+				       << ", branch misses/sample: " << QString::number(this->stageTimings.countsPerSample(stage, OCTSignalProcessing::COUNTER_BRANCH_MISSES), 'g', 3);
+			}
+			stream << "\n";
+		}
+	}
+	if (this->cacheHitRate() >= 0.0) {
+		stream << "  metric cache: " << this->cacheHits << " hits, " << this->cacheMisses << " misses\n";
+	}
+	if (this->threadUtilization() >= 0.0) {
+		stream << "  thread utilization: " << QString::number(this->threadUtilization() * 100.0, 'f', 1) << " % of "
+		       << this->parallelWallNanoseconds << " ns parallel evaluation\n";
+	}
+	if (this->hardwareCountersRequested && !this->hardwareCounterError.isEmpty()) {
+		stream << "  hardware counters unavailable: " << this->hardwareCounterError << "\n";
+	}
+	OCTSignalProcessing::AllocationCounters allocations = this->stageTimings.totalAllocations();
+	stream << "  memory: frame copy " << this->frameCopyBytes << " bytes, processor allocations: " << allocations.allocations
+	       << " (" << allocations.bytes << " bytes, " << this->stageTimings.otherAllocations.allocations << " outside of stages)";
+	if (this->workspaceReservedBytes > 0) {
+		stream << ", workspace arenas: " << QString::number(static_cast<double>(this->workspaceReservedBytes) / MEBIBYTE, 'f', 1) << " MiB ("
+		       << QString::number(static_cast<double>(this->workspaceHugePageBytes) / MEBIBYTE, 'f', 1) << " MiB on huge pages, "
+		       << QString::number(static_cast<double>(this->workspacePeakBytes) / MEBIBYTE, 'f', 1) << " MiB peak use)";
+	}
+	if (this->residentBytesAtStart >= 0) {
+		stream << ", RSS at start: " << QString::number(static_cast<double>(this->residentBytesAtStart) / MEBIBYTE, 'f', 1) << " MiB";
+	}
+	if (this->peakResidentBytes >= 0) {
+		stream << ", peak RSS" << (this->peakResidentBytesOfRun ? "" : " since process start") << ": "
+		       << QString::number(static_cast<double>(this->peakResidentBytes) / MEBIBYTE, 'f', 1) << " MiB";
+	}
+	stream << "\n";
+	stream.flush();
+	return text;
+}
+
+QJsonObject EstimationRunReport::toJson() const
+{
+	QJsonObject json;
+	json["start_time"] = this->startTime.toString(Qt::ISODate);
+	json["live_tracking"] = this->liveTracking;
+	json["strategy"] = strategyName(this->strategy);
+	json["samples_per_line"] = this->samplesPerLine;
+	json["number_of_ascans"] = this->numberOfAscans;
+	json["number_of_threads"] = this->numberOfThreads;
+	json["evaluated_candidates"] = this->evaluatedCandidates;
+	json["total_ns"] = this->totalNanoseconds;
+	json["candidates_per_second"] = this->candidatesPerSecond();
+	json["ascans_per_second"] = this->ascansPerSecond();
+
+	QJsonObject phases;
+	for (int i = 0; i < NUMBER_OF_PHASES; ++i) {
+		phases[phaseName(static_cast<Phase>(i))] = this->phaseNanoseconds[i];
+	}
+	json["phases_ns"] = phases;
+
+	// QJsonValue has no unsigned 64-bit type
+	QJsonObject stages;
+	for (int i = 0; i < OCTSignalProcessing::NUMBER_OF_PROCESSING_STAGES; ++i) {
+		OCTSignalProcessing::ProcessingStage stage = static_cast<OCTSignalProcessing::ProcessingStage>(i);
+		QJsonObject stageJson;
+		stageJson["ns"] = static_cast<qint64>(this->stageTimings.nanoseconds[i]);
+		stageJson["calls"] = static_cast<qint64>(this->stageTimings.calls[i]);
+		stageJson["samples"] = static_cast<qint64>(this->stageTimings.samples[i]);
+		stageJson["allocations"] = static_cast<qint64>(this->stageTimings.allocations[i].allocations);
+		stageJson["allocated_bytes"] = static_cast<qint64>(this->stageTimings.allocations[i].bytes);
+		if (this->stageTimings.counterCalls[i] > 0) {
+			QJsonObject countersJson;
+			for (int j = 0; j < OCTSignalProcessing::NUMBER_OF_HARDWARE_COUNTERS; ++j) {
+				OCTSignalProcessing::HardwareCounter counter = static_cast<OCTSignalProcessing::HardwareCounter>(j);
+				countersJson[OCTSignalProcessing::HardwareCounters::counterName(counter)] = static_cast<qint64>(this->stageTimings.counters[i][j]);
+			}
+			countersJson["calls"] = static_cast<qint64>(this->stageTimings.counterCalls[i]);
+			countersJson["ipc"] = this->stageTimings.instructionsPerCycle(stage);
+			countersJson["cache_misses_per_sample"] = this->stageTimings.countsPerSample(stage, OCTSignalProcessing::COUNTER_CACHE_MISSES);
+			countersJson["branch_misses_per_sample"] = this->stageTimings.countsPerSample(stage, OCTSignalProcessing::COUNTER_BRANCH_MISSES);
+			stageJson["hardware_counters"] = countersJson;
+		}
+		stages[OCTSignalProcessing::StageTimings::stageName(stage)] = stageJson;
+	}
+	json["stages"] = stages;
+
+	OCTSignalProcessing::AllocationCounters allocations = this->stageTimings.totalAllocations();
+	QJsonObject memory;
+	memory["frame_copy_bytes"] = this->frameCopyBytes;
+	memory["allocations"] = static_cast<qint64>(allocations.allocations);
+	memory["allocated_bytes"] = static_cast<qint64>(allocations.bytes);
+	memory["allocations_outside_stages"] = static_cast<qint64>(this->stageTimings.otherAllocations.allocations);
+	memory["allocated_bytes_outside_stages"] = static_cast<qint64>(this->stageTimings.otherAllocations.bytes);
+	memory["resident_bytes_at_start"] = this->residentBytesAtStart;
+	memory["peak_resident_bytes"] = this->peakResidentBytes;
+	memory["peak_resident_bytes_of_run"] = this->peakResidentBytesOfRun;
+	memory["workspace_reserved_bytes"] = this->workspaceReservedBytes;
+	memory["workspace_huge_page_bytes"] = this->workspaceHugePageBytes;
+	memory["workspace_peak_bytes"] = this->workspacePeakBytes;
+	json["memory"] = memory;
+
+	QJsonObject cache;
+	cache["hits"] = this->cacheHits;
+	cache["misses"] = this->cacheMisses;
+	json["metric_cache"] = cache;
+	QJsonObject threads;
+	threads["busy_ns"] = this->workerBusyNanoseconds;
+	threads["parallel_wall_ns"] = this->parallelWallNanoseconds;
+	threads["utilization"] = this->threadUtilization();
+	json["threads"] = threads;
+	if (this->hardwareCountersRequested && !this->hardwareCounterError.isEmpty()) {
+		json["hardware_counter_error"] = this->hardwareCounterError;
+	}
+	return json;
+}
+
+bool EstimationRunReport::appendToFile(const QString &filePath) const
+{
+	QFile file(filePath);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
+		return false;
+	}
+	QByteArray text = this->toText().toUtf8();
+	return file.write(text) == text.size();
+}
+
+const char* EstimationRunReport::phaseName(Phase phase)
+{
+	switch (phase) {
+	case SETTINGS_LOAD: return "settings_load";
+	case FRAME_COPY: return "frame_copy";
+	case D2_SWEEP: return "d2_sweep";
+	case D3_SWEEP: return "d3_sweep";
+	case JOINT_SEARCH: return "joint_search";
+	case ASCAN_PREVIEW: return "ascan_preview";
+	default: return "unknown";
+	}
+}
+
+QString EstimationRunReport::strategyName(ESTIMATION_STRATEGY strategy)
+{
+	switch (strategy) {
+	case SEQUENTIAL_SWEEP: return "sweep";
+	case NELDER_MEAD_2D: return "nelder-mead";
+	case GRADIENT_LBFGS: return "gradient";
+	case SUCCESSIVE_HALVING: return "halving";
+	case COORDINATE_DESCENT: return "coordinate-descent";
+	default: return "unknown";
+	}
+}
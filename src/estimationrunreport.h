@@ -0,0 +1,83 @@
+#ifndef ESTIMATIONRUNREPORT_H
+#define ESTIMATIONRUNREPORT_H
+
+#include <QString>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QMetaType>
+#include "dispersionestimatorparameters.h"
+#include "octprocessor/stagetimings.h"
+
+// Where the time of one estimation run went. Phases are wall time of the engine thread, the processing
+// stages are summed over all threads that processed data during the run, so with parallel evaluation
+// their sum can exceed the wall time of the run.
+struct EstimationRunReport {
+	enum Phase {
+		SETTINGS_LOAD,
+		FRAME_COPY, // selection of the evaluated A-scans in the frame buffer
+		D2_SWEEP,
+		D3_SWEEP,
+		JOINT_SEARCH, // strategies that search d2 and d3 together
+		ASCAN_PREVIEW,
+		NUMBER_OF_PHASES
+	};
+
+	QDateTime startTime;
+	bool liveTracking; // short d2/d3 refinement of live tracking instead of a full estimation
+	ESTIMATION_STRATEGY strategy;
+	int samplesPerLine;
+	int numberOfAscans;
+	int numberOfThreads; // 1 if the candidates were evaluated serially
+	int evaluatedCandidates;
+	qint64 totalNanoseconds;
+	qint64 phaseNanoseconds[NUMBER_OF_PHASES];
+	OCTSignalProcessing::StageTimings stageTimings;
+	bool hardwareCountersRequested;
+	QString hardwareCounterError; // why the counters could not be read, empty if they were available
+
+	// Memory footprint: bytes copied out of the frame buffer (0 while the A-scans are read in place) and resident set size of the process in bytes (-1 if unknown).
+	// The peak covers only this run if the platform allows resetting it, otherwise the whole lifetime of the process.
+	qint64 frameCopyBytes;
+	qint64 residentBytesAtStart;
+	qint64 peakResidentBytes;
+	bool peakResidentBytesOfRun;
+	// Workspace arenas of the engine thread and of all workers: memory reserved for the temporary buffers of the processing
+	// calls, the part of it on huge pages and the most that was in use at once, summed over all arenas
+	qint64 workspaceReservedBytes;
+	qint64 workspaceHugePageBytes;
+	qint64 workspacePeakBytes;
+
+	// Metric cache lookups and time the parallel workers spent processing compared to the wall time of the parallel
+	// evaluations, both 0 if nothing was looked up or evaluated in parallel
+	int cacheHits;
+	int cacheMisses;
+	qint64 workerBusyNanoseconds;
+	qint64 parallelWallNanoseconds;
+
+	EstimationRunReport();
+	void reset();
+	void addPhase(Phase phase, qint64 nanoseconds);
+
+	// Candidates per second of search time (d2, d3 and joint search phases)
+	double candidatesPerSecond() const;
+	// Processed A-scans (inverse FFTs, gradient evaluations need one more per coefficient) per second of total run time
+	double ascansPerSecond() const;
+	// Fraction of metric lookups answered by the cache, -1 if there were none
+	double cacheHitRate() const;
+	// Busy fraction of the worker threads during parallel evaluation, -1 if nothing was evaluated in parallel
+	double threadUtilization() const;
+
+	// One line for the status bar
+	QString summary() const;
+	// Multi-line report for the run log file
+	QString toText() const;
+	QJsonObject toJson() const;
+	// Appends toText() to the given file, returns false if the file could not be written
+	bool appendToFile(const QString &filePath) const;
+
+	static const char* phaseName(Phase phase);
+	static QString strategyName(ESTIMATION_STRATEGY strategy);
+};
+Q_DECLARE_METATYPE(EstimationRunReport)
+
+#endif // ESTIMATIONRUNREPORT_H
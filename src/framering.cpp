@@ -0,0 +1,299 @@
+#include "framering.h"
+
+namespace {
+// true if sequence a was committed before b, the sequence numbers may wrap around
+bool isEarlier(unsigned int a, unsigned int b)
+{
+	return static_cast<int>(a - b) < 0;
+}
+}
+
+FrameRing::FrameRef::FrameRef()
+	: ring_(nullptr),
+	slot_(-1)
+{
+}
+
+FrameRing::FrameRef::FrameRef(const FrameRef &other)
+	: ring_(other.ring_),
+	slot_(other.slot_)
+{
+	if (this->ring_ != nullptr) {
+		this->ring_->slots_[this->slot_]->references.ref();
+	}
+}
+
+FrameRing::FrameRef& FrameRing::FrameRef::operator=(const FrameRef &other)
+{
+	if (this != &other) {
+		if (other.ring_ != nullptr) {
+			other.ring_->slots_[other.slot_]->references.ref();
+		}
+		this->reset();
+		this->ring_ = other.ring_;
+		this->slot_ = other.slot_;
+	}
+	return *this;
+}
+
+FrameRing::FrameRef::~FrameRef()
+{
+	this->reset();
+}
+
+void* FrameRing::FrameRef::data() const
+{
+	return this->ring_ != nullptr ? this->ring_->slots_[this->slot_]->memory.data : nullptr;
+}
+
+const FrameRing::FrameInfo& FrameRing::FrameRef::info() const
+{
+	return this->ring_->slots_[this->slot_]->info;
+}
+
+void FrameRing::FrameRef::reset()
+{
+	if (this->ring_ != nullptr && !this->ring_->slots_[this->slot_]->references.deref()) {
+		this->ring_->release(this->slot_);
+	}
+	this->ring_ = nullptr;
+	this->slot_ = -1;
+}
+
+FrameRing::FrameRing(int capacity)
+	: writingSlot_(-1),
+	nextSequence_(0),
+	dropPolicy_(DROP_OLDEST_FRAME),
+	frameBytes_(0),
+	requestedBytes_(0),
+	reservedFrameBytes_(0),
+	droppedOldest_(0),
+	droppedNewest_(0)
+{
+	for (int i = 0; i < qMax(2, capacity); ++i) {
+		Slot* slot = new Slot();
+		slot->state.storeRelease(SLOT_FREE);
+		slot->references.storeRelease(0);
+		slot->sequence.storeRelease(0);
+		slot->droppable = true;
+		slots_.append(slot);
+	}
+}
+
+FrameRing::~FrameRing()
+{
+	for (Slot* slot : slots_) {
+		OCTSignalProcessing::releasePages(slot->memory);
+		delete slot;
+	}
+}
+
+char* FrameRing::beginWrite(size_t bytes, bool droppable)
+{
+	if (this->writingSlot_ != -1) {
+		this->abortWrite();
+	}
+
+	if (droppable) {
+		this->frameBytes_.storeRelease(bytes);
+	}
+	bool freeSlotTooSmall = false;
+	bool claimed = this->claimFreeSlot(bytes, freeSlotTooSmall);
+	if (!claimed && this->dropPolicy_.loadAcquire() == DROP_OLDEST_FRAME) {
+		claimed = this->claimOldestReadySlot(bytes);
+	}
+	if (!claimed) {
+		// A free slot that is too small is not a drop caused by a busy consumer, the consumer grows one for the next frame
+		if (freeSlotTooSmall) {
+			this->requestedBytes_.storeRelease(bytes);
+		} else {
+			this->droppedNewest_.ref();
+		}
+		return nullptr;
+	}
+	this->slots_[this->writingSlot_]->droppable = droppable;
+	return this->slots_[this->writingSlot_]->memory.data;
+}
+
+void FrameRing::commitWrite(const FrameInfo &info)
+{
+	if (this->writingSlot_ == -1) {
+		return;
+	}
+	Slot* slot = this->slots_[this->writingSlot_];
+	slot->info = info;
+	slot->sequence.storeRelease(this->nextSequence_++);
+	slot->state.storeRelease(SLOT_READY);
+	this->writingSlot_ = -1;
+}
+
+void FrameRing::abortWrite()
+{
+	if (this->writingSlot_ == -1) {
+		return;
+	}
+	this->slots_[this->writingSlot_]->state.storeRelease(SLOT_FREE);
+	this->writingSlot_ = -1;
+}
+
+void FrameRing::setDropPolicy(FRAME_DROP_POLICY policy)
+{
+	this->dropPolicy_.storeRelease(policy);
+}
+
+bool FrameRing::takeNext(FrameRef &frame)
+{
+	frame.reset();
+
+	// The producer may commit or replace frames during the search, so the claim is retried if the frame was replaced by
+	// a newer one or if an older frame was committed behind the search
+	forever {
+		int oldest = -1;
+		unsigned int oldestSequence = 0;
+		for (int i = 0; i < this->slots_.size(); ++i) {
+			if (this->slots_[i]->state.loadAcquire() != SLOT_READY) {
+				continue;
+			}
+			unsigned int sequence = this->slots_[i]->sequence.loadAcquire();
+			if (oldest == -1 || isEarlier(sequence, oldestSequence)) {
+				oldest = i;
+				oldestSequence = sequence;
+			}
+		}
+		if (oldest == -1) {
+			return false;
+		}
+		Slot* slot = this->slots_[oldest];
+		if (slot->state.testAndSetAcquire(SLOT_READY, SLOT_READING)) {
+			if (slot->sequence.loadAcquire() != oldestSequence || this->hasReadyFrameBefore(oldestSequence)) {
+				slot->state.storeRelease(SLOT_READY);
+				continue;
+			}
+			slot->references.storeRelease(1);
+			frame.ring_ = this;
+			frame.slot_ = oldest;
+			return true;
+		}
+	}
+}
+
+void FrameRing::reserveSlotMemory()
+{
+	// Slots that are in use when the frame size changes are resized when they are released
+	size_t frameBytes = static_cast<size_t>(this->frameBytes_.loadAcquire());
+	if (frameBytes != this->reservedFrameBytes_) {
+		for (Slot* slot : slots_) {
+			if (slot->state.testAndSetAcquire(SLOT_FREE, SLOT_RESIZING)) {
+				if (slot->memory.bytes < frameBytes) {
+					this->resizeSlot(slot, frameBytes);
+				}
+				slot->state.storeRelease(SLOT_FREE);
+			}
+		}
+		this->reservedFrameBytes_ = frameBytes;
+	}
+
+	// Only one slot is grown for a larger frame. If no slot is free, the producer asks again with its next frame.
+	size_t requestedBytes = static_cast<size_t>(this->requestedBytes_.fetchAndStoreOrdered(0));
+	if (requestedBytes == 0) {
+		return;
+	}
+	for (Slot* slot : slots_) {
+		if (slot->state.testAndSetAcquire(SLOT_FREE, SLOT_RESIZING)) {
+			if (slot->memory.bytes < requestedBytes) {
+				this->resizeSlot(slot, requestedBytes);
+			}
+			slot->state.storeRelease(SLOT_FREE);
+			return;
+		}
+	}
+}
+
+void FrameRing::discardWaiting()
+{
+	FrameRef frame;
+	while (this->takeNext(frame)) {
+		frame.reset();
+	}
+}
+
+bool FrameRing::hasReadyFrameBefore(unsigned int sequence) const
+{
+	for (Slot* slot : slots_) {
+		if (slot->state.loadAcquire() == SLOT_READY && isEarlier(slot->sequence.loadAcquire(), sequence)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int FrameRing::getDroppedOldest() const
+{
+	return this->droppedOldest_.loadAcquire();
+}
+
+int FrameRing::getDroppedNewest() const
+{
+	return this->droppedNewest_.loadAcquire();
+}
+
+bool FrameRing::claimFreeSlot(size_t bytes, bool &freeSlotTooSmall)
+{
+	for (int i = 0; i < this->slots_.size(); ++i) {
+		Slot* slot = this->slots_[i];
+		if (!slot->state.testAndSetAcquire(SLOT_FREE, SLOT_WRITING)) {
+			continue;
+		}
+		if (slot->memory.bytes >= bytes) {
+			this->writingSlot_ = i;
+			return true;
+		}
+		slot->state.storeRelease(SLOT_FREE);
+		freeSlotTooSmall = true;
+	}
+	return false;
+}
+
+bool FrameRing::claimOldestReadySlot(size_t bytes)
+{
+	// Only the producer writes sequence numbers and the droppable flag, so the oldest droppable frame can be picked
+	// before it is claimed. If the consumer takes it first or it is too small, the incoming frame is dropped instead.
+	int oldest = -1;
+	for (int i = 0; i < this->slots_.size(); ++i) {
+		Slot* slot = this->slots_[i];
+		if (slot->state.loadAcquire() != SLOT_READY || !slot->droppable) {
+			continue;
+		}
+		if (oldest == -1 || isEarlier(slot->sequence.loadAcquire(), this->slots_[oldest]->sequence.loadAcquire())) {
+			oldest = i;
+		}
+	}
+	if (oldest == -1 || !this->slots_[oldest]->state.testAndSetAcquire(SLOT_READY, SLOT_WRITING)) {
+		return false;
+	}
+	if (this->slots_[oldest]->memory.bytes < bytes) {
+		this->slots_[oldest]->state.storeRelease(SLOT_READY);
+		return false;
+	}
+	this->droppedOldest_.ref();
+	this->writingSlot_ = oldest;
+	return true;
+}
+
+void FrameRing::resizeSlot(Slot* slot, size_t bytes)
+{
+	OCTSignalProcessing::releasePages(slot->memory);
+	slot->memory = OCTSignalProcessing::allocatePages(bytes);
+}
+
+void FrameRing::release(int slot)
+{
+	// Runs on the thread that held the last reference, which is never the producer. A slot that held a larger frame
+	// goes back to the size of the latest droppable frame, allocations are rounded up to at most one more block.
+	Slot* releasedSlot = this->slots_[slot];
+	size_t frameBytes = static_cast<size_t>(this->frameBytes_.loadAcquire());
+	if (frameBytes > 0 && (releasedSlot->memory.bytes < frameBytes || releasedSlot->memory.bytes >= frameBytes + ARENA_BLOCK_BYTES)) {
+		this->resizeSlot(releasedSlot, frameBytes);
+	}
+	releasedSlot->state.storeRelease(SLOT_FREE);
+}
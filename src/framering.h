@@ -0,0 +1,110 @@
+#ifndef FRAMERING_H
+#define FRAMERING_H
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QVector>
+#include <cstddef>
+#include "dispersionestimatorparameters.h"
+#include "octprocessor/memoryarena.h"
+
+// Fixed number of preallocated frame slots between the acquisition callback (single producer) and the engine thread
+// (single consumer). Neither side blocks and the producer never allocates: slot memory is only resized by the consumer,
+// a frame that does not fit into any slot yet is dropped and the consumer resizes a free slot before it takes the next
+// frame. All slots are kept at the size of the latest droppable frame, a larger frame (the pooled frames of a single
+// fetch) gets a single slot of its size, which goes back to the common size when it is released. If all slots are in
+// use the drop policy decides whether the incoming frame or the oldest waiting one is dropped. Frames that are marked
+// as not droppable (single fetches) are never replaced.
+class FrameRing
+{
+public:
+	struct FrameInfo {
+		unsigned int bitDepth;
+		unsigned int samplesPerLine;
+		unsigned int linesPerFrame;
+		unsigned int numberOfFrames;
+		bool isTrackingFrame;
+	};
+
+	// Reference to a frame taken by the consumer. The slot is given back to the producer when the last reference is
+	// released, so the data stays valid for as long as a reference exists.
+	class FrameRef
+	{
+	public:
+		FrameRef();
+		FrameRef(const FrameRef &other);
+		FrameRef& operator=(const FrameRef &other);
+		~FrameRef();
+
+		bool isNull() const { return this->ring_ == nullptr; }
+		void* data() const;
+		const FrameInfo& info() const;
+		void reset();
+
+	private:
+		friend class FrameRing;
+
+		FrameRing* ring_;
+		int slot_;
+	};
+
+	explicit FrameRing(int capacity);
+	~FrameRing();
+
+	// Producer side, only to be called from the acquisition thread. beginWrite returns the memory of a slot with at
+	// least the given size or nullptr if the frame has to be dropped. The slot stays with the producer until it is
+	// committed or aborted, so frames can be collected over several callbacks.
+	char* beginWrite(size_t bytes, bool droppable);
+	void commitWrite(const FrameInfo &info);
+	void abortWrite();
+	bool isWriting() const { return this->writingSlot_ != -1; }
+	void setDropPolicy(FRAME_DROP_POLICY policy);
+
+	// Consumer side. takeNext returns the oldest waiting frame. reserveSlotMemory resizes free slots to the sizes the
+	// producer asked for and must only be called from one thread, discardWaiting drops all waiting frames without
+	// counting them.
+	bool takeNext(FrameRef &frame);
+	void reserveSlotMemory();
+	void discardWaiting();
+
+	// Drop counters since construction, may be read from any thread. Frames that only found free slots that are too
+	// small for them are not counted, a slot is grown and the next frame fits.
+	int getDroppedOldest() const;
+	int getDroppedNewest() const;
+
+private:
+	enum SlotState {
+		SLOT_FREE,
+		SLOT_WRITING,
+		SLOT_READY,
+		SLOT_READING,
+		SLOT_RESIZING
+	};
+
+	struct Slot {
+		QAtomicInt state;
+		QAtomicInt references;
+		QAtomicInteger<unsigned int> sequence; // order of the committed frames, compared with wrap-around
+		OCTSignalProcessing::PageBlock memory; // huge page backed where available, frames are several megabytes
+		bool droppable;
+		FrameInfo info;
+	};
+
+	QVector<Slot*> slots_;
+	int writingSlot_;
+	unsigned int nextSequence_;
+	QAtomicInt dropPolicy_;
+	QAtomicInteger<quintptr> frameBytes_; // size of the latest droppable frame
+	QAtomicInteger<quintptr> requestedBytes_; // frame that found no free slot of its size, one slot is grown to it
+	size_t reservedFrameBytes_; // frameBytes_ at the last reserveSlotMemory
+	QAtomicInt droppedOldest_;
+	QAtomicInt droppedNewest_;
+
+	bool claimFreeSlot(size_t bytes, bool &freeSlotTooSmall);
+	bool claimOldestReadySlot(size_t bytes);
+	bool hasReadyFrameBefore(unsigned int sequence) const;
+	void resizeSlot(Slot* slot, size_t bytes);
+	void release(int slot);
+};
+
+#endif // FRAMERING_H
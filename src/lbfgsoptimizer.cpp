@@ -0,0 +1,225 @@
+#include "lbfgsoptimizer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	//sufficient decrease constant of the Armijo condition
+	const double ARMIJO_CONSTANT = 1e-4;
+	const double BACKTRACKING_FACTOR = 0.5;
+	const int MAX_LINE_SEARCH_STEPS = 20;
+
+	double dot(const std::vector<double> &a, const std::vector<double> &b)
+	{
+		double sum = 0.0;
+		for (size_t i = 0; i < a.size(); ++i) {
+			sum += a[i] * b[i];
+		}
+		return sum;
+	}
+
+	double maxAbs(const std::vector<double> &a)
+	{
+		double maxValue = 0.0;
+		for (double value : a) {
+			maxValue = std::max(maxValue, std::fabs(value));
+		}
+		return maxValue;
+	}
+}
+
+LbfgsOptimizer::LbfgsOptimizer()
+	: maxIterations_(50),
+	maxEvaluations_(100),
+	historySize_(5),
+	tolerance_(1e-3),
+	initialStepLength_(0.25)
+{
+}
+
+void LbfgsOptimizer::setMaxIterations(int maxIterations)
+{
+	maxIterations_ = std::max(1, maxIterations);
+}
+
+void LbfgsOptimizer::setMaxEvaluations(int maxEvaluations)
+{
+	maxEvaluations_ = std::max(1, maxEvaluations);
+}
+
+void LbfgsOptimizer::setHistorySize(int historySize)
+{
+	historySize_ = std::max(1, historySize);
+}
+
+void LbfgsOptimizer::setTolerance(double tolerance)
+{
+	tolerance_ = tolerance;
+}
+
+void LbfgsOptimizer::setInitialStepLength(double stepLength)
+{
+	initialStepLength_ = stepLength;
+}
+
+void LbfgsOptimizer::setStopCondition(const StopCondition &stopCondition)
+{
+	stopCondition_ = stopCondition;
+}
+
+LbfgsOptimizer::Result LbfgsOptimizer::maximize(const Objective &objective,
+												const std::vector<double> &start,
+												const std::vector<double> &lowerBound,
+												const std::vector<double> &upperBound)
+{
+	const size_t n = start.size();
+	Result result;
+	result.iterations = 0;
+	result.evaluations = 0;
+	result.converged = false;
+
+	auto project = [&](std::vector<double> point) {
+		for (size_t i = 0; i < n; ++i) {
+			point[i] = std::min(std::max(point[i], lowerBound[i]), upperBound[i]);
+		}
+		return point;
+	};
+	//the objective is minimized internally, so value and gradient are negated
+	auto evaluate = [&](const std::vector<double> &point, std::vector<double> &gradient) {
+		result.evaluations++;
+		double value = objective(point, gradient);
+		for (double &component : gradient) {
+			component = -component;
+		}
+		return -value;
+	};
+	auto stopRequested = [&]() {
+		return (stopCondition_ && stopCondition_()) || result.evaluations >= maxEvaluations_;
+	};
+
+	std::vector<double> x = project(start);
+	std::vector<double> gradient(n, 0.0);
+	double value = evaluate(x, gradient);
+
+	std::deque<std::vector<double>> historyS;
+	std::deque<std::vector<double>> historyY;
+
+	while (result.iterations < maxIterations_ && !stopRequested()) {
+		result.iterations++;
+
+		//components of the gradient that push against an active bound are ignored
+		std::vector<double> projectedGradient = gradient;
+		for (size_t i = 0; i < n; ++i) {
+			if ((x[i] <= lowerBound[i] && gradient[i] > 0.0) || (x[i] >= upperBound[i] && gradient[i] < 0.0)) {
+				projectedGradient[i] = 0.0;
+			}
+		}
+		if (maxAbs(projectedGradient) == 0.0) {
+			result.converged = true;
+			break;
+		}
+
+		//two-loop recursion to compute the quasi-Newton direction
+		std::vector<double> direction = projectedGradient;
+		std::vector<double> alpha(historyS.size());
+		for (size_t k = historyS.size(); k-- > 0;) {
+			double rho = 1.0 / dot(historyY[k], historyS[k]);
+			alpha[k] = rho * dot(historyS[k], direction);
+			for (size_t i = 0; i < n; ++i) {
+				direction[i] -= alpha[k] * historyY[k][i];
+			}
+		}
+		if (historyS.empty()) {
+			double scale = initialStepLength_ / maxAbs(direction);
+			for (double &component : direction) {
+				component *= scale;
+			}
+		} else {
+			double gamma = dot(historyS.back(), historyY.back()) / dot(historyY.back(), historyY.back());
+			for (double &component : direction) {
+				component *= gamma;
+			}
+		}
+		for (size_t k = 0; k < historyS.size(); ++k) {
+			double rho = 1.0 / dot(historyY[k], historyS[k]);
+			double beta = rho * dot(historyY[k], direction);
+			for (size_t i = 0; i < n; ++i) {
+				direction[i] += historyS[k][i] * (alpha[k] - beta);
+			}
+		}
+		for (double &component : direction) {
+			component = -component;
+		}
+
+		//fall back to steepest descent if the curvature information does not yield a descent direction
+		if (dot(direction, projectedGradient) >= 0.0) {
+			historyS.clear();
+			historyY.clear();
+			double scale = initialStepLength_ / maxAbs(projectedGradient);
+			for (size_t i = 0; i < n; ++i) {
+				direction[i] = -projectedGradient[i] * scale;
+			}
+		}
+
+		//backtracking line search on the projected path
+		bool accepted = false;
+		double stepFactor = 1.0;
+		std::vector<double> nextX;
+		std::vector<double> nextGradient(n, 0.0);
+		double nextValue = value;
+		for (int step = 0; step < MAX_LINE_SEARCH_STEPS && !stopRequested(); ++step) {
+			nextX = x;
+			for (size_t i = 0; i < n; ++i) {
+				nextX[i] += stepFactor * direction[i];
+			}
+			nextX = project(nextX);
+			std::vector<double> displacement(n);
+			for (size_t i = 0; i < n; ++i) {
+				displacement[i] = nextX[i] - x[i];
+			}
+			nextValue = evaluate(nextX, nextGradient);
+			if (nextValue <= value + ARMIJO_CONSTANT * dot(gradient, displacement)) {
+				accepted = true;
+				break;
+			}
+			stepFactor *= BACKTRACKING_FACTOR;
+		}
+		if (!accepted) {
+			if (historyS.empty()) {
+				break;
+			}
+			//curvature information may be outdated, retry with steepest descent
+			historyS.clear();
+			historyY.clear();
+			continue;
+		}
+
+		std::vector<double> s(n);
+		std::vector<double> y(n);
+		for (size_t i = 0; i < n; ++i) {
+			s[i] = nextX[i] - x[i];
+			y[i] = nextGradient[i] - gradient[i];
+		}
+		x = nextX;
+		value = nextValue;
+		gradient = nextGradient;
+
+		if (maxAbs(s) < tolerance_) {
+			result.converged = true;
+			break;
+		}
+
+		//only keep curvature pairs that keep the inverse Hessian approximation positive definite
+		if (dot(s, y) > 1e-12 * dot(y, y)) {
+			historyS.push_back(s);
+			historyY.push_back(y);
+			if (static_cast<int>(historyS.size()) > historySize_) {
+				historyS.pop_front();
+				historyY.pop_front();
+			}
+		}
+	}
+
+	result.position = x;
+	result.value = -value;
+	return result;
+}
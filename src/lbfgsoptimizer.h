@@ -0,0 +1,51 @@
+#ifndef LBFGSOPTIMIZER_H
+#define LBFGSOPTIMIZER_H
+
+#include <vector>
+#include <deque>
+#include <functional>
+
+// Limited-memory BFGS quasi-Newton optimizer that maximizes a smooth objective function with
+// known gradient within box constraints. Steps are projected onto the box and accepted with
+// a backtracking (Armijo) line search.
+class LbfgsOptimizer
+{
+public:
+	// Returns the objective value at the given position and writes the gradient into the second argument
+	using Objective = std::function<double(const std::vector<double>&, std::vector<double>&)>;
+	using StopCondition = std::function<bool()>;
+
+	struct Result {
+		std::vector<double> position;
+		double value;
+		int iterations;
+		int evaluations;
+		bool converged;
+	};
+
+	LbfgsOptimizer();
+
+	void setMaxIterations(int maxIterations);
+	void setMaxEvaluations(int maxEvaluations);
+	void setHistorySize(int historySize);
+	// Convergence is reached if a step moves every coordinate less than this tolerance
+	void setTolerance(double tolerance);
+	// Length of the very first step (infinity norm), subsequent steps are scaled by the curvature estimate
+	void setInitialStepLength(double stepLength);
+	void setStopCondition(const StopCondition &stopCondition);
+
+	Result maximize(const Objective &objective,
+					const std::vector<double> &start,
+					const std::vector<double> &lowerBound,
+					const std::vector<double> &upperBound);
+
+private:
+	int maxIterations_;
+	int maxEvaluations_;
+	int historySize_;
+	double tolerance_;
+	double initialStepLength_;
+	StopCondition stopCondition_;
+};
+
+#endif // LBFGSOPTIMIZER_H
@@ -129,6 +129,16 @@ void LinePlot::updateSecondCurve(double x, double y)
 	replot();
 }
 
+void LinePlot::appendToFirstCurve(const QVector<QPointF> &points)
+{
+	appendToCurve(0, m_d2X, m_d2Y, points);
+}
+
+void LinePlot::appendToSecondCurve(const QVector<QPointF> &points)
+{
+	appendToCurve(1, m_d3X, m_d3Y, points);
+}
+
 void LinePlot::setFirstCurve(QVector<float> curveData)
 {
 	m_d2X.clear();
@@ -224,6 +234,32 @@ void LinePlot::contextMenuEvent(QContextMenuEvent *event)
 	menu.exec(event->globalPos());
 }
 
+void LinePlot::appendToCurve(int graphIndex, QVector<double> &xData, QVector<double> &yData, const QVector<QPointF> &points)
+{
+	if (points.isEmpty())
+		return;
+
+	for (const QPointF &point : points)
+	{
+		xData.append(point.x());
+		yData.append(point.y());
+	}
+	m_dataPointCounter += points.size();
+
+	// Remove old data if exceeding maximum allowed points.
+	int excess = xData.size() - m_maxDataPoints;
+	if (excess > 0)
+	{
+		xData.remove(0, excess);
+		yData.remove(0, excess);
+	}
+
+	this->graph(graphIndex)->setData(xData, yData, true);
+
+	this->rescaleAxes();
+	replot();
+}
+
 void LinePlot::setupInteractions()
 {
 	this->setInteraction(QCP::iRangeDrag, true);
@@ -30,6 +30,10 @@ public:
 	// 'x' represents the dispersion parameter value (d3) and 'y' its metric value.
 	void updateSecondCurve(double x, double y);
 
+	// Append several data points at once with a single replot.
+	void appendToFirstCurve(const QVector<QPointF> &points);
+	void appendToSecondCurve(const QVector<QPointF> &points);
+
 	void setFirstCurve(QVector<float> curveData);
 	void setSecondCurve(QVector<float> curveData);
 
@@ -60,6 +64,8 @@ private:
 
 	// Configure interactive features such as zooming and dragging.
 	void setupInteractions();
+
+	void appendToCurve(int graphIndex, QVector<double> &xData, QVector<double> &yData, const QVector<QPointF> &points);
 };
 
 #endif // LINEPLOT_H
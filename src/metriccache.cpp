@@ -0,0 +1,132 @@
+#include "metriccache.h"
+#include <QCryptographicHash>
+#include <cmath>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFileInfo>
+
+MetricCache::MetricCache(int maxEntries)
+	: cache_(qMax(1, maxEntries)),
+	hits_(0),
+	misses_(0)
+{
+}
+
+void MetricCache::setMaxEntries(int maxEntries)
+{
+	cache_.setMaxCost(qMax(1, maxEntries));
+}
+
+void MetricCache::clear()
+{
+	cache_.clear();
+	this->invalidateData();
+	contextKey_.clear();
+}
+
+void MetricCache::setContext(const OCTSignalProcessing::SpectrumView &rawData, const ProcessorController::ProcessingSettings &settings, const DispersionEstimatorParameters &params)
+{
+	bool sameView = rawData.base == contextData_.base && rawData.lineStrideBytes == contextData_.lineStrideBytes
+			&& rawData.numberOfLines == contextData_.numberOfLines && rawData.lineIndices == contextData_.lineIndices;
+	if (dataHash_.isEmpty() || !sameView) {
+		// Only the samples of the spectra are hashed, not the gaps between them
+		size_t bytesPerSample = static_cast<size_t>(ceil(static_cast<double>(settings.bitDepth) / 8.0));
+		int bytesPerLine = static_cast<int>(settings.samplesPerSpectrum * bytesPerSample);
+		QCryptographicHash hash(QCryptographicHash::Md5);
+		for (size_t line = 0; line < rawData.numberOfLines; ++line) {
+			hash.addData(rawData.lineData(line), bytesPerLine);
+		}
+		contextData_ = rawData;
+		dataHash_ = hash.result();
+	}
+	contextKey_ = dataHash_ + hashSettings(settings, params);
+}
+
+bool MetricCache::lookup(const QVector<qreal> &coefficients, float &metricValue)
+{
+	const float *cachedValue = cache_.object(keyFor(coefficients));
+	if (cachedValue == nullptr) {
+		misses_++;
+		return false;
+	}
+	hits_++;
+	metricValue = *cachedValue;
+	return true;
+}
+
+void MetricCache::insert(const QVector<qreal> &coefficients, float metricValue)
+{
+	cache_.insert(keyFor(coefficients), new float(metricValue));
+}
+
+void MetricCache::invalidateData()
+{
+	contextData_ = OCTSignalProcessing::SpectrumView();
+	dataHash_.clear();
+}
+
+int MetricCache::getHits() const
+{
+	return hits_;
+}
+
+int MetricCache::getMisses() const
+{
+	return misses_;
+}
+
+void MetricCache::resetStatistics()
+{
+	hits_ = 0;
+	misses_ = 0;
+}
+
+QByteArray MetricCache::keyFor(const QVector<qreal> &coefficients) const
+{
+	int size = coefficients.size();
+	while (size > 0 && coefficients.at(size - 1) == 0.0) {
+		size--;
+	}
+
+	QByteArray key = contextKey_;
+	key.reserve(contextKey_.size() + size * static_cast<int>(sizeof(double)));
+	for (int i = 0; i < size; i++) {
+		double value = static_cast<double>(coefficients.at(i)) + 0.0; // -0.0 and 0.0 get the same key
+		key.append(reinterpret_cast<const char*>(&value), static_cast<int>(sizeof(double)));
+	}
+	return key;
+}
+
+QByteArray MetricCache::hashSettings(const ProcessorController::ProcessingSettings &settings, const DispersionEstimatorParameters &params)
+{
+	QByteArray serializedSettings;
+	QDataStream stream(&serializedSettings, QIODevice::WriteOnly);
+
+	// Processing settings. d2 and higher are the candidate coefficients and therefore part of the entry key.
+	stream << settings.bitDepth
+	       << static_cast<quint64>(settings.samplesPerSpectrum)
+	       << static_cast<quint64>(settings.spectraPerFrame)
+	       << static_cast<quint64>(settings.rollingAverageWindowSize);
+	const auto &options = settings.processingOptions;
+	stream << options.removeDC << options.resample << options.useCustomResamplingCurve << options.compensateDispersion
+	       << options.applyWindow << options.computeIFFT << options.logScale;
+	for (size_t i = 0; i < settings.dispersionCoefficients.size() && i < 2; i++) {
+		stream << settings.dispersionCoefficients[i];
+	}
+	stream << static_cast<quint32>(settings.resamplingCoefficients.size());
+	for (float coefficient : settings.resamplingCoefficients) {
+		stream << coefficient;
+	}
+
+	// The custom resampling curve is read from a file that OCTproZ may overwrite at any time
+	if (options.useCustomResamplingCurve) {
+		QString curvePath = QString::fromStdString(settings.filePathCustomResamplingCurve);
+		stream << curvePath << QFileInfo(curvePath).lastModified().toMSecsSinceEpoch();
+	}
+	stream << settings.logScaleCoeff << settings.logScaleMin << settings.logScaleMax << settings.logScaleAddend << settings.autoComputeLogScaleMinMax;
+
+	// Metric parameters
+	stream << static_cast<int>(params.sharpnessMetric) << params.metricThreshold << params.numberOfAscanSamplesToIgnore << params.useLinearAscans;
+
+	return QCryptographicHash::hash(serializedSettings, QCryptographicHash::Md5);
+}
@@ -0,0 +1,50 @@
+#ifndef METRICCACHE_H
+#define METRICCACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QVector>
+#include "dispersionestimatorparameters.h"
+#include "octprocessor/processorcontroller.h"
+
+// Remembers metric values of evaluated dispersion candidates across estimation runs.
+// Entries are keyed by a hash of the raw data and of all settings that influence the metric,
+// together with the candidate coefficients, so repeated runs on the same data only compute
+// candidates that were not evaluated before. The least recently used entries are dropped first.
+class MetricCache
+{
+public:
+	explicit MetricCache(int maxEntries = 100000);
+
+	void setMaxEntries(int maxEntries);
+	void clear();
+
+	// Selects the data and settings that following lookups and insertions refer to. The data is only
+	// hashed again if rawData is not the same view (buffer, stride and line list) as in the previous call.
+	void setContext(const OCTSignalProcessing::SpectrumView &rawData, const ProcessorController::ProcessingSettings &settings, const DispersionEstimatorParameters &params);
+	// The views point into buffers that are reused for later frames, so the data has to be hashed again
+	// after the memory behind a view was overwritten
+	void invalidateData();
+
+	// coefficients are (d2, d3, d4, ...), trailing zero coefficients do not change the key
+	bool lookup(const QVector<qreal> &coefficients, float &metricValue);
+	void insert(const QVector<qreal> &coefficients, float metricValue);
+
+	// Number of lookups since the last call of resetStatistics()
+	int getHits() const;
+	int getMisses() const;
+	void resetStatistics();
+
+private:
+	QCache<QByteArray, float> cache_;
+	OCTSignalProcessing::SpectrumView contextData_;
+	QByteArray dataHash_;
+	QByteArray contextKey_;
+	int hits_;
+	int misses_;
+
+	QByteArray keyFor(const QVector<qreal> &coefficients) const;
+	static QByteArray hashSettings(const ProcessorController::ProcessingSettings &settings, const DispersionEstimatorParameters &params);
+};
+
+#endif // METRICCACHE_H
@@ -0,0 +1,252 @@
+#include "neldermeadoptimizer.h"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <limits>
+
+namespace {
+	//standard Nelder-Mead coefficients
+	const double REFLECTION = 1.0;
+	const double EXPANSION = 2.0;
+	const double CONTRACTION = 0.5;
+	const double SHRINK = 0.5;
+
+	//ratio between simplex volume and diameter^n below which the simplex is considered degenerate
+	const double DEGENERATE_VOLUME_RATIO = 1e-4;
+}
+
+NelderMeadOptimizer::NelderMeadOptimizer()
+	: maxEvaluations_(200),
+	maxRestarts_(3),
+	tolerance_(1e-3)
+{
+}
+
+void NelderMeadOptimizer::setMaxEvaluations(int maxEvaluations)
+{
+	maxEvaluations_ = std::max(1, maxEvaluations);
+}
+
+void NelderMeadOptimizer::setMaxRestarts(int maxRestarts)
+{
+	maxRestarts_ = std::max(0, maxRestarts);
+}
+
+void NelderMeadOptimizer::setTolerance(double tolerance)
+{
+	tolerance_ = tolerance;
+}
+
+void NelderMeadOptimizer::setStopCondition(const StopCondition &stopCondition)
+{
+	stopCondition_ = stopCondition;
+}
+
+NelderMeadOptimizer::Result NelderMeadOptimizer::maximize(const Objective &objective,
+														  const std::vector<double> &start,
+														  const std::vector<double> &initialStep,
+														  const std::vector<double> &lowerBound,
+														  const std::vector<double> &upperBound)
+{
+	const size_t n = start.size();
+	Result result;
+	result.evaluations = 0;
+	result.restarts = 0;
+
+	//the simplex is minimized internally, so the objective is negated
+	auto evaluate = [&](const std::vector<double> &point) {
+		result.evaluations++;
+		return -objective(point);
+	};
+	auto budgetLeft = [&]() {
+		if (stopCondition_ && stopCondition_()) {
+			return false;
+		}
+		return result.evaluations < maxEvaluations_;
+	};
+
+	std::vector<double> best = clampToBounds(start, lowerBound, upperBound);
+	double bestValue = evaluate(best);
+	std::vector<double> step = initialStep;
+
+	std::vector<std::vector<double>> simplex(n + 1);
+	std::vector<double> values(n + 1);
+	std::vector<size_t> order(n + 1);
+
+	while (budgetLeft()) {
+		//build simplex around current best point
+		simplex[0] = best;
+		values[0] = bestValue;
+		for (size_t i = 0; i < n && budgetLeft(); ++i) {
+			std::vector<double> vertex = best;
+			vertex[i] += step[i];
+			if (vertex[i] > upperBound[i]) {
+				vertex[i] = best[i] - step[i];
+			}
+			simplex[i + 1] = clampToBounds(vertex, lowerBound, upperBound);
+			values[i + 1] = evaluate(simplex[i + 1]);
+		}
+		if (!budgetLeft()) {
+			break;
+		}
+
+		bool degenerate = false;
+		while (budgetLeft()) {
+			std::iota(order.begin(), order.end(), 0);
+			std::sort(order.begin(), order.end(), [&values](size_t a, size_t b) { return values[a] < values[b]; });
+			std::vector<std::vector<double>> sortedSimplex(n + 1);
+			std::vector<double> sortedValues(n + 1);
+			for (size_t i = 0; i <= n; ++i) {
+				sortedSimplex[i] = simplex[order[i]];
+				sortedValues[i] = values[order[i]];
+			}
+			simplex.swap(sortedSimplex);
+			values.swap(sortedValues);
+
+			double diameter = normalizedDiameter(simplex, initialStep);
+			if (diameter < tolerance_) {
+				break;
+			}
+			if (normalizedVolume(simplex, initialStep) < DEGENERATE_VOLUME_RATIO * std::pow(diameter, static_cast<double>(n))) {
+				degenerate = true;
+				break;
+			}
+
+			//centroid of all vertices except the worst one
+			std::vector<double> centroid(n, 0.0);
+			for (size_t i = 0; i < n; ++i) {
+				for (size_t j = 0; j < n; ++j) {
+					centroid[j] += simplex[i][j] / static_cast<double>(n);
+				}
+			}
+
+			auto pointAlong = [&](const std::vector<double> &from, double factor) {
+				std::vector<double> point(n);
+				for (size_t j = 0; j < n; ++j) {
+					point[j] = centroid[j] + factor * (from[j] - centroid[j]);
+				}
+				return clampToBounds(point, lowerBound, upperBound);
+			};
+
+			std::vector<double> reflected = pointAlong(simplex[n], -REFLECTION);
+			double reflectedValue = evaluate(reflected);
+
+			if (reflectedValue < values[0]) {
+				if (!budgetLeft()) {
+					simplex[n] = reflected;
+					values[n] = reflectedValue;
+					break;
+				}
+				std::vector<double> expanded = pointAlong(simplex[n], -REFLECTION * EXPANSION);
+				double expandedValue = evaluate(expanded);
+				if (expandedValue < reflectedValue) {
+					simplex[n] = expanded;
+					values[n] = expandedValue;
+				} else {
+					simplex[n] = reflected;
+					values[n] = reflectedValue;
+				}
+			} else if (reflectedValue < values[n - 1]) {
+				simplex[n] = reflected;
+				values[n] = reflectedValue;
+			} else {
+				if (!budgetLeft()) {
+					break;
+				}
+				bool outside = reflectedValue < values[n];
+				std::vector<double> contracted = outside ? pointAlong(reflected, CONTRACTION) : pointAlong(simplex[n], CONTRACTION);
+				double contractedValue = evaluate(contracted);
+				if (contractedValue < std::min(reflectedValue, values[n])) {
+					simplex[n] = contracted;
+					values[n] = contractedValue;
+				} else {
+					//shrink towards best vertex
+					for (size_t i = 1; i <= n && budgetLeft(); ++i) {
+						for (size_t j = 0; j < n; ++j) {
+							simplex[i][j] = simplex[0][j] + SHRINK * (simplex[i][j] - simplex[0][j]);
+						}
+						values[i] = evaluate(simplex[i]);
+					}
+				}
+			}
+		}
+
+		size_t bestIndex = static_cast<size_t>(std::min_element(values.begin(), values.end()) - values.begin());
+		if (values[bestIndex] <= bestValue) {
+			best = simplex[bestIndex];
+			bestValue = values[bestIndex];
+		}
+
+		//restart with a fresh, smaller simplex if the current one collapsed before convergence
+		if (degenerate && result.restarts < maxRestarts_) {
+			result.restarts++;
+			for (size_t i = 0; i < n; ++i) {
+				step[i] = initialStep[i] * std::pow(0.5, result.restarts);
+			}
+			continue;
+		}
+		break;
+	}
+
+	result.position = best;
+	result.value = -bestValue;
+	return result;
+}
+
+std::vector<double> NelderMeadOptimizer::clampToBounds(std::vector<double> point, const std::vector<double> &lowerBound, const std::vector<double> &upperBound) const
+{
+	for (size_t i = 0; i < point.size(); ++i) {
+		point[i] = std::min(std::max(point[i], lowerBound[i]), upperBound[i]);
+	}
+	return point;
+}
+
+double NelderMeadOptimizer::normalizedVolume(const std::vector<std::vector<double>> &simplex, const std::vector<double> &initialStep) const
+{
+	//absolute determinant of the edge matrix, computed with gaussian elimination and partial pivoting
+	const size_t n = simplex.size() - 1;
+	std::vector<std::vector<double>> edges(n, std::vector<double>(n));
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t j = 0; j < n; ++j) {
+			double scale = initialStep[j] != 0.0 ? initialStep[j] : 1.0;
+			edges[i][j] = (simplex[i + 1][j] - simplex[0][j]) / scale;
+		}
+	}
+
+	double determinant = 1.0;
+	for (size_t col = 0; col < n; ++col) {
+		size_t pivot = col;
+		for (size_t row = col + 1; row < n; ++row) {
+			if (std::fabs(edges[row][col]) > std::fabs(edges[pivot][col])) {
+				pivot = row;
+			}
+		}
+		if (edges[pivot][col] == 0.0) {
+			return 0.0;
+		}
+		std::swap(edges[pivot], edges[col]);
+		determinant *= edges[col][col];
+		for (size_t row = col + 1; row < n; ++row) {
+			double factor = edges[row][col] / edges[col][col];
+			for (size_t k = col; k < n; ++k) {
+				edges[row][k] -= factor * edges[col][k];
+			}
+		}
+	}
+	return std::fabs(determinant);
+}
+
+double NelderMeadOptimizer::normalizedDiameter(const std::vector<std::vector<double>> &simplex, const std::vector<double> &initialStep) const
+{
+	double diameter = 0.0;
+	for (size_t i = 1; i < simplex.size(); ++i) {
+		double distance = 0.0;
+		for (size_t j = 0; j < simplex[i].size(); ++j) {
+			double scale = initialStep[j] != 0.0 ? initialStep[j] : 1.0;
+			double delta = (simplex[i][j] - simplex[0][j]) / scale;
+			distance += delta * delta;
+		}
+		diameter = std::max(diameter, std::sqrt(distance));
+	}
+	return diameter;
+}
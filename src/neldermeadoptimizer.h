@@ -0,0 +1,49 @@
+#ifndef NELDERMEADOPTIMIZER_H
+#define NELDERMEADOPTIMIZER_H
+
+#include <vector>
+#include <functional>
+
+// Derivative-free downhill simplex (Nelder-Mead) optimizer that maximizes an objective
+// function within box constraints. The simplex is restarted around the best vertex if it
+// collapses into a lower-dimensional subspace before convergence.
+class NelderMeadOptimizer
+{
+public:
+	using Objective = std::function<double(const std::vector<double>&)>;
+	using StopCondition = std::function<bool()>;
+
+	struct Result {
+		std::vector<double> position;
+		double value;
+		int evaluations;
+		int restarts;
+	};
+
+	NelderMeadOptimizer();
+
+	void setMaxEvaluations(int maxEvaluations);
+	void setMaxRestarts(int maxRestarts);
+	void setTolerance(double tolerance);
+
+	// Checked before every evaluation. If it returns true the search ends and the best point found so far is returned.
+	void setStopCondition(const StopCondition &stopCondition);
+
+	Result maximize(const Objective &objective,
+					const std::vector<double> &start,
+					const std::vector<double> &initialStep,
+					const std::vector<double> &lowerBound,
+					const std::vector<double> &upperBound);
+
+private:
+	int maxEvaluations_;
+	int maxRestarts_;
+	double tolerance_;
+	StopCondition stopCondition_;
+
+	std::vector<double> clampToBounds(std::vector<double> point, const std::vector<double> &lowerBound, const std::vector<double> &upperBound) const;
+	double normalizedVolume(const std::vector<std::vector<double>> &simplex, const std::vector<double> &initialStep) const;
+	double normalizedDiameter(const std::vector<std::vector<double>> &simplex, const std::vector<double> &initialStep) const;
+};
+
+#endif // NELDERMEADOPTIMIZER_H
@@ -0,0 +1,29 @@
+#include "allocationtracking.h"
+
+namespace OCTSignalProcessing {
+
+static thread_local AllocationCounters* currentAllocationCounters = nullptr;
+
+AllocationScope::AllocationScope(AllocationCounters* counters)
+	: previous_(currentAllocationCounters),
+	  active_(counters != nullptr) {
+	if (active_) {
+		currentAllocationCounters = counters;
+	}
+}
+
+AllocationScope::~AllocationScope() {
+	if (active_) {
+		currentAllocationCounters = previous_;
+	}
+}
+
+void AllocationScope::recordAllocation(size_t bytes) {
+	AllocationCounters* counters = currentAllocationCounters;
+	if (counters != nullptr) {
+		counters->allocations += 1;
+		counters->bytes += bytes;
+	}
+}
+
+} // namespace OCTSignalProcessing
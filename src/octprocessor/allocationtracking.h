@@ -0,0 +1,88 @@
+#ifndef ALLOCATIONTRACKING_H
+#define ALLOCATIONTRACKING_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include "memoryarena.h"
+
+namespace OCTSignalProcessing {
+
+// Number and size of heap allocations, buffers taken from a MemoryArena are not counted
+struct AllocationCounters {
+	uint64_t allocations;
+	uint64_t bytes;
+
+	AllocationCounters() : allocations(0), bytes(0) {}
+
+	void reset() {
+		allocations = 0;
+		bytes = 0;
+	}
+
+	AllocationCounters& operator+=(const AllocationCounters& other) {
+		allocations += other.allocations;
+		bytes += other.bytes;
+		return *this;
+	}
+};
+
+// Makes counters the destination of all allocations of TrackingAllocator on the calling thread for the lifetime of the scope.
+// Scopes nest, the innermost one counts and the previous destination is restored on destruction. A scope with null counters
+// does nothing, so allocations keep going to the enclosing scope.
+class AllocationScope {
+public:
+	explicit AllocationScope(AllocationCounters* counters);
+	~AllocationScope();
+
+	static void recordAllocation(size_t bytes);
+
+	AllocationScope(const AllocationScope&) = delete;
+	AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+	AllocationCounters* previous_;
+	bool active_;
+};
+
+// std::allocator that takes its memory from the ArenaScope of the calling thread if there is one and otherwise reports every
+// heap allocation to the AllocationScope of the calling thread. Used for the sample buffers of the processing pipeline,
+// without active scopes it costs two thread-local reads per allocation.
+template <typename U>
+class TrackingAllocator {
+public:
+	typedef U value_type;
+
+	TrackingAllocator() noexcept {}
+	template <typename V>
+	TrackingAllocator(const TrackingAllocator<V>&) noexcept {}
+
+	U* allocate(size_t n) {
+		void* arenaMemory = ArenaScope::allocate(n * sizeof(U));
+		if (arenaMemory != nullptr) {
+			return static_cast<U*>(arenaMemory);
+		}
+		AllocationScope::recordAllocation(n * sizeof(U));
+		return std::allocator<U>().allocate(n);
+	}
+
+	void deallocate(U* p, size_t n) noexcept {
+		if (!ArenaScope::deallocate(p, n * sizeof(U))) {
+			std::allocator<U>().deallocate(p, n);
+		}
+	}
+};
+
+template <typename U, typename V>
+bool operator==(const TrackingAllocator<U>&, const TrackingAllocator<V>&) noexcept {
+	return true;
+}
+
+template <typename U, typename V>
+bool operator!=(const TrackingAllocator<U>&, const TrackingAllocator<V>&) noexcept {
+	return false;
+}
+
+} // namespace OCTSignalProcessing
+
+#endif // ALLOCATIONTRACKING_H
@@ -0,0 +1,129 @@
+#include "fringegenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace OCTSignalProcessing {
+
+FringeGenerator::FringeGenerator(const Parameters& parameters)
+	: parameters_(parameters) {
+	computeSampling();
+}
+
+const FringeGenerator::Parameters& FringeGenerator::getParameters() const {
+	return parameters_;
+}
+
+size_t FringeGenerator::totalSamples() const {
+	return parameters_.samplesPerSpectrum * parameters_.spectraPerFrame * parameters_.numberOfFrames;
+}
+
+size_t FringeGenerator::bytesPerSample(int bitDepth) {
+	// Same sample sizes as Processor::convertInputData
+	if (bitDepth <= 8) {
+		return 1;
+	}
+	if (bitDepth <= 16) {
+		return 2;
+	}
+	return 4;
+}
+
+double FringeGenerator::resamplingCurve(double linearIndex) const {
+	// Raw sample position of linear-in-k sample linearIndex, same polynomial as Processor::generateCoefficientResamplingCurve
+	const std::vector<double>& c = parameters_.resamplingCoefficients;
+	double n = static_cast<double>(parameters_.samplesPerSpectrum) - 1.0;
+	double x = linearIndex;
+	return c[0] + x * (c[1] / n + x * (c[2] / (n * n) + x * c[3] / (n * n * n)));
+}
+
+void FringeGenerator::computeSampling() {
+	size_t n = parameters_.samplesPerSpectrum;
+	linearK_.resize(n);
+	double lastIndex = static_cast<double>(n) - 1.0;
+
+	if (parameters_.resamplingCoefficients.size() < 4) {
+		for (size_t i = 0; i < n; ++i) {
+			linearK_[i] = static_cast<double>(i) / lastIndex;
+		}
+		return;
+	}
+
+	// The processor reads linear sample j from raw position r(j). The raw sample i therefore belongs to
+	// the wavenumber r^-1(i), which is found by bisection since r is monotonic over the spectrum.
+	bool increasing = resamplingCurve(lastIndex) >= resamplingCurve(0.0);
+	for (size_t i = 0; i < n; ++i) {
+		double target = static_cast<double>(i);
+		double low = -0.5 * lastIndex;
+		double high = 1.5 * lastIndex;
+		for (int iteration = 0; iteration < 60; ++iteration) {
+			double middle = 0.5 * (low + high);
+			bool belowTarget = resamplingCurve(middle) < target;
+			if (belowTarget == increasing) {
+				low = middle;
+			} else {
+				high = middle;
+			}
+		}
+		linearK_[i] = 0.5 * (low + high) / lastIndex;
+	}
+}
+
+std::vector<double> FringeGenerator::spectrum(size_t spectrumIndex) const {
+	size_t n = parameters_.samplesPerSpectrum;
+	std::vector<double> values(n);
+	std::mt19937 generator(parameters_.seed + static_cast<unsigned int>(spectrumIndex));
+	std::normal_distribution<double> noise(0.0, parameters_.noiseLevel);
+	const double pi = 3.14159265358979323846;
+
+	for (size_t i = 0; i < n; ++i) {
+		double k = linearK_[i];
+		double envelope = std::exp(-std::pow((k - parameters_.sourceCenter) / parameters_.sourceWidth, 2.0));
+
+		// Dispersive phase of the sample. The processor multiplies with exp(i * sum d_j k^j) and the backward IFFT maps
+		// the exp(-i * (fringe phase + dispersive phase)) part of the fringes to the first half of the A-scan, where it is removed.
+		double dispersivePhase = 0.0;
+		for (size_t j = parameters_.dispersionCoefficients.size(); j-- > 0;) {
+			dispersivePhase = dispersivePhase * k + parameters_.dispersionCoefficients[j];
+		}
+
+		// A reflector at depth z produces z fringe periods over the spectrum of length N after the IFFT
+		double fringes = 0.0;
+		double linearIndex = k * (static_cast<double>(n) - 1.0);
+		for (const Reflector& reflector : parameters_.reflectors) {
+			fringes += reflector.strength * std::cos(2.0 * pi * reflector.depth * linearIndex / static_cast<double>(n) + dispersivePhase);
+		}
+
+		values[i] = parameters_.dcLevel * envelope + parameters_.fringeAmplitude * envelope * fringes + noise(generator);
+	}
+	return values;
+}
+
+std::vector<uint8_t> FringeGenerator::generate() const {
+	size_t sampleSize = bytesPerSample(parameters_.bitDepth);
+	size_t n = parameters_.samplesPerSpectrum;
+	size_t numberOfSpectra = parameters_.spectraPerFrame * parameters_.numberOfFrames;
+	double maximumValue = parameters_.bitDepth >= 32 ? 4294967295.0 : std::pow(2.0, parameters_.bitDepth) - 1.0;
+
+	std::vector<uint8_t> raw(totalSamples() * sampleSize);
+	for (size_t spectrumIndex = 0; spectrumIndex < numberOfSpectra; ++spectrumIndex) {
+		std::vector<double> values = spectrum(spectrumIndex);
+		for (size_t i = 0; i < n; ++i) {
+			double scaled = std::round(std::min(std::max(values[i], 0.0), 1.0) * maximumValue);
+			uint8_t* destination = &raw[(spectrumIndex * n + i) * sampleSize];
+			if (sampleSize == 1) {
+				*destination = static_cast<uint8_t>(scaled);
+			} else if (sampleSize == 2) {
+				uint16_t value = static_cast<uint16_t>(scaled);
+				std::memcpy(destination, &value, sizeof(value));
+			} else {
+				uint32_t value = static_cast<uint32_t>(scaled);
+				std::memcpy(destination, &value, sizeof(value));
+			}
+		}
+	}
+	return raw;
+}
+
+} // namespace OCTSignalProcessing
@@ -0,0 +1,70 @@
+#ifndef FRINGEGENERATOR_H
+#define FRINGEGENERATOR_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace OCTSignalProcessing {
+
+// Synthesizes raw OCT spectra with known properties: a Gaussian source spectrum, reflectors at given depths,
+// additive noise, a nonlinear sampling in k that is undone by the given resampling coefficients and a dispersive
+// phase that is compensated exactly by the given dispersion coefficients. The output has the layout and sample
+// sizes Processor::processRawData expects, so it can be fed to the processor, the estimation engine and the benchmarks.
+class FringeGenerator {
+public:
+	struct Reflector {
+		double depth; // position in the processed A-scan in samples, between 0 and samplesPerSpectrum/2
+		double strength; // fringe amplitude relative to fringeAmplitude
+	};
+
+	struct Parameters {
+		size_t samplesPerSpectrum = 2048;
+		size_t spectraPerFrame = 64;
+		size_t numberOfFrames = 1;
+		int bitDepth = 12;
+
+		// Source spectrum as fraction of the full value range: DC level and fringe amplitude at the spectrum center.
+		// Center and 1/e half width of the Gaussian envelope are given in normalized wavenumber (0 to 1).
+		double dcLevel = 0.5;
+		double fringeAmplitude = 0.3;
+		double sourceCenter = 0.5;
+		double sourceWidth = 0.3;
+
+		std::vector<Reflector> reflectors = {{100.0, 1.0}, {250.0, 0.5}};
+
+		// Standard deviation of Gaussian noise as fraction of the full value range
+		double noiseLevel = 0.002;
+		unsigned int seed = 1;
+
+		// Resampling coefficients c0 to c3 as in the OCTproZ settings. Empty means linear sampling in k.
+		std::vector<double> resamplingCoefficients;
+
+		// Dispersion coefficients d0, d1, d2, ... as in the OCTproZ settings that compensate the dispersion of the generated data
+		std::vector<double> dispersionCoefficients = {0.0, 0.0, 0.0, 0.0};
+	};
+
+	explicit FringeGenerator(const Parameters& parameters);
+
+	const Parameters& getParameters() const;
+	size_t totalSamples() const;
+
+	// Raw samples of all spectra of all frames, 1, 2 or 4 bytes per sample depending on the bit depth
+	std::vector<uint8_t> generate() const;
+
+	// Raw sample values of one spectrum before quantization, in units of the full value range
+	std::vector<double> spectrum(size_t spectrumIndex) const;
+
+	static size_t bytesPerSample(int bitDepth);
+
+private:
+	Parameters parameters_;
+	std::vector<double> linearK_; // normalized wavenumber of every raw sample
+
+	void computeSampling();
+	double resamplingCurve(double linearIndex) const;
+};
+
+} // namespace OCTSignalProcessing
+
+#endif // FRINGEGENERATOR_H
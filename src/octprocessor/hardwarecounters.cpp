@@ -0,0 +1,141 @@
+#include "hardwarecounters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace OCTSignalProcessing {
+
+#ifdef __linux__
+static int openCounter(uint64_t config, int groupFileDescriptor) {
+	perf_event_attr attributes;
+	std::memset(&attributes, 0, sizeof(attributes));
+	attributes.type = PERF_TYPE_HARDWARE;
+	attributes.size = sizeof(attributes);
+	attributes.config = config;
+	attributes.disabled = groupFileDescriptor == -1 ? 1 : 0; // the group is enabled once all counters are added
+	attributes.exclude_kernel = 1;
+	attributes.exclude_hv = 1;
+	attributes.read_format = PERF_FORMAT_GROUP;
+	// pid 0 and cpu -1: calling thread on any CPU
+	return static_cast<int>(syscall(__NR_perf_event_open, &attributes, 0, -1, groupFileDescriptor, 0));
+}
+#endif
+
+HardwareCounters& HardwareCounters::forCurrentThread() {
+	thread_local HardwareCounters counters;
+	return counters;
+}
+
+HardwareCounters::HardwareCounters()
+	: groupSize_(0),
+	  available_(false) {
+	for (int i = 0; i < NUMBER_OF_HARDWARE_COUNTERS; ++i) {
+		fileDescriptors_[i] = -1;
+		groupIndices_[i] = -1;
+	}
+
+#ifdef __linux__
+	const uint64_t configs[NUMBER_OF_HARDWARE_COUNTERS] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_BRANCH_MISSES
+	};
+	int leader = -1;
+	for (int i = 0; i < NUMBER_OF_HARDWARE_COUNTERS; ++i) {
+		int fileDescriptor = openCounter(configs[i], leader);
+		if (fileDescriptor == -1) {
+			if (errorString_.empty()) {
+				errorString_ = std::string("perf_event_open failed for ") + counterName(static_cast<HardwareCounter>(i)) + ": " + std::strerror(errno);
+				if (errno == EACCES || errno == EPERM) {
+					errorString_ += " (see /proc/sys/kernel/perf_event_paranoid)";
+				}
+			}
+			continue;
+		}
+		if (leader == -1) {
+			leader = fileDescriptor;
+		}
+		fileDescriptors_[i] = fileDescriptor;
+		groupIndices_[i] = groupSize_++;
+	}
+
+	available_ = fileDescriptors_[COUNTER_CYCLES] != -1 && fileDescriptors_[COUNTER_INSTRUCTIONS] != -1;
+	if (available_) {
+		ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+		ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+	} else {
+		for (int i = 0; i < NUMBER_OF_HARDWARE_COUNTERS; ++i) {
+			if (fileDescriptors_[i] != -1) {
+				close(fileDescriptors_[i]);
+				fileDescriptors_[i] = -1;
+			}
+			groupIndices_[i] = -1;
+		}
+		groupSize_ = 0;
+	}
+#else
+	errorString_ = "hardware counters are only supported on Linux";
+#endif
+}
+
+HardwareCounters::~HardwareCounters() {
+#ifdef __linux__
+	for (int i = 0; i < NUMBER_OF_HARDWARE_COUNTERS; ++i) {
+		if (fileDescriptors_[i] != -1) {
+			close(fileDescriptors_[i]);
+		}
+	}
+#endif
+}
+
+bool HardwareCounters::isAvailable() const {
+	return available_;
+}
+
+bool HardwareCounters::isCounterAvailable(HardwareCounter counter) const {
+	return available_ && groupIndices_[counter] != -1;
+}
+
+const std::string& HardwareCounters::errorString() const {
+	return errorString_;
+}
+
+bool HardwareCounters::read(HardwareCounterValues& values) {
+	if (!available_) {
+		return false;
+	}
+#ifdef __linux__
+	// PERF_FORMAT_GROUP: number of counters followed by their values in the order they were added to the group
+	uint64_t buffer[1 + NUMBER_OF_HARDWARE_COUNTERS];
+	ssize_t bytesRead = ::read(fileDescriptors_[COUNTER_CYCLES], buffer, sizeof(buffer));
+	if (bytesRead < static_cast<ssize_t>(sizeof(uint64_t) * (1 + groupSize_)) || buffer[0] != static_cast<uint64_t>(groupSize_)) {
+		return false;
+	}
+	for (int i = 0; i < NUMBER_OF_HARDWARE_COUNTERS; ++i) {
+		values.values[i] = groupIndices_[i] != -1 ? buffer[1 + groupIndices_[i]] : 0;
+	}
+	return true;
+#else
+	(void)values;
+	return false;
+#endif
+}
+
+const char* HardwareCounters::counterName(HardwareCounter counter) {
+	switch (counter) {
+	case COUNTER_CYCLES: return "cycles";
+	case COUNTER_INSTRUCTIONS: return "instructions";
+	case COUNTER_CACHE_MISSES: return "cache_misses";
+	case COUNTER_BRANCH_MISSES: return "branch_misses";
+	default: return "unknown";
+	}
+}
+
+} // namespace OCTSignalProcessing
@@ -0,0 +1,55 @@
+#ifndef HARDWARECOUNTERS_H
+#define HARDWARECOUNTERS_H
+
+#include <cstdint>
+#include <string>
+
+namespace OCTSignalProcessing {
+
+enum HardwareCounter {
+	COUNTER_CYCLES,
+	COUNTER_INSTRUCTIONS,
+	COUNTER_CACHE_MISSES,
+	COUNTER_BRANCH_MISSES,
+	NUMBER_OF_HARDWARE_COUNTERS
+};
+
+struct HardwareCounterValues {
+	uint64_t values[NUMBER_OF_HARDWARE_COUNTERS] = {};
+};
+
+// CPU performance counters (cycles, instructions, last level cache misses, branch misses) of the calling thread,
+// read with perf_event_open on Linux. Counters that the kernel or CPU do not provide (e.g. in virtual machines or if
+// /proc/sys/kernel/perf_event_paranoid forbids it) are reported as unavailable; without cycles and instructions the
+// whole set is unavailable. On other platforms the counters are never available.
+class HardwareCounters {
+public:
+	// Counters are bound to the thread that opens them, so every thread gets its own instance on first use
+	static HardwareCounters& forCurrentThread();
+
+	~HardwareCounters();
+
+	bool isAvailable() const;
+	bool isCounterAvailable(HardwareCounter counter) const;
+	const std::string& errorString() const;
+
+	// Current counts since the counters were opened. Unavailable counters read 0.
+	bool read(HardwareCounterValues& values);
+
+	static const char* counterName(HardwareCounter counter);
+
+private:
+	HardwareCounters();
+	HardwareCounters(const HardwareCounters&) = delete;
+	HardwareCounters& operator=(const HardwareCounters&) = delete;
+
+	int fileDescriptors_[NUMBER_OF_HARDWARE_COUNTERS];
+	int groupIndices_[NUMBER_OF_HARDWARE_COUNTERS]; // position of the counter in a group read, -1 if unavailable
+	int groupSize_;
+	bool available_;
+	std::string errorString_;
+};
+
+} // namespace OCTSignalProcessing
+
+#endif // HARDWARECOUNTERS_H
@@ -0,0 +1,210 @@
+#include "memoryarena.h"
+#include <cstdlib>
+#include <cstdint>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace OCTSignalProcessing {
+
+static thread_local MemoryArena* currentArena = nullptr;
+
+static size_t roundUp(size_t bytes, size_t multiple) {
+	return (bytes + multiple - 1) / multiple * multiple;
+}
+
+PageBlock allocatePages(size_t bytes) {
+	PageBlock block;
+	if (bytes == 0) {
+		return block;
+	}
+#ifdef __linux__
+	if (bytes >= ARENA_BLOCK_BYTES) {
+		size_t mappedBytes = roundUp(bytes, ARENA_BLOCK_BYTES);
+		void* data = MAP_FAILED;
+#ifdef MAP_HUGETLB
+		// Fails right away if no huge pages are reserved
+		data = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (data != MAP_FAILED) {
+			block.backing = HUGE_PAGES;
+		}
+#endif
+		if (data == MAP_FAILED) {
+			data = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			block.backing = NORMAL_PAGES;
+#ifdef MADV_HUGEPAGE
+			if (data != MAP_FAILED && madvise(data, mappedBytes, MADV_HUGEPAGE) == 0) {
+				block.backing = TRANSPARENT_HUGE_PAGES;
+			}
+#endif
+		}
+		if (data != MAP_FAILED) {
+			block.data = static_cast<char*>(data);
+			block.bytes = mappedBytes;
+			return block;
+		}
+	}
+#endif
+	block.data = static_cast<char*>(std::malloc(bytes));
+	block.bytes = block.data != nullptr ? bytes : 0;
+	block.backing = HEAP_PAGES;
+	return block;
+}
+
+void releasePages(PageBlock& block) {
+	if (block.data != nullptr) {
+#ifdef __linux__
+		if (block.backing != HEAP_PAGES) {
+			munmap(block.data, block.bytes);
+		} else {
+			std::free(block.data);
+		}
+#else
+		std::free(block.data);
+#endif
+	}
+	block = PageBlock();
+}
+
+MemoryArena::MemoryArena(size_t blockBytes)
+	: blockBytes_(blockBytes > 0 ? blockBytes : ARENA_BLOCK_BYTES),
+	  usedInLastBlock_(0),
+	  usedBytes_(0),
+	  peakUsedBytes_(0),
+	  mergedBlockBytes_(0) {
+}
+
+MemoryArena::~MemoryArena() {
+	release();
+}
+
+void* MemoryArena::allocate(size_t bytes) {
+	bytes = roundUp(bytes > 0 ? bytes : 1, ARENA_ALIGNMENT);
+	for (FreeList& freeList : freeLists_) {
+		if (freeList.bytes == bytes && freeList.head != nullptr) {
+			void* buffer = freeList.head;
+			freeList.head = *static_cast<void**>(buffer);
+			usedBytes_ += bytes;
+			peakUsedBytes_ = usedBytes_ > peakUsedBytes_ ? usedBytes_ : peakUsedBytes_;
+			return buffer;
+		}
+	}
+	if (!blocks_.empty()) {
+		// malloc'ed blocks are not page aligned, so the offset is aligned relative to the address
+		const PageBlock& block = blocks_.back();
+		uintptr_t address = reinterpret_cast<uintptr_t>(block.data) + usedInLastBlock_;
+		size_t padding = roundUp(address, ARENA_ALIGNMENT) - address;
+		if (usedInLastBlock_ + padding + bytes <= block.bytes) {
+			usedInLastBlock_ += padding + bytes;
+			usedBytes_ += bytes;
+			peakUsedBytes_ = usedBytes_ > peakUsedBytes_ ? usedBytes_ : peakUsedBytes_;
+			return block.data + usedInLastBlock_ - bytes;
+		}
+	}
+
+	size_t newBlockBytes = bytes + ARENA_ALIGNMENT;
+	newBlockBytes = newBlockBytes > blockBytes_ ? newBlockBytes : blockBytes_;
+	newBlockBytes = newBlockBytes > mergedBlockBytes_ ? newBlockBytes : mergedBlockBytes_;
+	PageBlock block = allocatePages(newBlockBytes);
+	if (block.data == nullptr) {
+		return nullptr;
+	}
+	mergedBlockBytes_ = 0;
+	blocks_.push_back(block);
+	usedInLastBlock_ = 0;
+	return allocate(bytes);
+}
+
+void MemoryArena::deallocate(void* pointer, size_t bytes) {
+	bytes = roundUp(bytes > 0 ? bytes : 1, ARENA_ALIGNMENT);
+	usedBytes_ -= bytes;
+	for (FreeList& freeList : freeLists_) {
+		if (freeList.bytes == bytes) {
+			*static_cast<void**>(pointer) = freeList.head;
+			freeList.head = pointer;
+			return;
+		}
+	}
+	*static_cast<void**>(pointer) = nullptr;
+	FreeList freeList = {bytes, pointer};
+	freeLists_.push_back(freeList);
+}
+
+bool MemoryArena::owns(const void* pointer) const {
+	const char* address = static_cast<const char*>(pointer);
+	for (const PageBlock& block : blocks_) {
+		if (address >= block.data && address < block.data + block.bytes) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void MemoryArena::reset() {
+	if (blocks_.size() > 1) {
+		size_t totalBytes = 0;
+		for (PageBlock& block : blocks_) {
+			totalBytes += block.bytes;
+			releasePages(block);
+		}
+		blocks_.clear();
+		mergedBlockBytes_ = totalBytes;
+	}
+	freeLists_.clear();
+	usedInLastBlock_ = 0;
+	usedBytes_ = 0;
+}
+
+void MemoryArena::release() {
+	for (PageBlock& block : blocks_) {
+		releasePages(block);
+	}
+	blocks_.clear();
+	freeLists_.clear();
+	usedInLastBlock_ = 0;
+	usedBytes_ = 0;
+	peakUsedBytes_ = 0;
+	mergedBlockBytes_ = 0;
+}
+
+ArenaStatistics MemoryArena::statistics() const {
+	ArenaStatistics statistics;
+	for (const PageBlock& block : blocks_) {
+		statistics.reservedBytes += block.bytes;
+		if (block.backing == HUGE_PAGES || block.backing == TRANSPARENT_HUGE_PAGES) {
+			statistics.hugePageBytes += block.bytes;
+		}
+	}
+	statistics.peakUsedBytes = peakUsedBytes_;
+	return statistics;
+}
+
+ArenaScope::ArenaScope(MemoryArena* arena)
+	: arena_(arena),
+	  previous_(currentArena) {
+	if (arena_ != nullptr) {
+		currentArena = arena_;
+	}
+}
+
+ArenaScope::~ArenaScope() {
+	if (arena_ != nullptr) {
+		currentArena = previous_;
+		arena_->reset();
+	}
+}
+
+void* ArenaScope::allocate(size_t bytes) {
+	return currentArena != nullptr ? currentArena->allocate(bytes) : nullptr;
+}
+
+bool ArenaScope::deallocate(void* pointer, size_t bytes) {
+	if (currentArena == nullptr || !currentArena->owns(pointer)) {
+		return false;
+	}
+	currentArena->deallocate(pointer, bytes);
+	return true;
+}
+
+} // namespace OCTSignalProcessing
@@ -0,0 +1,109 @@
+#ifndef MEMORYARENA_H
+#define MEMORYARENA_H
+
+#include <cstddef>
+#include <vector>
+
+#define ARENA_ALIGNMENT 64 // bytes, cache line and widest SIMD register
+#define ARENA_BLOCK_BYTES (2 * 1024 * 1024) // one huge page on x86-64
+
+namespace OCTSignalProcessing {
+
+enum PageBacking {
+	HEAP_PAGES, // malloc, platforms without mmap
+	NORMAL_PAGES,
+	TRANSPARENT_HUGE_PAGES, // normal mapping with the huge page hint (MADV_HUGEPAGE)
+	HUGE_PAGES // explicit huge pages (MAP_HUGETLB), needs pages reserved in /proc/sys/vm/nr_hugepages
+};
+
+// Memory for large, long-lived buffers. On Linux blocks of at least ARENA_BLOCK_BYTES are mapped with explicit huge
+// pages if the system has some reserved, otherwise with the transparent huge page hint, which reduces TLB misses when
+// multi-megabyte buffers are streamed through. Smaller blocks and other platforms use malloc.
+struct PageBlock {
+	char* data;
+	size_t bytes;
+	PageBacking backing;
+
+	PageBlock() : data(nullptr), bytes(0), backing(HEAP_PAGES) {}
+};
+
+PageBlock allocatePages(size_t bytes);
+void releasePages(PageBlock& block);
+
+// Sizes of an arena or of several arenas together
+struct ArenaStatistics {
+	size_t reservedBytes;
+	size_t hugePageBytes; // part of reservedBytes on explicit or transparent huge pages
+	size_t peakUsedBytes; // largest amount handed out between two resets
+
+	ArenaStatistics() : reservedBytes(0), hugePageBytes(0), peakUsedBytes(0) {}
+
+	ArenaStatistics& operator+=(const ArenaStatistics& other) {
+		reservedBytes += other.reservedBytes;
+		hugePageBytes += other.hugePageBytes;
+		peakUsedBytes += other.peakUsedBytes;
+		return *this;
+	}
+};
+
+// Bump allocator for the temporary buffers of one processing call. Allocations are aligned to ARENA_ALIGNMENT. Freed
+// buffers are kept in a free list per size and handed out again for the next buffer of the same size, so the per-spectrum
+// buffers of a loop reuse the same, cache-warm memory. reset() hands everything back at once and keeps the memory for the
+// next call, release() gives it back to the system. If a call needed more than one block, the blocks are merged into one
+// block of the total size at the next reset, so after the first call every further call is served from a single block
+// without touching the system allocator. Not thread-safe, every thread uses its own arena.
+class MemoryArena {
+public:
+	explicit MemoryArena(size_t blockBytes = ARENA_BLOCK_BYTES);
+	~MemoryArena();
+
+	void* allocate(size_t bytes);
+	void deallocate(void* pointer, size_t bytes);
+	bool owns(const void* pointer) const;
+	void reset();
+	void release();
+
+	ArenaStatistics statistics() const;
+
+	MemoryArena(const MemoryArena&) = delete;
+	MemoryArena& operator=(const MemoryArena&) = delete;
+
+private:
+	struct FreeList {
+		size_t bytes;
+		void* head; // the next free buffer is stored at the start of every free buffer
+	};
+
+	std::vector<PageBlock> blocks_;
+	std::vector<FreeList> freeLists_;
+	size_t blockBytes_;
+	size_t usedInLastBlock_;
+	size_t usedBytes_;
+	size_t peakUsedBytes_;
+	size_t mergedBlockBytes_; // size of the single block that replaces the blocks of the last round, 0 if there is none
+};
+
+// Makes arena the destination of all allocations of TrackingAllocator on the calling thread for the lifetime of the scope
+// and resets the arena when the scope ends. Every buffer allocated inside the scope has to be destroyed before the scope
+// ends, so the buffers have to be declared after it. A scope with a null arena does nothing.
+class ArenaScope {
+public:
+	explicit ArenaScope(MemoryArena* arena);
+	~ArenaScope();
+
+	// Memory from the arena of the calling thread, nullptr if there is none
+	static void* allocate(size_t bytes);
+	// Returns the buffer to the arena of the calling thread if it belongs to it, false if it was not allocated there
+	static bool deallocate(void* pointer, size_t bytes);
+
+	ArenaScope(const ArenaScope&) = delete;
+	ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+	MemoryArena* arena_;
+	MemoryArena* previous_;
+};
+
+} // namespace OCTSignalProcessing
+
+#endif // MEMORYARENA_H
@@ -5,6 +5,13 @@
 #include <complex>
 #include <cstdint>
 #include <fftw3.h>
+#include "stagetimings.h"
+#include "allocationtracking.h"
+#include "spectrumview.h"
+
+// Time and verify the individual processing steps, see tools/processorbenchmark and tools/processorverification
+class ProcessorStageBenchmark;
+class ProcessorVerification;
 
 namespace OCTSignalProcessing {
 
@@ -22,6 +29,10 @@ public:
 		bool logScale = true;
 	};
 
+	// Sample buffers of the pipeline. Their allocations are counted per stage while stage timings are set.
+	typedef std::vector<std::complex<T>, TrackingAllocator<std::complex<T>>> ComplexBuffer;
+	typedef std::vector<T, TrackingAllocator<T>> RealBuffer;
+
 	// Constructor and destructor
 	Processor(size_t samplesPerSpectrum, size_t windowSize = 0, int kernelRadius = 8, size_t rollingAverageWindowSize = 10);
 	~Processor();
@@ -37,6 +48,9 @@ public:
 
 	void setCustomResamplingCurve(const std::string& filePath);
 
+	// Time spent in every processing stage is added to timings, nullptr (default) disables the timers. The timings are not owned.
+	void setStageTimings(StageTimings* timings);
+
 	// Set log scaling parameters
 	void setLogScaleParameters(T coeff = static_cast<T>(1.0),
 	                           T minVal = static_cast<T>(0.0),
@@ -44,14 +58,51 @@ public:
 	                           T addend = static_cast<T>(0.0),
 	                           bool autoComputeMinMax = true);
 
-	// Process raw data
+	// Process raw data. The pointer overloads read totalSamples consecutive samples, the view overloads read the spectra
+	// of the view in place wherever they are located in the frame buffer.
 	void processRawData(const void* inputData,
 	                    size_t totalSamples,
 	                    int inputBitDepth,
 	                    size_t spectraPerFrame,
-	                    std::vector<std::vector<std::vector<T>>>& processedData);
+	                    std::vector<std::vector<RealBuffer>>& processedData);
+	void processRawData(const SpectrumView& input,
+	                    int inputBitDepth,
+	                    size_t spectraPerFrame,
+	                    std::vector<std::vector<RealBuffer>>& processedData);
+
+	// Runs the steps that do not depend on the dispersion coefficients (conversion, DC removal, k-linearization) once.
+	// The prepared spectra can then be processed repeatedly with different coefficients by processPreparedSpectra.
+	void prepareSpectra(const void* inputData,
+	                    size_t totalSamples,
+	                    int inputBitDepth,
+	                    std::vector<ComplexBuffer>& spectra);
+	void prepareSpectra(const SpectrumView& input,
+	                    int inputBitDepth,
+	                    std::vector<ComplexBuffer>& spectra);
+
+	// Remaining steps (dispersion compensation, windowing, IFFT, scaling, truncation) for every prepared spectrum
+	void processPreparedSpectra(const std::vector<ComplexBuffer>& spectra,
+	                            std::vector<RealBuffer>& processedSpectra);
+
+	// Computes the sum of squared linear intensities over the first half of all A-scans (skipping the
+	// first ignoredSamples of each A-scan) and its analytic partial derivatives with respect to the
+	// dispersion coefficients of the given polynomial orders. Requires one additional IFFT per coefficient.
+	T computeIntensityMetricGradient(const void* inputData,
+	                                 size_t totalSamples,
+	                                 int inputBitDepth,
+	                                 size_t ignoredSamples,
+	                                 const std::vector<int>& coefficientOrders,
+	                                 std::vector<T>& gradient);
+	T computeIntensityMetricGradient(const SpectrumView& input,
+	                                 int inputBitDepth,
+	                                 size_t ignoredSamples,
+	                                 const std::vector<int>& coefficientOrders,
+	                                 std::vector<T>& gradient);
 
 private:
+	friend class ::ProcessorStageBenchmark;
+	friend class ::ProcessorVerification;
+
 	// Member variables
 	size_t samplesPerSpectrum_;
 	size_t windowSize_;
@@ -67,6 +118,8 @@ private:
 	// Processing options
 	ProcessingOptions options_;
 
+	StageTimings* stageTimings_;
+
 	// Dispersion compensation parameters
 	std::vector<T> dispersionCoefficients_;
 	std::vector<std::complex<T>> phaseComplex_;
@@ -93,29 +146,40 @@ private:
 	void computeDispersivePhase();
 	void generateResampleCurve();
 	void generateCoefficientResamplingCurve();
+	void updateResampleCurveIfNeeded();
 
 	// Data conversion
 	void convertInputData(const void* inputData,
 	                      size_t totalSamples,
 	                      int inputBitDepth,
-	                      std::vector<std::complex<T>>& outputData);
+	                      ComplexBuffer& outputData);
+	void convertInputData(const SpectrumView& input,
+	                      int inputBitDepth,
+	                      ComplexBuffer& outputData);
+	template <typename S>
+	static void convertSamples(const S* input, size_t numberOfSamples, std::complex<T>* output);
+	// Consecutive spectra of totalSamples samples, trailing samples that do not fill a whole spectrum are left out
+	SpectrumView contiguousView(const void* inputData, size_t totalSamples, int inputBitDepth) const;
 
 	// Processing steps
-	void rollingAverageDCRemoval(std::vector<std::complex<T>>& spectrum);
+	void preprocessSpectrum(ComplexBuffer& spectrum);
+	void postprocessSpectrum(ComplexBuffer& spectrum, RealBuffer& output);
+
+	void rollingAverageDCRemoval(ComplexBuffer& spectrum);
 
-	void klinearizationCubic(const std::vector<std::complex<T>>& inputSpectrum,
+	void klinearizationCubic(const ComplexBuffer& inputSpectrum,
 	                         const std::vector<T>& resampleCurve,
-	                         std::vector<std::complex<T>>& outputSpectrum);
+	                         ComplexBuffer& outputSpectrum);
 
-	void dispersionCompensation(std::vector<std::complex<T>>& data);
+	void dispersionCompensation(ComplexBuffer& data);
 
-	void applyWindow(std::vector<std::complex<T>>& data);
+	void applyWindow(ComplexBuffer& data);
 
-	void computeIFFT(const std::vector<std::complex<T>>& input,
-	                 std::vector<std::complex<T>>& output);
+	void computeIFFT(const ComplexBuffer& input,
+	                 ComplexBuffer& output);
 
-	void logScale(const std::vector<std::complex<T>>& input,
-	              std::vector<T>& output);
+	void logScale(const ComplexBuffer& input,
+	              RealBuffer& output);
 
 	// Helper functions
 	T cubicHermiteInterpolation(const T y0, const T y1, const T y2, const T y3, const T positionBetweenY1andY2);
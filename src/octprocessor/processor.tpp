@@ -10,9 +10,16 @@
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <mutex>
 
 namespace OCTSignalProcessing {
 
+// FFTW planner routines are not thread-safe, only fftw_execute is. All Processor instances share this mutex so that they can be created and destroyed from different threads.
+inline std::mutex& fftwPlannerMutex() {
+	static std::mutex mutex;
+	return mutex;
+}
+
 template <typename T>
 Processor<T>::Processor(size_t samplesPerSpectrum, size_t windowSize, int kernelRadius, size_t rollingAverageWindowSize)
 	: samplesPerSpectrum_(samplesPerSpectrum),
@@ -31,7 +38,11 @@ Processor<T>::Processor(size_t samplesPerSpectrum, size_t windowSize, int kernel
 	  logScaleMax_(static_cast<T>(0.0)),
 	  logScaleAddend_(static_cast<T>(0.0)),
 	  autoComputeLogScaleMinMax_(true),
-	  resamplingCurveOptionsChanged_(true){
+	  hasCustomResamplingCurve_(false),
+	  resamplingCurveOptionsChanged_(true),
+	  stageTimings_(nullptr){
+	std::lock_guard<std::mutex> plannerLock(fftwPlannerMutex());
+
 	// Allocate FFTW arrays
 	fftIn_ = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * samplesPerSpectrum_);
 	fftOut_ = (fftw_complex*)fftw_malloc(sizeof(fftw_complex) * samplesPerSpectrum_);
@@ -43,6 +54,7 @@ Processor<T>::Processor(size_t samplesPerSpectrum, size_t windowSize, int kernel
 
 template <typename T>
 Processor<T>::~Processor() {
+	std::lock_guard<std::mutex> plannerLock(fftwPlannerMutex());
 	fftw_destroy_plan(fftPlan_);
 	fftw_free(fftIn_);
 	fftw_free(fftOut_);
@@ -113,6 +125,11 @@ void Processor<T>::setCustomResamplingCurve(const std::string& filePath) {
 	resamplingCurveOptionsChanged_ = true;
 }
 
+template <typename T>
+void Processor<T>::setStageTimings(StageTimings* timings) {
+	stageTimings_ = timings;
+}
+
 template <typename T>
 void Processor<T>::setLogScaleParameters(T coeff, T minVal, T maxVal, T addend, bool autoComputeMinMax) {
 	logScaleCoeff_ = coeff;
@@ -137,35 +154,17 @@ void Processor<T>::computeDispersivePhase() {
 	size_t spectrumSize = samplesPerSpectrum_;
 	phaseComplex_.resize(spectrumSize);
 
-	//normalization of dispersion coeffs to match the polynomial calculation of OCTproZ
+	//normalization of dispersion coeffs to match the polynomial calculation of OCTproZ: phase = sum_j d_j * (k/(N-1))^j
+	//the polynomial may have any order, coefficients above d3 are only used by the estimator
 	float denom = static_cast<float>((spectrumSize) - 1);
-	std::vector<T> normCoeffs(4);
-	normCoeffs[0] = dispersionCoefficients_[0];
-	normCoeffs[1] = dispersionCoefficients_[1] / denom;
-	normCoeffs[2] = dispersionCoefficients_[2] / (denom * denom);
-	normCoeffs[3] = dispersionCoefficients_[3] / (denom * denom * denom);
-
 
-	std::vector<T> phaseValues_debugging(spectrumSize);
-
-	// Compute phase values using the polynomial coefficients
+	// Compute phase values using the polynomial coefficients (Horner scheme on the normalized wavenumber)
 	for (size_t i = 0; i < spectrumSize; ++i) {
-		//T k = static_cast<T>(i);
-		//T phaseValue = static_cast<T>(0);
-		//T kPower = static_cast<T>(1);
-
-		T phaseValue = normCoeffs[0]
-				+ i * (normCoeffs[1]
-				+ i * (normCoeffs[2]
-				+ i * normCoeffs[3]));
-
-		// Compute the polynomial value
-//		for (const T& coeff : normCoeffs) {
-//			phaseValue += coeff * kPower;
-//			kPower *= k;
-//		}
-
-phaseValues_debugging[i] = phaseValue;
+		T k = static_cast<T>(i) / denom;
+		T phaseValue = static_cast<T>(0);
+		for (size_t j = dispersionCoefficients_.size(); j-- > 0;) {
+			phaseValue = phaseValue * k + dispersionCoefficients_[j];
+		}
 
 		//T angle =  phaseValue;
 		//phaseComplex_[i] = std::polar(static_cast<T>(1.0), angle * dispersionDirection_);
@@ -212,45 +211,71 @@ template <typename T>
 void Processor<T>::convertInputData(const void* inputData,
                                     size_t totalSamples,
                                     int inputBitDepth,
-                                    std::vector<std::complex<T>>& outputData) {
-	outputData.resize(totalSamples);
+                                    ComplexBuffer& outputData) {
+	convertInputData(contiguousView(inputData, totalSamples, inputBitDepth), inputBitDepth, outputData);
+}
 
-	T scaleFactor = static_cast<T>(1.0);
+template <typename T>
+void Processor<T>::convertInputData(const SpectrumView& input,
+                                    int inputBitDepth,
+                                    ComplexBuffer& outputData) {
+	size_t totalSamples = input.numberOfLines * samplesPerSpectrum_;
+	ScopedStageTimer timer(stageTimings_, STAGE_CONVERSION, totalSamples);
+	outputData.resize(totalSamples);
 
-	if (inputBitDepth <= 8) {
-		const uint8_t* in = static_cast<const uint8_t*>(inputData);
-		scaleFactor = static_cast<T>(1.0);// / static_cast<T>(255);
-		for (size_t i = 0; i < totalSamples; ++i) {
-			outputData[i] = std::complex<T>(static_cast<T>(in[i]) * scaleFactor, static_cast<T>(0));
-		}
-	} else if (inputBitDepth <= 16) {
-		const uint16_t* in = static_cast<const uint16_t*>(inputData);
-		scaleFactor = static_cast<T>(1.0);// / static_cast<T>(65535);
-		for (size_t i = 0; i < totalSamples; ++i) {
-			outputData[i] = std::complex<T>(static_cast<T>(in[i]) * scaleFactor, static_cast<T>(0));
-		}
-	} else {
-		const uint32_t* in = static_cast<const uint32_t*>(inputData);
-		scaleFactor = static_cast<T>(1.0);// / static_cast<T>(4294967295);
-		for (size_t i = 0; i < totalSamples; ++i) {
-			outputData[i] = std::complex<T>(static_cast<T>(in[i]) * scaleFactor, static_cast<T>(0));
+	// Every spectrum is read where it is located in the frame buffer, the output is contiguous
+	std::complex<T>* output = outputData.data();
+	for (size_t line = 0; line < input.numberOfLines; ++line) {
+		const char* in = input.lineData(line);
+		if (inputBitDepth <= 8) {
+			convertSamples(reinterpret_cast<const uint8_t*>(in), samplesPerSpectrum_, output);
+		} else if (inputBitDepth <= 16) {
+			convertSamples(reinterpret_cast<const uint16_t*>(in), samplesPerSpectrum_, output);
+		} else {
+			convertSamples(reinterpret_cast<const uint32_t*>(in), samplesPerSpectrum_, output);
 		}
+		output += samplesPerSpectrum_;
+	}
+}
+
+template <typename T>
+template <typename S>
+void Processor<T>::convertSamples(const S* input, size_t numberOfSamples, std::complex<T>* output) {
+	for (size_t i = 0; i < numberOfSamples; ++i) {
+		output[i] = std::complex<T>(static_cast<T>(input[i]), static_cast<T>(0));
 	}
 }
 
+template <typename T>
+SpectrumView Processor<T>::contiguousView(const void* inputData, size_t totalSamples, int inputBitDepth) const {
+	size_t bytesPerSample = inputBitDepth <= 8 ? 1 : (inputBitDepth <= 16 ? 2 : 4);
+	size_t numberOfLines = samplesPerSpectrum_ > 0 ? totalSamples / samplesPerSpectrum_ : 0;
+	return SpectrumView(inputData, samplesPerSpectrum_ * bytesPerSample, numberOfLines);
+}
+
 template <typename T>
 void Processor<T>::processRawData(const void* inputData,
                                   size_t totalSamples,
                                   int inputBitDepth,
                                   size_t spectraPerFrame,
-                                  std::vector<std::vector<std::vector<T>>>& processedData) {
+                                  std::vector<std::vector<RealBuffer>>& processedData) {
+	processRawData(contiguousView(inputData, totalSamples, inputBitDepth), inputBitDepth, spectraPerFrame, processedData);
+}
+
+template <typename T>
+void Processor<T>::processRawData(const SpectrumView& input,
+                                  int inputBitDepth,
+                                  size_t spectraPerFrame,
+                                  std::vector<std::vector<RealBuffer>>& processedData) {
+	// Allocations outside of the stages: per-spectrum copies and output buffers
+	AllocationScope allocationScope(stageTimings_ != nullptr ? &stageTimings_->otherAllocations : nullptr);
 	// Step 1: Convert input data to std::complex<T>
-	std::vector<std::complex<T>> complexData;
-	convertInputData(inputData, totalSamples, inputBitDepth, complexData);
+	ComplexBuffer complexData;
+	convertInputData(input, inputBitDepth, complexData);
 
 	// Organize data into frames and spectra
 	size_t samplesPerSpectrum = samplesPerSpectrum_;
-	size_t numFrames = totalSamples / (samplesPerSpectrum * spectraPerFrame);
+	size_t numFrames = input.numberOfLines / spectraPerFrame;
 
 	processedData.resize(numFrames);
 	size_t index = 0;
@@ -260,73 +285,209 @@ void Processor<T>::processRawData(const void* inputData,
 
 		for (size_t spectrumIndex = 0; spectrumIndex < spectraPerFrame; ++spectrumIndex) {
 			// Extract spectrum data
-			std::vector<std::complex<T>> spectrum(complexData.begin() + index, complexData.begin() + index + samplesPerSpectrum);
+			ComplexBuffer spectrum(complexData.begin() + index, complexData.begin() + index + samplesPerSpectrum);
 			index += samplesPerSpectrum;
 
-			// Apply processing steps
-			if (options_.removeDC) {
-				// Rolling average DC removal
-				rollingAverageDCRemoval(spectrum);
-			}
+			// Apply processing steps and store processed and truncated data
+			preprocessSpectrum(spectrum);
+			postprocessSpectrum(spectrum, processedData[frameIndex][spectrumIndex]);
+		}
+	}
+}
 
-			if (options_.resample) {
-				// Ensure resample curve is generated
-				if (resamplePositions_.empty() || resamplingCurveOptionsChanged_) {
-					generateResampleCurve();
-					resamplingCurveOptionsChanged_ = false;
-				}
-				// K-linearization using cubic Hermite interpolation
-				std::vector<std::complex<T>> resampledSpectrum;
-				klinearizationCubic(spectrum, resamplePositions_, resampledSpectrum);
-				spectrum = resampledSpectrum;
-			}
+template <typename T>
+void Processor<T>::prepareSpectra(const void* inputData,
+                                  size_t totalSamples,
+                                  int inputBitDepth,
+                                  std::vector<ComplexBuffer>& spectra) {
+	prepareSpectra(contiguousView(inputData, totalSamples, inputBitDepth), inputBitDepth, spectra);
+}
 
-			if (options_.compensateDispersion) {
-				dispersionCompensation(spectrum);
-			}
+template <typename T>
+void Processor<T>::prepareSpectra(const SpectrumView& input,
+                                  int inputBitDepth,
+                                  std::vector<ComplexBuffer>& spectra) {
+	AllocationScope allocationScope(stageTimings_ != nullptr ? &stageTimings_->otherAllocations : nullptr);
+	ComplexBuffer complexData;
+	convertInputData(input, inputBitDepth, complexData);
+
+	size_t numSpectra = input.numberOfLines;
+	spectra.resize(numSpectra);
+	for (size_t spectrumIndex = 0; spectrumIndex < numSpectra; ++spectrumIndex) {
+		size_t index = spectrumIndex * samplesPerSpectrum_;
+		spectra[spectrumIndex].assign(complexData.begin() + index, complexData.begin() + index + samplesPerSpectrum_);
+		preprocessSpectrum(spectra[spectrumIndex]);
+	}
+}
 
-			if (options_.applyWindow) {
-				applyWindow(spectrum);
-			}
+template <typename T>
+void Processor<T>::processPreparedSpectra(const std::vector<ComplexBuffer>& spectra,
+                                          std::vector<RealBuffer>& processedSpectra) {
+	AllocationScope allocationScope(stageTimings_ != nullptr ? &stageTimings_->otherAllocations : nullptr);
+	processedSpectra.resize(spectra.size());
+	ComplexBuffer spectrum;
+	for (size_t spectrumIndex = 0; spectrumIndex < spectra.size(); ++spectrumIndex) {
+		spectrum = spectra[spectrumIndex];
+		postprocessSpectrum(spectrum, processedSpectra[spectrumIndex]);
+	}
+}
 
-			std::vector<std::complex<T>> ifftOutput;
-			if (options_.computeIFFT) {
-				computeIFFT(spectrum, ifftOutput);
-			} else {
-				ifftOutput = spectrum;
-			}
+template <typename T>
+void Processor<T>::preprocessSpectrum(ComplexBuffer& spectrum) {
+	if (options_.removeDC) {
+		// Rolling average DC removal
+		rollingAverageDCRemoval(spectrum);
+	}
 
-			std::vector<T> processedSpectrum;
-			if (options_.logScale) {
-				logScale(ifftOutput, processedSpectrum);
-			} else {
-				// Output magnitude
-				processedSpectrum.resize(ifftOutput.size());
-				for (size_t i = 0; i < ifftOutput.size(); ++i) {
-					processedSpectrum[i] = std::abs(ifftOutput[i]);
-				}
-			}
+	if (options_.resample) {
+		// Ensure resample curve is generated
+		updateResampleCurveIfNeeded();
+		// K-linearization using cubic Hermite interpolation
+		ComplexBuffer resampledSpectrum;
+		klinearizationCubic(spectrum, resamplePositions_, resampledSpectrum);
+		spectrum.swap(resampledSpectrum);
+	}
+}
 
-			//truncate to half to remove mirror artifact
-			size_t halfSize = processedSpectrum.size() / 2;
-			std::vector<T> truncated(halfSize);
-			for (size_t i = 0; i < halfSize; ++i) {
-				truncated[i] = processedSpectrum[i];
-			}
+template <typename T>
+void Processor<T>::postprocessSpectrum(ComplexBuffer& spectrum, RealBuffer& output) {
+	if (options_.compensateDispersion) {
+		dispersionCompensation(spectrum);
+	}
+
+	if (options_.applyWindow) {
+		applyWindow(spectrum);
+	}
 
-			//store processed and truncated data
-			processedData[frameIndex][spectrumIndex] = std::move(truncated);
+	ComplexBuffer ifftOutput;
+	if (options_.computeIFFT) {
+		computeIFFT(spectrum, ifftOutput);
+	} else {
+		ifftOutput = spectrum;
+	}
+
+	RealBuffer processedSpectrum;
+	if (options_.logScale) {
+		logScale(ifftOutput, processedSpectrum);
+	} else {
+		// Output magnitude
+		processedSpectrum.resize(ifftOutput.size());
+		for (size_t i = 0; i < ifftOutput.size(); ++i) {
+			processedSpectrum[i] = std::abs(ifftOutput[i]);
 		}
 	}
+
+	//truncate to half to remove mirror artifact
+	size_t halfSize = processedSpectrum.size() / 2;
+	processedSpectrum.resize(halfSize);
+	output = std::move(processedSpectrum);
+}
+
+template <typename T>
+T Processor<T>::computeIntensityMetricGradient(const void* inputData,
+                                               size_t totalSamples,
+                                               int inputBitDepth,
+                                               size_t ignoredSamples,
+                                               const std::vector<int>& coefficientOrders,
+                                               std::vector<T>& gradient) {
+	return computeIntensityMetricGradient(contiguousView(inputData, totalSamples, inputBitDepth), inputBitDepth,
+	                                      ignoredSamples, coefficientOrders, gradient);
+}
+
+template <typename T>
+T Processor<T>::computeIntensityMetricGradient(const SpectrumView& input,
+                                               int inputBitDepth,
+                                               size_t ignoredSamples,
+                                               const std::vector<int>& coefficientOrders,
+                                               std::vector<T>& gradient) {
+	AllocationScope allocationScope(stageTimings_ != nullptr ? &stageTimings_->otherAllocations : nullptr);
+	ComplexBuffer complexData;
+	convertInputData(input, inputBitDepth, complexData);
+
+	size_t samplesPerSpectrum = samplesPerSpectrum_;
+	size_t numSpectra = input.numberOfLines;
+	size_t halfSize = samplesPerSpectrum / 2;
+	size_t firstSample = std::min(ignoredSamples, halfSize);
+	size_t numCoefficients = coefficientOrders.size();
+
+	if (phaseComplex_.size() != samplesPerSpectrum) {
+		computeDispersivePhase();
+	}
+
+	// The dispersive phase is sum_j d_j * (k/(N-1))^j, so its derivative with respect to d_j is (k/(N-1))^j
+	T denom = static_cast<T>(samplesPerSpectrum - 1);
+	std::vector<RealBuffer> phaseDerivatives(numCoefficients, RealBuffer(samplesPerSpectrum));
+	for (size_t c = 0; c < numCoefficients; ++c) {
+		for (size_t i = 0; i < samplesPerSpectrum; ++i) {
+			phaseDerivatives[c][i] = std::pow(static_cast<T>(i) / denom, coefficientOrders[c]) * static_cast<T>(dispersionDirection_);
+		}
+	}
+
+	double metricSum = 0.0;
+	std::vector<double> gradientSum(numCoefficients, 0.0);
+	ComplexBuffer spectrum;
+	ComplexBuffer ascan;
+	ComplexBuffer derivativeSpectrum(samplesPerSpectrum);
+	ComplexBuffer derivativeAscan;
+
+	for (size_t spectrumIndex = 0; spectrumIndex < numSpectra; ++spectrumIndex) {
+		size_t index = spectrumIndex * samplesPerSpectrum;
+		spectrum.assign(complexData.begin() + index, complexData.begin() + index + samplesPerSpectrum);
+
+		preprocessSpectrum(spectrum);
+		if (options_.compensateDispersion) {
+			dispersionCompensation(spectrum);
+		}
+		if (options_.applyWindow) {
+			applyWindow(spectrum);
+		}
+		computeIFFT(spectrum, ascan);
+
+		for (size_t n = firstSample; n < halfSize; ++n) {
+			double intensity = static_cast<double>(std::norm(ascan[n]));
+			metricSum += intensity * intensity;
+		}
+
+		// d(|A|^4)/dd = 2*|A|^2 * 2*Re(conj(A) * dA/dd), with dA/dd = IFFT(i * dphase/dd * spectrum) since the IFFT is linear
+		if (!options_.compensateDispersion) {
+			continue;
+		}
+		for (size_t c = 0; c < numCoefficients; ++c) {
+			for (size_t i = 0; i < samplesPerSpectrum; ++i) {
+				derivativeSpectrum[i] = spectrum[i] * std::complex<T>(static_cast<T>(0), phaseDerivatives[c][i]);
+			}
+			computeIFFT(derivativeSpectrum, derivativeAscan);
+			for (size_t n = firstSample; n < halfSize; ++n) {
+				double intensity = static_cast<double>(std::norm(ascan[n]));
+				double intensityDerivative = 2.0 * static_cast<double>(std::real(std::conj(ascan[n]) * derivativeAscan[n]));
+				gradientSum[c] += 2.0 * intensity * intensityDerivative;
+			}
+		}
+	}
+
+	gradient.resize(numCoefficients);
+	for (size_t c = 0; c < numCoefficients; ++c) {
+		gradient[c] = static_cast<T>(gradientSum[c]);
+	}
+	return static_cast<T>(metricSum);
+}
+
+template <typename T>
+void Processor<T>::updateResampleCurveIfNeeded() {
+	if (resamplePositions_.empty() || resamplingCurveOptionsChanged_) {
+		generateResampleCurve();
+		resamplingCurveOptionsChanged_ = false;
+	}
 }
 
 template <typename T>
-void Processor<T>::rollingAverageDCRemoval(std::vector<std::complex<T>>& spectrum) {
+void Processor<T>::rollingAverageDCRemoval(ComplexBuffer& spectrum) {
+	ScopedStageTimer timer(stageTimings_, STAGE_DC_REMOVAL, spectrum.size());
 	size_t numSamples = spectrum.size();
 	size_t rollingWindowSize = rollingAverageWindowSize_;
 
 	// Compute cumulative sum for efficient rolling average computation
-	std::vector<T> cumulativeSum(numSamples + 1, static_cast<T>(0));
+	RealBuffer cumulativeSum(numSamples + 1, static_cast<T>(0));
 	for (size_t i = 0; i < numSamples; ++i) {
 		cumulativeSum[i + 1] = cumulativeSum[i] + spectrum[i].real();
 	}
@@ -346,9 +507,10 @@ void Processor<T>::rollingAverageDCRemoval(std::vector<std::complex<T>>& spectru
 }
 
 template <typename T>
-void Processor<T>::klinearizationCubic(const std::vector<std::complex<T>>& inputSpectrum,
+void Processor<T>::klinearizationCubic(const ComplexBuffer& inputSpectrum,
                                        const std::vector<T>& resampleCurve,
-                                       std::vector<std::complex<T>>& outputSpectrum) {
+                                       ComplexBuffer& outputSpectrum) {
+	ScopedStageTimer timer(stageTimings_, STAGE_K_LINEARIZATION, resampleCurve.size());
 	size_t width = resampleCurve.size();
 	outputSpectrum.resize(width);
 
@@ -379,7 +541,8 @@ void Processor<T>::klinearizationCubic(const std::vector<std::complex<T>>& input
 }
 
 template <typename T>
-void Processor<T>::dispersionCompensation(std::vector<std::complex<T>>& data) {
+void Processor<T>::dispersionCompensation(ComplexBuffer& data) {
+	ScopedStageTimer timer(stageTimings_, STAGE_DISPERSION_COMPENSATION, data.size());
 	size_t dataSize = data.size();
 
 	if (phaseComplex_.empty() || phaseComplex_.size() != dataSize) {
@@ -407,15 +570,17 @@ void Processor<T>::dispersionCompensation(std::vector<std::complex<T>>& data) {
 }
 
 template <typename T>
-void Processor<T>::applyWindow(std::vector<std::complex<T>>& data) {
+void Processor<T>::applyWindow(ComplexBuffer& data) {
+	ScopedStageTimer timer(stageTimings_, STAGE_WINDOWING, data.size());
 	for (size_t i = 0; i < data.size(); ++i) {
 		data[i] *= windowFunction_[i];
 	}
 }
 
 template <typename T>
-void Processor<T>::computeIFFT(const std::vector<std::complex<T>>& input,
-                               std::vector<std::complex<T>>& output) {
+void Processor<T>::computeIFFT(const ComplexBuffer& input,
+                               ComplexBuffer& output) {
+	ScopedStageTimer timer(stageTimings_, STAGE_IFFT, samplesPerSpectrum_);
 	// Copy input data to FFTW input array
 	for (size_t i = 0; i < samplesPerSpectrum_; ++i) {
 		fftIn_[i][0] = input[i].real();
@@ -434,8 +599,9 @@ void Processor<T>::computeIFFT(const std::vector<std::complex<T>>& input,
 }
 
 template <typename T>
-void Processor<T>::logScale(const std::vector<std::complex<T>>& input,
-                            std::vector<T>& output) {
+void Processor<T>::logScale(const ComplexBuffer& input,
+                            RealBuffer& output) {
+	ScopedStageTimer timer(stageTimings_, STAGE_LOG_SCALING, input.size());
 	size_t size = input.size();
 	output.resize(size);
 
@@ -446,7 +612,7 @@ void Processor<T>::logScale(const std::vector<std::complex<T>>& input,
 	T outputAscanLength = static_cast<T>(size);
 
 	// Compute magnitude squared and initial value array
-	std::vector<T> valueArray(size);
+	RealBuffer valueArray(size);
 	for (size_t i = 0; i < size; ++i) {
 		T realComponent = input[i].real();
 		T imaginaryComponent = input[i].imag();
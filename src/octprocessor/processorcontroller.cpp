@@ -1,17 +1,20 @@
 #include "processorcontroller.h"
-#include <QMessageBox>
 #include <QSettings>
 #include <QFileInfo>
 #include <QDir>
 #include <QDebug>
 
 ProcessorController::ProcessorController(QObject *parent)
-	: QObject(parent) {
+	: QObject(parent),
+	processorSamplesPerSpectrum_(0),
+	processorRollingAverageWindowSize_(0),
+	stageTimingEnabled_(false) {
 	// Initialize default settings if needed
 }
 
 void ProcessorController::setProcessingSettings(const ProcessingSettings& settings) {
 	settings_ = settings;
+	processor_.reset();
 }
 
 void ProcessorController::setDispersionCoefficients(qreal d2, qreal d3) {
@@ -19,6 +22,16 @@ void ProcessorController::setDispersionCoefficients(qreal d2, qreal d3) {
 	this->settings_.dispersionCoefficients[3] = static_cast<float>(d3);
 }
 
+void ProcessorController::setDispersionCoefficient(int order, qreal value) {
+	if (order < 0) {
+		return;
+	}
+	if (this->settings_.dispersionCoefficients.size() <= static_cast<size_t>(order)) {
+		this->settings_.dispersionCoefficients.resize(static_cast<size_t>(order) + 1, 0.0f);
+	}
+	this->settings_.dispersionCoefficients[static_cast<size_t>(order)] = static_cast<float>(value);
+}
+
 void ProcessorController::loadSettingsFromFile(QString filePath) {
 	// Check if the file exists; if not, you can bail out or create a default ini
 	if (!QFileInfo::exists(filePath)) {
@@ -28,6 +41,9 @@ void ProcessorController::loadSettingsFromFile(QString filePath) {
 
 	QSettings settingsFile(filePath, QSettings::IniFormat);
 
+	//files referenced by the settings (e.g. the custom resampling curve) may have changed, so the processor is recreated at next use
+	processor_.reset();
+
 	//load data dimension settings
 	settingsFile.beginGroup("Virtual OCT System");
 	settings_.bitDepth = settingsFile.value("bit_depth", 12).toInt();
@@ -101,48 +117,171 @@ void ProcessorController::loadCustomResamplingCurveFromFile(QString filePath){
 }
 
 bool ProcessorController::processData(const QByteArray& rawData, QVector<float>& outputData) {
+	return this->processData(this->viewOf(rawData), outputData);
+}
+
+bool ProcessorController::processData(const OCTSignalProcessing::SpectrumView& rawData, QVector<float>& outputData) {
 	using T = float;
 
+	// Create or update the processor
+	this->updateProcessor();
+
+	// Processed data output, it is copied to outputData before the workspace is reset
+	OCTSignalProcessing::ArenaScope workspace(&workspaceArena_);
+	std::vector<std::vector<OCTSignalProcessing::Processor<T>::RealBuffer>> processedData;
+
+	// Data that is not a whole number of frames (e.g. a subset of A-scans) is processed as one frame
+	size_t spectraPerFrame = settings_.spectraPerFrame;
+	size_t spectraInData = settings_.samplesPerSpectrum > 0 ? rawData.numberOfLines : 0;
+	if (spectraPerFrame == 0 || spectraInData % spectraPerFrame != 0) {
+		spectraPerFrame = spectraInData;
+	}
+	if (spectraPerFrame == 0) {
+		return false;
+	}
+
+	// Process the raw data
+	processor_->processRawData(rawData, settings_.bitDepth, spectraPerFrame, processedData);
+
+	// Fill outputData with processed data of all frames
+	if (!processedData.empty() && !processedData[0].empty()) {
+		size_t totalOutputSamples = 0;
+		for (const auto& frame : processedData) {
+			for (const auto& spectrum : frame) {
+				totalOutputSamples += spectrum.size();
+			}
+		}
+		outputData.resize(static_cast<int>(totalOutputSamples));
+		float* output = outputData.data();
+		for (const auto& frame : processedData) {
+			for (const auto& spectrum : frame) {
+				output = std::copy(spectrum.begin(), spectrum.end(), output);
+			}
+		}
+		return true;
+	}
+
+	return false;
+}
+
+bool ProcessorController::prepareSpectra(const QByteArray& rawData, PreparedSpectra& spectra) {
+	return this->prepareSpectra(this->viewOf(rawData), spectra);
+}
+
+bool ProcessorController::prepareSpectra(const OCTSignalProcessing::SpectrumView& rawData, PreparedSpectra& spectra) {
+	if (settings_.samplesPerSpectrum == 0 || rawData.isEmpty()) {
+		return false;
+	}
+
+	// The prepared spectra outlive this call, so they are not taken from the workspace arena
+	this->updateProcessor();
+	processor_->prepareSpectra(rawData, settings_.bitDepth, spectra);
+	return !spectra.empty();
+}
+
+bool ProcessorController::processPreparedSpectra(const PreparedSpectra& spectra, QVector<float>& outputData) {
+	if (spectra.empty()) {
+		return false;
+	}
+
+	this->updateProcessor();
+	OCTSignalProcessing::ArenaScope workspace(&workspaceArena_);
+	std::vector<OCTSignalProcessing::Processor<float>::RealBuffer> processedSpectra;
+	processor_->processPreparedSpectra(spectra, processedSpectra);
+
+	size_t totalOutputSamples = 0;
+	for (const auto& spectrum : processedSpectra) {
+		totalOutputSamples += spectrum.size();
+	}
+	outputData.resize(static_cast<int>(totalOutputSamples));
+	float* output = outputData.data();
+	for (const auto& spectrum : processedSpectra) {
+		output = std::copy(spectrum.begin(), spectrum.end(), output);
+	}
+	return true;
+}
+
+bool ProcessorController::processIntensityMetricGradient(const QByteArray& rawData, int ignoredSamples, const std::vector<int>& coefficientOrders, float& metricValue, std::vector<float>& gradient) {
+	return this->processIntensityMetricGradient(this->viewOf(rawData), ignoredSamples, coefficientOrders, metricValue, gradient);
+}
+
+bool ProcessorController::processIntensityMetricGradient(const OCTSignalProcessing::SpectrumView& rawData, int ignoredSamples, const std::vector<int>& coefficientOrders, float& metricValue, std::vector<float>& gradient) {
+	if (settings_.samplesPerSpectrum == 0 || rawData.isEmpty()) {
+		return false;
+	}
+
+	this->updateProcessor();
+	OCTSignalProcessing::ArenaScope workspace(&workspaceArena_);
+	metricValue = processor_->computeIntensityMetricGradient(rawData, settings_.bitDepth, static_cast<size_t>(qMax(0, ignoredSamples)),
+	                                                         coefficientOrders, gradient);
+	return true;
+}
+
+OCTSignalProcessing::SpectrumView ProcessorController::viewOf(const QByteArray& rawData) const {
 	size_t bytesPerSample = static_cast<size_t>(ceil(static_cast<double>(settings_.bitDepth)/8.0));
-	size_t totalSamples = rawData.size() / bytesPerSample;
-	//size_t expectedSamples = settings_.samplesPerSpectrum * settings_.spectraPerFrame * settings_.framesPerVolume;
+	size_t bytesPerSpectrum = settings_.samplesPerSpectrum * bytesPerSample;
+	size_t numberOfSpectra = bytesPerSpectrum > 0 ? static_cast<size_t>(rawData.size()) / bytesPerSpectrum : 0;
+	return OCTSignalProcessing::SpectrumView(rawData.constData(), bytesPerSpectrum, numberOfSpectra);
+}
 
-//	if (totalSamples != expectedSamples) {
-//		QMessageBox::critical(nullptr, tr("Error"), tr("Raw data size does not match the specified parameters."));
-//		return false;
-//	}
+void ProcessorController::setStageTimingEnabled(bool enabled) {
+	stageTimingEnabled_ = enabled;
+	if (processor_) {
+		processor_->setStageTimings(enabled ? &stageTimings_ : nullptr);
+	}
+}
 
-	// Create the processor
-	OCTSignalProcessing::Processor<T> processor(settings_.samplesPerSpectrum, settings_.rollingAverageWindowSize);
+bool ProcessorController::isStageTimingEnabled() const {
+	return stageTimingEnabled_;
+}
 
-	// Set processing options
-	processor.setProcessingOptions(settings_.processingOptions);
+void ProcessorController::setHardwareCountersEnabled(bool enabled) {
+	stageTimings_.hardwareCountersEnabled = enabled;
+}
 
-	// Set dispersion coefficients
-	processor.setDispersionCoefficients(settings_.dispersionCoefficients);
+void ProcessorController::releaseWorkspace() {
+	workspaceArena_.release();
+}
 
-	// Set resampling coefficients
-	processor.setResamplingCoefficients(settings_.resamplingCoefficients);
-	processor.setCustomResamplingCurve(settings_.filePathCustomResamplingCurve);
+OCTSignalProcessing::ArenaStatistics ProcessorController::getWorkspaceStatistics() const {
+	return workspaceArena_.statistics();
+}
 
-	// Set log scaling parameters
-	processor.setLogScaleParameters(settings_.logScaleCoeff, settings_.logScaleMin, settings_.logScaleMax,
-	                                settings_.logScaleAddend, settings_.autoComputeLogScaleMinMax);
+OCTSignalProcessing::StageTimings ProcessorController::takeStageTimings() {
+	OCTSignalProcessing::StageTimings timings = stageTimings_;
+	stageTimings_.reset();
+	return timings;
+}
 
-	// Processed data output
-	std::vector<std::vector<std::vector<T>>> processedData;
+void ProcessorController::updateProcessor() {
+	bool rebuild = !processor_
+			|| processorSamplesPerSpectrum_ != settings_.samplesPerSpectrum
+			|| processorRollingAverageWindowSize_ != settings_.rollingAverageWindowSize;
 
-	// Process the raw data
-	processor.processRawData(rawData.constData(), totalSamples, settings_.bitDepth, settings_.spectraPerFrame, processedData);
+	if (rebuild) {
+		processor_.reset(new OCTSignalProcessing::Processor<float>(settings_.samplesPerSpectrum, settings_.rollingAverageWindowSize));
+		processorSamplesPerSpectrum_ = settings_.samplesPerSpectrum;
+		processorRollingAverageWindowSize_ = settings_.rollingAverageWindowSize;
+		processor_->setStageTimings(stageTimingEnabled_ ? &stageTimings_ : nullptr);
+	}
 
-	// Fill outputData with processed data
-	if (!processedData.empty() && !processedData[0].empty()) {
-		outputData.clear();
-		for (const auto& spectrum : processedData[0]) {
-			outputData.append(QVector<float>::fromStdVector(spectrum));
-		}
-		return true;
+	// Set processing options
+	processor_->setProcessingOptions(settings_.processingOptions);
+
+	// Set dispersion coefficients
+	processor_->setDispersionCoefficients(settings_.dispersionCoefficients);
+
+	// Set resampling coefficients and custom resampling curve only if they changed, since the curve is read from file
+	if (rebuild || processorResamplingCoefficients_ != settings_.resamplingCoefficients) {
+		processor_->setResamplingCoefficients(settings_.resamplingCoefficients);
+		processorResamplingCoefficients_ = settings_.resamplingCoefficients;
+	}
+	if (rebuild || processorCustomResamplingCurvePath_ != settings_.filePathCustomResamplingCurve) {
+		processor_->setCustomResamplingCurve(settings_.filePathCustomResamplingCurve);
+		processorCustomResamplingCurvePath_ = settings_.filePathCustomResamplingCurve;
 	}
 
-	return false;
+	// Set log scaling parameters
+	processor_->setLogScaleParameters(settings_.logScaleCoeff, settings_.logScaleMin, settings_.logScaleMax,
+	                                  settings_.logScaleAddend, settings_.autoComputeLogScaleMinMax);
 }
@@ -10,6 +10,7 @@
 #include <QObject>
 #include <QVector>
 #include <QStandardPaths>
+#include <memory>
 #include "processor.h"
 
 class ProcessorController : public QObject {
@@ -45,16 +46,56 @@ public:
 
 	ProcessingSettings settings_;
 
+	// Spectra after the processing steps that do not depend on the dispersion coefficients
+	typedef std::vector<OCTSignalProcessing::Processor<float>::ComplexBuffer> PreparedSpectra;
+
 	explicit ProcessorController(QObject *parent = nullptr);
 	void setProcessingSettings(const ProcessingSettings& settings);
 	void setDispersionCoefficients(qreal d2, qreal d3);
+	// Sets the coefficient of the given polynomial order, the coefficient list grows as needed
+	void setDispersionCoefficient(int order, qreal value);
 	void loadSettingsFromFile(QString filePath);
 	void loadCustomResamplingCurveFromFile(QString filePath);
 
+	// rawData is either a copy of consecutive spectra or a view of spectra that are read in place from a frame buffer
 	bool processData(const QByteArray& rawData, QVector<float>& outputData);
+	bool processData(const OCTSignalProcessing::SpectrumView& rawData, QVector<float>& outputData);
+
+	// Searches that evaluate many dispersion coefficients on the same data prepare the spectra once and only repeat the remaining steps
+	bool prepareSpectra(const QByteArray& rawData, PreparedSpectra& spectra);
+	bool prepareSpectra(const OCTSignalProcessing::SpectrumView& rawData, PreparedSpectra& spectra);
+	bool processPreparedSpectra(const PreparedSpectra& spectra, QVector<float>& outputData);
+
+	// Sum of squared linear intensities of all A-scans in rawData and its derivatives with respect to the dispersion coefficients of the given orders
+	bool processIntensityMetricGradient(const QByteArray& rawData, int ignoredSamples, const std::vector<int>& coefficientOrders, float& metricValue, std::vector<float>& gradient);
+	bool processIntensityMetricGradient(const OCTSignalProcessing::SpectrumView& rawData, int ignoredSamples, const std::vector<int>& coefficientOrders, float& metricValue, std::vector<float>& gradient);
+
+	// Per-stage timing of the processor, disabled by default. takeStageTimings returns the timings accumulated since the last call and resets them.
+	void setStageTimingEnabled(bool enabled);
+	bool isStageTimingEnabled() const;
+	OCTSignalProcessing::StageTimings takeStageTimings();
+	// CPU performance counters around every stage (Linux only), needs stage timing
+	void setHardwareCountersEnabled(bool enabled);
+
+	// Temporary buffers of the processing calls come from an arena that is reused from call to call. releaseWorkspace gives
+	// its memory back, the engine calls it at the end of every estimation run.
+	void releaseWorkspace();
+	OCTSignalProcessing::ArenaStatistics getWorkspaceStatistics() const;
 
 private:
+	// The processor (FFTW plan, window, resampling curve) is kept between calls and only rebuilt if the settings it depends on change
+	std::unique_ptr<OCTSignalProcessing::Processor<float>> processor_;
+	size_t processorSamplesPerSpectrum_;
+	size_t processorRollingAverageWindowSize_;
+	std::vector<float> processorResamplingCoefficients_;
+	std::string processorCustomResamplingCurvePath_;
+	OCTSignalProcessing::StageTimings stageTimings_;
+	bool stageTimingEnabled_;
+	OCTSignalProcessing::MemoryArena workspaceArena_;
 
+	void updateProcessor();
+	// Consecutive spectra of the current bit depth and spectrum size
+	OCTSignalProcessing::SpectrumView viewOf(const QByteArray& rawData) const;
 };
 
 #endif // PROCESSORCONTROLLER_H
@@ -0,0 +1,36 @@
+#ifndef SPECTRUMVIEW_H
+#define SPECTRUMVIEW_H
+
+#include <cstddef>
+
+namespace OCTSignalProcessing {
+
+// Non-owning view of raw spectra in a frame buffer. Spectrum i starts at base + line(i) * lineStrideBytes, where line(i)
+// is i or lineIndices[i] if an index list is given, so center, sparse or selected A-scans of a frame can be processed in
+// place instead of being copied out of it first. The buffer and the index list must outlive the view.
+struct SpectrumView {
+	const char* base;
+	size_t lineStrideBytes;
+	size_t numberOfLines;
+	const size_t* lineIndices; // nullptr for the consecutive lines 0 to numberOfLines - 1
+
+	SpectrumView()
+		: base(nullptr), lineStrideBytes(0), numberOfLines(0), lineIndices(nullptr) {}
+
+	SpectrumView(const void* data, size_t lineStrideBytes, size_t numberOfLines, const size_t* lineIndices = nullptr)
+		: base(static_cast<const char*>(data)), lineStrideBytes(lineStrideBytes), numberOfLines(numberOfLines), lineIndices(lineIndices) {}
+
+	bool isEmpty() const { return numberOfLines == 0; }
+	size_t line(size_t i) const { return lineIndices != nullptr ? lineIndices[i] : i; }
+	const char* lineData(size_t i) const { return base + line(i) * lineStrideBytes; }
+
+	// Spectra first to first + count - 1 of this view
+	SpectrumView subView(size_t first, size_t count) const {
+		return lineIndices != nullptr ? SpectrumView(base, lineStrideBytes, count, lineIndices + first)
+		                              : SpectrumView(lineData(first), lineStrideBytes, count);
+	}
+};
+
+} // namespace OCTSignalProcessing
+
+#endif // SPECTRUMVIEW_H
@@ -0,0 +1,172 @@
+#ifndef STAGETIMINGS_H
+#define STAGETIMINGS_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include "hardwarecounters.h"
+#include "allocationtracking.h"
+
+namespace OCTSignalProcessing {
+
+enum ProcessingStage {
+	STAGE_CONVERSION,
+	STAGE_DC_REMOVAL,
+	STAGE_K_LINEARIZATION,
+	STAGE_DISPERSION_COMPENSATION,
+	STAGE_WINDOWING,
+	STAGE_IFFT,
+	STAGE_LOG_SCALING,
+	NUMBER_OF_PROCESSING_STAGES
+};
+
+// Accumulated wall time, number of calls, processed samples and heap allocations of every processing stage and, if enabled,
+// the hardware counter deltas of the calls for which the counters could be read.
+// Not thread-safe, every Processor writes into its own instance.
+struct StageTimings {
+	uint64_t nanoseconds[NUMBER_OF_PROCESSING_STAGES];
+	uint64_t calls[NUMBER_OF_PROCESSING_STAGES];
+	uint64_t samples[NUMBER_OF_PROCESSING_STAGES];
+	uint64_t counterCalls[NUMBER_OF_PROCESSING_STAGES];
+	uint64_t counters[NUMBER_OF_PROCESSING_STAGES][NUMBER_OF_HARDWARE_COUNTERS];
+	AllocationCounters allocations[NUMBER_OF_PROCESSING_STAGES];
+	AllocationCounters otherAllocations; // sample buffers allocated by the processor outside of the stages (copies, outputs)
+
+	// Reading the counters costs two system calls per stage call, so they are only read on request. Not changed by reset().
+	bool hardwareCountersEnabled;
+
+	StageTimings() : hardwareCountersEnabled(false) {
+		reset();
+	}
+
+	void reset() {
+		for (int i = 0; i < NUMBER_OF_PROCESSING_STAGES; ++i) {
+			nanoseconds[i] = 0;
+			calls[i] = 0;
+			samples[i] = 0;
+			counterCalls[i] = 0;
+			allocations[i].reset();
+			for (int j = 0; j < NUMBER_OF_HARDWARE_COUNTERS; ++j) {
+				counters[i][j] = 0;
+			}
+		}
+		otherAllocations.reset();
+	}
+
+	void add(ProcessingStage stage, uint64_t elapsedNanoseconds, size_t processedSamples) {
+		nanoseconds[stage] += elapsedNanoseconds;
+		calls[stage] += 1;
+		samples[stage] += processedSamples;
+	}
+
+	void addCounters(ProcessingStage stage, const HardwareCounterValues& start, const HardwareCounterValues& end) {
+		counterCalls[stage] += 1;
+		for (int j = 0; j < NUMBER_OF_HARDWARE_COUNTERS; ++j) {
+			counters[stage][j] += end.values[j] - start.values[j];
+		}
+	}
+
+	StageTimings& operator+=(const StageTimings& other) {
+		for (int i = 0; i < NUMBER_OF_PROCESSING_STAGES; ++i) {
+			nanoseconds[i] += other.nanoseconds[i];
+			calls[i] += other.calls[i];
+			samples[i] += other.samples[i];
+			counterCalls[i] += other.counterCalls[i];
+			allocations[i] += other.allocations[i];
+			for (int j = 0; j < NUMBER_OF_HARDWARE_COUNTERS; ++j) {
+				counters[i][j] += other.counters[i][j];
+			}
+		}
+		otherAllocations += other.otherAllocations;
+		return *this;
+	}
+
+	// Instructions per cycle and counter events per processed sample, 0 if no counters were read for the stage
+	double instructionsPerCycle(ProcessingStage stage) const {
+		return counters[stage][COUNTER_CYCLES] > 0 ? static_cast<double>(counters[stage][COUNTER_INSTRUCTIONS]) / static_cast<double>(counters[stage][COUNTER_CYCLES]) : 0.0;
+	}
+
+	double countsPerSample(ProcessingStage stage, HardwareCounter counter) const {
+		// Samples of calls without counter readings are excluded proportionally
+		if (counterCalls[stage] == 0 || calls[stage] == 0 || samples[stage] == 0) {
+			return 0.0;
+		}
+		double countedSamples = static_cast<double>(samples[stage]) * static_cast<double>(counterCalls[stage]) / static_cast<double>(calls[stage]);
+		return static_cast<double>(counters[stage][counter]) / countedSamples;
+	}
+
+	AllocationCounters totalAllocations() const {
+		AllocationCounters total = otherAllocations;
+		for (int i = 0; i < NUMBER_OF_PROCESSING_STAGES; ++i) {
+			total += allocations[i];
+		}
+		return total;
+	}
+
+	uint64_t totalNanoseconds() const {
+		uint64_t total = 0;
+		for (int i = 0; i < NUMBER_OF_PROCESSING_STAGES; ++i) {
+			total += nanoseconds[i];
+		}
+		return total;
+	}
+
+	static const char* stageName(ProcessingStage stage) {
+		switch (stage) {
+		case STAGE_CONVERSION: return "conversion";
+		case STAGE_DC_REMOVAL: return "dc_removal";
+		case STAGE_K_LINEARIZATION: return "k_linearization";
+		case STAGE_DISPERSION_COMPENSATION: return "dispersion_compensation";
+		case STAGE_WINDOWING: return "windowing";
+		case STAGE_IFFT: return "ifft";
+		case STAGE_LOG_SCALING: return "log_scaling";
+		default: return "unknown";
+		}
+	}
+};
+
+// Adds the lifetime of the timer and the allocations of TrackingAllocator during it to the given stage. Does nothing (not even
+// read the clock) if timings is null, so the timers can stay in the processing code when no one is interested in the timings.
+class ScopedStageTimer {
+public:
+	ScopedStageTimer(StageTimings* timings, ProcessingStage stage, size_t processedSamples)
+		: timings_(timings), stage_(stage), processedSamples_(processedSamples), counters_(nullptr),
+		  allocationScope_(timings != nullptr ? &timings->allocations[stage] : nullptr) {
+		if (timings_ != nullptr) {
+			if (timings_->hardwareCountersEnabled) {
+				HardwareCounters& counters = HardwareCounters::forCurrentThread();
+				if (counters.read(startCounters_)) {
+					counters_ = &counters;
+				}
+			}
+			start_ = std::chrono::steady_clock::now();
+		}
+	}
+
+	~ScopedStageTimer() {
+		if (timings_ != nullptr) {
+			auto elapsed = std::chrono::steady_clock::now() - start_;
+			timings_->add(stage_, static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()), processedSamples_);
+			HardwareCounterValues endCounters;
+			if (counters_ != nullptr && counters_->read(endCounters)) {
+				timings_->addCounters(stage_, startCounters_, endCounters);
+			}
+		}
+	}
+
+	ScopedStageTimer(const ScopedStageTimer&) = delete;
+	ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+private:
+	StageTimings* timings_;
+	ProcessingStage stage_;
+	size_t processedSamples_;
+	HardwareCounters* counters_;
+	HardwareCounterValues startCounters_;
+	AllocationScope allocationScope_;
+	std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace OCTSignalProcessing
+
+#endif // STAGETIMINGS_H
@@ -0,0 +1,287 @@
+#include "parallelmetricevaluator.h"
+#include "tracerecorder.h"
+#include <QThread>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QtConcurrent/QtConcurrentRun>
+#include <exception>
+
+namespace {
+// Adds the lifetime of a worker task to the busy time of its worker
+class BusyTimer
+{
+public:
+	explicit BusyTimer(qint64 &busyNanoseconds) : busyNanoseconds_(busyNanoseconds) { timer_.start(); }
+	~BusyTimer() { busyNanoseconds_ += timer_.nsecsElapsed(); }
+
+private:
+	qint64 &busyNanoseconds_;
+	QElapsedTimer timer_;
+};
+}
+
+ParallelMetricEvaluator::ParallelMetricEvaluator()
+	: threadCount_(QThread::idealThreadCount()),
+	stageTimingEnabled_(false),
+	hardwareCountersEnabled_(false),
+	wallNanoseconds_(0)
+{
+	threadPool_.setMaxThreadCount(threadCount_);
+}
+
+ParallelMetricEvaluator::~ParallelMetricEvaluator()
+{
+	threadPool_.waitForDone();
+	releaseWorkers();
+}
+
+void ParallelMetricEvaluator::setThreadCount(int threadCount)
+{
+	if (threadCount <= 0) {
+		threadCount = QThread::idealThreadCount();
+	}
+	threadCount_ = qMax(1, threadCount);
+	threadPool_.setMaxThreadCount(threadCount_);
+}
+
+int ParallelMetricEvaluator::getThreadCount() const
+{
+	return threadCount_;
+}
+
+void ParallelMetricEvaluator::prepare(const ProcessorController::ProcessingSettings &settings, const DispersionEstimatorParameters &params)
+{
+	while (workers_.size() > threadCount_) {
+		delete workers_.takeLast();
+	}
+	while (workers_.size() < threadCount_) {
+		workers_.append(new Worker());
+	}
+	for (Worker* worker : workers_) {
+		worker->controller.setProcessingSettings(settings);
+		worker->calculator.setParameters(params);
+		worker->controller.setStageTimingEnabled(stageTimingEnabled_);
+		worker->controller.setHardwareCountersEnabled(hardwareCountersEnabled_);
+	}
+}
+
+void ParallelMetricEvaluator::setStageTimingEnabled(bool enabled)
+{
+	stageTimingEnabled_ = enabled;
+	for (Worker* worker : workers_) {
+		worker->controller.setStageTimingEnabled(enabled);
+	}
+}
+
+void ParallelMetricEvaluator::setHardwareCountersEnabled(bool enabled)
+{
+	hardwareCountersEnabled_ = enabled;
+	for (Worker* worker : workers_) {
+		worker->controller.setHardwareCountersEnabled(enabled);
+	}
+}
+
+OCTSignalProcessing::StageTimings ParallelMetricEvaluator::takeStageTimings()
+{
+	OCTSignalProcessing::StageTimings timings;
+	for (Worker* worker : workers_) {
+		timings += worker->controller.takeStageTimings();
+	}
+	return timings;
+}
+
+ParallelMetricEvaluator::Utilization ParallelMetricEvaluator::takeUtilization()
+{
+	Utilization utilization;
+	utilization.busyNanoseconds = 0;
+	for (Worker* worker : workers_) {
+		utilization.busyNanoseconds += worker->busyNanoseconds;
+		worker->busyNanoseconds = 0;
+	}
+	utilization.wallNanoseconds = wallNanoseconds_;
+	wallNanoseconds_ = 0;
+	return utilization;
+}
+
+OCTSignalProcessing::ArenaStatistics ParallelMetricEvaluator::getWorkspaceStatistics() const
+{
+	OCTSignalProcessing::ArenaStatistics statistics;
+	for (const Worker* worker : workers_) {
+		statistics += worker->controller.getWorkspaceStatistics();
+	}
+	return statistics;
+}
+
+void ParallelMetricEvaluator::releaseWorkspaces()
+{
+	for (Worker* worker : workers_) {
+		worker->controller.releaseWorkspace();
+	}
+}
+
+QVector<float> ParallelMetricEvaluator::evaluate(const OCTSignalProcessing::SpectrumView &rawData, const QVector<Candidate> &candidates, QVector<bool> &success)
+{
+	const int numberOfCandidates = candidates.size();
+	QVector<float> metricValues(numberOfCandidates, 0.0f);
+	success.fill(false, numberOfCandidates);
+	if (numberOfCandidates == 0 || workers_.isEmpty()) {
+		return metricValues;
+	}
+
+	//workers write into disjoint elements, raw pointers avoid concurrent calls of the detaching QVector::operator[]
+	float* metricData = metricValues.data();
+	bool* successData = success.data();
+
+	//candidates are handed out one at a time so that workers stay balanced even if processing times differ
+	QAtomicInt nextCandidate(0);
+	QElapsedTimer wallTimer;
+	wallTimer.start();
+	QVector<QFuture<void>> futures;
+	int activeWorkers = qMin(workers_.size(), numberOfCandidates);
+	for (int i = 0; i < activeWorkers; ++i) {
+		Worker* worker = workers_[i];
+		futures.append(QtConcurrent::run(&threadPool_, [&, worker]() {
+			TraceScope taskTrace("worker_task", "worker");
+			BusyTimer busyTimer(worker->busyNanoseconds);
+			int samplesPerLine = static_cast<int>(worker->controller.settings_.samplesPerSpectrum / 2);
+			int index = nextCandidate.fetchAndAddRelaxed(1);
+			while (index < numberOfCandidates) {
+				TraceScope candidateTrace("candidate", "evaluation");
+				worker->controller.setDispersionCoefficients(candidates.at(index).first, candidates.at(index).second);
+				QVector<float> outputData;
+				try {
+					if (worker->controller.processData(rawData, outputData)) {
+						metricData[index] = worker->calculator.calculateMetric(outputData, samplesPerLine);
+						successData[index] = true;
+					}
+				} catch (const std::exception &) {
+					successData[index] = false;
+				}
+				index = nextCandidate.fetchAndAddRelaxed(1);
+			}
+		}));
+	}
+	for (QFuture<void> &future : futures) {
+		future.waitForFinished();
+	}
+	wallNanoseconds_ += wallTimer.nsecsElapsed();
+
+	return metricValues;
+}
+
+float ParallelMetricEvaluator::evaluateFrames(const OCTSignalProcessing::SpectrumView &rawData, const Candidate &candidate, int numberOfFrames, bool &success)
+{
+	success = false;
+	if (numberOfFrames <= 0 || workers_.isEmpty() || rawData.numberOfLines % static_cast<size_t>(numberOfFrames) != 0) {
+		return 0.0f;
+	}
+	const size_t linesPerFrame = rawData.numberOfLines / static_cast<size_t>(numberOfFrames);
+
+	QVector<float> frameMetricValues(numberOfFrames, 0.0f);
+	QVector<char> frameSuccess(numberOfFrames, 0);
+	float* metricData = frameMetricValues.data();
+	char* successData = frameSuccess.data();
+
+	QAtomicInt nextFrame(0);
+	QElapsedTimer wallTimer;
+	wallTimer.start();
+	QVector<QFuture<void>> futures;
+	int activeWorkers = qMin(workers_.size(), numberOfFrames);
+	for (int i = 0; i < activeWorkers; ++i) {
+		Worker* worker = workers_[i];
+		futures.append(QtConcurrent::run(&threadPool_, [&, worker]() {
+			TraceScope taskTrace("worker_task", "worker");
+			BusyTimer busyTimer(worker->busyNanoseconds);
+			int samplesPerLine = static_cast<int>(worker->controller.settings_.samplesPerSpectrum / 2);
+			worker->controller.setDispersionCoefficients(candidate.first, candidate.second);
+			int index = nextFrame.fetchAndAddRelaxed(1);
+			while (index < numberOfFrames) {
+				TraceScope frameTrace("candidate_frame", "evaluation");
+				//frames are processed in place, the sub-view does not copy
+				OCTSignalProcessing::SpectrumView frameData = rawData.subView(static_cast<size_t>(index) * linesPerFrame, linesPerFrame);
+				QVector<float> outputData;
+				try {
+					if (worker->controller.processData(frameData, outputData)) {
+						metricData[index] = worker->calculator.calculateMetric(outputData, samplesPerLine);
+						successData[index] = 1;
+					}
+				} catch (const std::exception &) {
+					successData[index] = 0;
+				}
+				index = nextFrame.fetchAndAddRelaxed(1);
+			}
+		}));
+	}
+	for (QFuture<void> &future : futures) {
+		future.waitForFinished();
+	}
+	wallNanoseconds_ += wallTimer.nsecsElapsed();
+
+	float metricValue = 0.0f;
+	for (int i = 0; i < numberOfFrames; ++i) {
+		if (!frameSuccess.at(i)) {
+			return 0.0f;
+		}
+		metricValue += frameMetricValues.at(i);
+	}
+	success = true;
+	return metricValue;
+}
+
+QVector<float> ParallelMetricEvaluator::evaluatePrepared(const ProcessorController::PreparedSpectra &spectra, const QVector<CoefficientVector> &candidates, QVector<bool> &success)
+{
+	const int numberOfCandidates = candidates.size();
+	QVector<float> metricValues(numberOfCandidates, 0.0f);
+	success.fill(false, numberOfCandidates);
+	if (numberOfCandidates == 0 || workers_.isEmpty()) {
+		return metricValues;
+	}
+
+	float* metricData = metricValues.data();
+	bool* successData = success.data();
+
+	QAtomicInt nextCandidate(0);
+	QElapsedTimer wallTimer;
+	wallTimer.start();
+	QVector<QFuture<void>> futures;
+	int activeWorkers = qMin(workers_.size(), numberOfCandidates);
+	for (int i = 0; i < activeWorkers; ++i) {
+		Worker* worker = workers_[i];
+		futures.append(QtConcurrent::run(&threadPool_, [&, worker]() {
+			TraceScope taskTrace("worker_task", "worker");
+			BusyTimer busyTimer(worker->busyNanoseconds);
+			int samplesPerLine = static_cast<int>(worker->controller.settings_.samplesPerSpectrum / 2);
+			int index = nextCandidate.fetchAndAddRelaxed(1);
+			while (index < numberOfCandidates) {
+				TraceScope candidateTrace("candidate", "evaluation");
+				const CoefficientVector &coefficients = candidates.at(index);
+				for (int j = 0; j < coefficients.size(); ++j) {
+					worker->controller.setDispersionCoefficient(j + 2, coefficients.at(j));
+				}
+				QVector<float> outputData;
+				try {
+					if (worker->controller.processPreparedSpectra(spectra, outputData)) {
+						metricData[index] = worker->calculator.calculateMetric(outputData, samplesPerLine);
+						successData[index] = true;
+					}
+				} catch (const std::exception &) {
+					successData[index] = false;
+				}
+				index = nextCandidate.fetchAndAddRelaxed(1);
+			}
+		}));
+	}
+	for (QFuture<void> &future : futures) {
+		future.waitForFinished();
+	}
+	wallNanoseconds_ += wallTimer.nsecsElapsed();
+
+	return metricValues;
+}
+
+void ParallelMetricEvaluator::releaseWorkers()
+{
+	qDeleteAll(workers_);
+	workers_.clear();
+}
@@ -0,0 +1,78 @@
+#ifndef PARALLELMETRICEVALUATOR_H
+#define PARALLELMETRICEVALUATOR_H
+
+#include <QVector>
+#include <QPair>
+#include <QThreadPool>
+#include "dispersionestimatorparameters.h"
+#include "octprocessor/processorcontroller.h"
+#include "ascanmetriccalculator.h"
+
+// Evaluates the A-scan metric of many dispersion candidates on a pool of worker threads.
+// Every worker owns its own ProcessorController (and thereby its own Processor, FFTW plan
+// and workspace), so candidates are processed independently of each other. Results are
+// returned in candidate order.
+class ParallelMetricEvaluator
+{
+public:
+	typedef QPair<qreal, qreal> Candidate; // (d2, d3)
+	typedef QVector<qreal> CoefficientVector; // (d2, d3, d4, ...)
+
+	// Time the worker tasks were running and wall time of the evaluate calls. Busy time divided by
+	// wall time times thread count is the utilization of the pool.
+	struct Utilization {
+		qint64 busyNanoseconds;
+		qint64 wallNanoseconds;
+	};
+
+	ParallelMetricEvaluator();
+	~ParallelMetricEvaluator();
+
+	// A thread count of 0 or less selects QThread::idealThreadCount()
+	void setThreadCount(int threadCount);
+	int getThreadCount() const;
+
+	// Copies processing settings and metric parameters into all workers. Needs to be called before evaluate() whenever the settings change.
+	void prepare(const ProcessorController::ProcessingSettings &settings, const DispersionEstimatorParameters &params);
+
+	// Enables the per-stage timers of all workers. takeStageTimings sums the timings of all workers (CPU time over all threads, not wall time) and resets them.
+	void setStageTimingEnabled(bool enabled);
+	OCTSignalProcessing::StageTimings takeStageTimings();
+	void setHardwareCountersEnabled(bool enabled);
+
+	// Utilization since the last call
+	Utilization takeUtilization();
+
+	// Workspace arenas of all workers, see ProcessorController::releaseWorkspace
+	OCTSignalProcessing::ArenaStatistics getWorkspaceStatistics() const;
+	void releaseWorkspaces();
+
+	// rawData is read in place by all workers and must not change until the call returns
+	QVector<float> evaluate(const OCTSignalProcessing::SpectrumView &rawData, const QVector<Candidate> &candidates, QVector<bool> &success);
+
+	// Evaluates a single candidate on data that consists of several frames by processing the frames in parallel.
+	// The metric is a sum over A-scans, so the per-frame results are added up.
+	float evaluateFrames(const OCTSignalProcessing::SpectrumView &rawData, const Candidate &candidate, int numberOfFrames, bool &success);
+
+	// Evaluates candidates with any number of coefficients on spectra that have already been prepared.
+	// The spectra are shared read-only by all workers.
+	QVector<float> evaluatePrepared(const ProcessorController::PreparedSpectra &spectra, const QVector<CoefficientVector> &candidates, QVector<bool> &success);
+
+private:
+	struct Worker {
+		ProcessorController controller;
+		AscanMetricCalculator calculator;
+		qint64 busyNanoseconds = 0; // only written by the task that currently owns the worker
+	};
+
+	QVector<Worker*> workers_;
+	QThreadPool threadPool_;
+	int threadCount_;
+	bool stageTimingEnabled_;
+	bool hardwareCountersEnabled_;
+	qint64 wallNanoseconds_;
+
+	void releaseWorkers();
+};
+
+#endif // PARALLELMETRICEVALUATOR_H
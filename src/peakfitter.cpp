@@ -0,0 +1,161 @@
+#include "peakfitter.h"
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+namespace {
+	//number of samples closest to the best sample that are used for the 2D surface fit
+	const size_t SURFACE_FIT_NEIGHBOURS = 12;
+	const size_t SURFACE_FIT_COEFFICIENTS = 6;
+
+	//solves the linear system a*x = b in place with gaussian elimination and partial pivoting
+	bool solveLinearSystem(std::vector<std::vector<double>> &a, std::vector<double> &b)
+	{
+		const size_t n = b.size();
+		for (size_t col = 0; col < n; ++col) {
+			size_t pivot = col;
+			for (size_t row = col + 1; row < n; ++row) {
+				if (std::fabs(a[row][col]) > std::fabs(a[pivot][col])) {
+					pivot = row;
+				}
+			}
+			if (std::fabs(a[pivot][col]) < 1e-12) {
+				return false;
+			}
+			std::swap(a[pivot], a[col]);
+			std::swap(b[pivot], b[col]);
+			for (size_t row = col + 1; row < n; ++row) {
+				double factor = a[row][col] / a[col][col];
+				for (size_t k = col; k < n; ++k) {
+					a[row][k] -= factor * a[col][k];
+				}
+				b[row] -= factor * b[col];
+			}
+		}
+		for (size_t i = n; i-- > 0;) {
+			double sum = b[i];
+			for (size_t k = i + 1; k < n; ++k) {
+				sum -= a[i][k] * b[k];
+			}
+			b[i] = sum / a[i][i];
+		}
+		return true;
+	}
+}
+
+PeakFitter::Peak1D PeakFitter::fitParabola(const std::vector<double> &x, const std::vector<double> &y)
+{
+	Peak1D peak = {0.0, 0.0, 0.0, false};
+	if (x.empty() || x.size() != y.size()) {
+		return peak;
+	}
+
+	size_t best = static_cast<size_t>(std::max_element(y.begin(), y.end()) - y.begin());
+	peak.position = x[best];
+	peak.value = y[best];
+	if (best == 0 || best + 1 >= x.size()) {
+		return peak;
+	}
+
+	double x0 = x[best - 1], x1 = x[best], x2 = x[best + 1];
+	double y0 = y[best - 1], y1 = y[best], y2 = y[best + 1];
+	if (x1 == x0 || x2 == x1) {
+		return peak;
+	}
+
+	//parabola y = a*x^2 + b*x + c through the three samples (divided differences)
+	double slopeLeft = (y1 - y0) / (x1 - x0);
+	double slopeRight = (y2 - y1) / (x2 - x1);
+	double a = (slopeRight - slopeLeft) / (x2 - x0);
+	if (!(a < 0.0)) {
+		return peak; // flat or not a maximum
+	}
+	double b = slopeLeft - a * (x0 + x1);
+	double c = y1 - a * x1 * x1 - b * x1;
+
+	double vertex = -b / (2.0 * a);
+	vertex = std::min(std::max(vertex, std::min(x0, x2)), std::max(x0, x2));
+
+	peak.position = vertex;
+	peak.value = a * vertex * vertex + b * vertex + c;
+	peak.curvature = 2.0 * a;
+	peak.valid = true;
+	return peak;
+}
+
+PeakFitter::Peak2D PeakFitter::fitQuadraticSurface(const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &value, double scaleX, double scaleY)
+{
+	Peak2D peak = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0, false};
+	if (value.empty() || x.size() != value.size() || y.size() != value.size()) {
+		return peak;
+	}
+
+	size_t best = static_cast<size_t>(std::max_element(value.begin(), value.end()) - value.begin());
+	peak.x = x[best];
+	peak.y = y[best];
+	peak.value = value[best];
+	if (value.size() < SURFACE_FIT_COEFFICIENTS || scaleX <= 0.0 || scaleY <= 0.0) {
+		return peak;
+	}
+
+	//work in coordinates that are centered at the best sample and normalized by the given scales
+	std::vector<double> u(value.size());
+	std::vector<double> v(value.size());
+	for (size_t i = 0; i < value.size(); ++i) {
+		u[i] = (x[i] - x[best]) / scaleX;
+		v[i] = (y[i] - y[best]) / scaleY;
+	}
+
+	std::vector<size_t> order(value.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [&u, &v](size_t a, size_t b) {
+		return u[a]*u[a] + v[a]*v[a] < u[b]*u[b] + v[b]*v[b];
+	});
+	order.resize(std::min(order.size(), SURFACE_FIT_NEIGHBOURS));
+
+	//normal equations of the least squares problem
+	std::vector<std::vector<double>> normalMatrix(SURFACE_FIT_COEFFICIENTS, std::vector<double>(SURFACE_FIT_COEFFICIENTS, 0.0));
+	std::vector<double> rightHandSide(SURFACE_FIT_COEFFICIENTS, 0.0);
+	double minU = 0.0, maxU = 0.0, minV = 0.0, maxV = 0.0;
+	for (size_t index : order) {
+		double basis[SURFACE_FIT_COEFFICIENTS] = {u[index]*u[index], u[index]*v[index], v[index]*v[index], u[index], v[index], 1.0};
+		for (size_t row = 0; row < SURFACE_FIT_COEFFICIENTS; ++row) {
+			for (size_t col = 0; col < SURFACE_FIT_COEFFICIENTS; ++col) {
+				normalMatrix[row][col] += basis[row] * basis[col];
+			}
+			rightHandSide[row] += basis[row] * value[index];
+		}
+		minU = std::min(minU, u[index]);
+		maxU = std::max(maxU, u[index]);
+		minV = std::min(minV, v[index]);
+		maxV = std::max(maxV, v[index]);
+	}
+	if (!solveLinearSystem(normalMatrix, rightHandSide)) {
+		return peak;
+	}
+
+	double a = rightHandSide[0], b = rightHandSide[1], c = rightHandSide[2];
+	double d = rightHandSide[3], e = rightHandSide[4], g = rightHandSide[5];
+
+	//the fitted surface needs a negative definite hessian to have a maximum
+	double determinant = 4.0 * a * c - b * b;
+	if (!(a < 0.0) || !(determinant > 0.0)) {
+		return peak;
+	}
+	double vertexU = (-2.0 * c * d + b * e) / determinant;
+	double vertexV = (-2.0 * a * e + b * d) / determinant;
+
+	//do not extrapolate beyond the samples used for the fit
+	if (vertexU < minU || vertexU > maxU || vertexV < minV || vertexV > maxV) {
+		return peak;
+	}
+
+	peak.x = x[best] + vertexU * scaleX;
+	peak.y = y[best] + vertexV * scaleY;
+	peak.value = a*vertexU*vertexU + b*vertexU*vertexV + c*vertexV*vertexV + d*vertexU + e*vertexV + g;
+	peak.curvatureXX = 2.0 * a / (scaleX * scaleX);
+	peak.curvatureYY = 2.0 * c / (scaleY * scaleY);
+	peak.curvatureXY = b / (scaleX * scaleY);
+	peak.valid = true;
+	return peak;
+}
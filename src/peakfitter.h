@@ -0,0 +1,37 @@
+#ifndef PEAKFITTER_H
+#define PEAKFITTER_H
+
+#include <vector>
+
+// Refines the position of a sampled metric maximum beyond the sampling grid by fitting a
+// parabola (1D) or a quadratic surface (2D) through the best sample and its neighbours.
+class PeakFitter
+{
+public:
+	struct Peak1D {
+		double position;
+		double value;
+		double curvature; // second derivative of the fitted parabola
+		bool valid;
+	};
+
+	struct Peak2D {
+		double x;
+		double y;
+		double value;
+		double curvatureXX; // entries of the Hessian of the fitted surface
+		double curvatureYY;
+		double curvatureXY;
+		bool valid;
+	};
+
+	// Fits a parabola through the maximum of y and its two neighbours. x needs to be sorted.
+	// If the maximum lies at the border or the samples do not form a peak, the best sample is returned and valid is false.
+	static Peak1D fitParabola(const std::vector<double> &x, const std::vector<double> &y);
+
+	// Fits f(x,y) = a*x^2 + b*x*y + c*y^2 + d*x + e*y + g in a least squares sense to the samples
+	// closest to the best sample. scaleX and scaleY are used to normalize the distance between samples.
+	static Peak2D fitQuadraticSurface(const std::vector<double> &x, const std::vector<double> &y, const std::vector<double> &value, double scaleX, double scaleY);
+};
+
+#endif // PEAKFITTER_H
@@ -0,0 +1,186 @@
+#include "performancedashboard.h"
+#include <QGridLayout>
+#include <QVBoxLayout>
+#include <QSharedPointer>
+
+#define TRACKING_SMOOTHING 0.2 // weight of the newest frame in the averages of the tracking rate
+
+namespace {
+QString percent(double fraction)
+{
+	return fraction < 0.0 ? QObject::tr("-") : QString::number(fraction * 100.0, 'f', 0) + " %";
+}
+}
+
+PerformanceDashboard::PerformanceDashboard(QWidget *parent)
+	: QWidget(parent),
+	  stagePlotDirty(false)
+{
+	QGridLayout* valueLayout = new QGridLayout();
+	valueLayout->setContentsMargins(0, 0, 0, 0);
+	QLabel** valueLabels[] = {&this->labelLatency, &this->labelCandidates, &this->labelAscans, &this->labelThreads,
+							  &this->labelCache, &this->labelMemory, &this->labelDrops, &this->labelTracking};
+	const QString names[] = {tr("Last run:"), tr("Candidates/s:"), tr("A-scans/s:"), tr("Threads:"),
+							 tr("Metric cache:"), tr("Peak RSS:"), tr("Dropped frames:"), tr("Live tracking:")};
+	const int numberOfValues = static_cast<int>(sizeof(valueLabels) / sizeof(valueLabels[0]));
+	for (int i = 0; i < numberOfValues; ++i) {
+		*valueLabels[i] = new QLabel(this);
+		(*valueLabels[i])->setTextInteractionFlags(Qt::TextSelectableByMouse);
+		// Two columns of name/value pairs, the drop and tracking lines span the whole width
+		bool fullWidth = i >= numberOfValues - 2;
+		int row = fullWidth ? i - 3 : i / 2;
+		int column = fullWidth ? 0 : (i % 2) * 2;
+		valueLayout->addWidget(new QLabel(names[i], this), row, column);
+		valueLayout->addWidget(*valueLabels[i], row, column + 1, 1, fullWidth ? 3 : 1);
+	}
+	valueLayout->setColumnStretch(1, 1);
+	valueLayout->setColumnStretch(3, 1);
+
+	this->stagePlot = new QCustomPlot(this);
+	this->stagePlot->setMinimumHeight(160);
+	this->setupStagePlot();
+
+	QVBoxLayout* layout = new QVBoxLayout(this);
+	layout->setContentsMargins(0, 0, 0, 0);
+	layout->addLayout(valueLayout);
+	layout->addWidget(this->stagePlot);
+
+	this->showFrameDrops(0, 0);
+	this->clear();
+}
+
+void PerformanceDashboard::showRunReport(EstimationRunReport report)
+{
+	this->labelLatency->setText(QString("%1 ms (%2)")
+			.arg(static_cast<double>(report.totalNanoseconds) / 1.0e6, 0, 'f', 1)
+			.arg(report.liveTracking ? tr("tracking") : EstimationRunReport::strategyName(report.strategy)));
+	this->labelCandidates->setText(QString::number(report.candidatesPerSecond(), 'f', 1));
+	this->labelAscans->setText(QString::number(report.ascansPerSecond(), 'f', 0));
+	this->labelThreads->setText(report.threadUtilization() < 0.0 ? QString::number(report.numberOfThreads)
+			: tr("%1, %2 busy").arg(report.numberOfThreads).arg(percent(report.threadUtilization())));
+	this->labelCache->setText(report.cacheHitRate() < 0.0 ? tr("-")
+			: tr("%1 hits of %2").arg(percent(report.cacheHitRate())).arg(report.cacheHits + report.cacheMisses));
+	this->labelMemory->setText(report.peakResidentBytes < 0 ? tr("-")
+			: QString("%1 MiB").arg(static_cast<double>(report.peakResidentBytes) / (1024.0 * 1024.0), 0, 'f', 0));
+
+	if (report.liveTracking) {
+		double runMs = static_cast<double>(report.totalNanoseconds) / 1.0e6;
+		this->averageTrackingRunMs = this->averageTrackingRunMs < 0.0 ? runMs
+				: (1.0 - TRACKING_SMOOTHING) * this->averageTrackingRunMs + TRACKING_SMOOTHING * runMs;
+		this->updateTrackingLabel();
+	}
+
+	QVector<double> keys;
+	QVector<double> values;
+	for (int i = 0; i < OCTSignalProcessing::NUMBER_OF_PROCESSING_STAGES; ++i) {
+		keys.append(i);
+		values.append(static_cast<double>(report.stageTimings.nanoseconds[i]) / 1.0e6);
+	}
+	this->stageBars->setData(keys, values, true);
+	this->stagePlot->xAxis->rescale();
+	this->stagePlot->xAxis->setRangeLower(0.0);
+	this->stagePlotDirty = true;
+	if (this->isVisible()) {
+		this->stagePlot->replot(QCustomPlot::rpQueuedReplot);
+		this->stagePlotDirty = false;
+	}
+}
+
+void PerformanceDashboard::showTrackingFrame(double intervalMs, int skippedFrames)
+{
+	if (intervalMs > 0.0) {
+		this->averageTrackingIntervalMs = this->averageTrackingIntervalMs < 0.0 ? intervalMs
+				: (1.0 - TRACKING_SMOOTHING) * this->averageTrackingIntervalMs + TRACKING_SMOOTHING * intervalMs;
+	}
+	this->skippedTrackingFrames += skippedFrames;
+	this->trackingBehind = skippedFrames > 0;
+	this->updateTrackingLabel();
+}
+
+void PerformanceDashboard::showFrameDrops(int droppedOldest, int droppedNewest)
+{
+	this->labelDrops->setText(tr("%1 oldest waiting, %2 newest").arg(droppedOldest).arg(droppedNewest));
+}
+
+void PerformanceDashboard::clear()
+{
+	QLabel* valueLabels[] = {this->labelLatency, this->labelCandidates, this->labelAscans, this->labelThreads,
+							 this->labelCache, this->labelMemory};
+	for (QLabel* label : valueLabels) {
+		label->setText(tr("-"));
+	}
+	this->averageTrackingIntervalMs = -1.0;
+	this->averageTrackingRunMs = -1.0;
+	this->skippedTrackingFrames = 0;
+	this->trackingBehind = false;
+	this->updateTrackingLabel();
+
+	this->stageBars->data()->clear();
+	this->stagePlotDirty = true;
+	if (this->isVisible()) {
+		this->stagePlot->replot();
+		this->stagePlotDirty = false;
+	}
+}
+
+void PerformanceDashboard::showEvent(QShowEvent *event)
+{
+	QWidget::showEvent(event);
+	if (this->stagePlotDirty) {
+		this->stagePlot->replot();
+		this->stagePlotDirty = false;
+	}
+}
+
+void PerformanceDashboard::setupStagePlot()
+{
+	// Horizontal bars, one per processing stage, so the stage names fit on the axis
+	this->stageBars = new QCPBars(this->stagePlot->yAxis, this->stagePlot->xAxis);
+	this->stageBars->setWidth(0.6);
+	this->stageBars->setPen(Qt::NoPen);
+	this->stageBars->setBrush(QColor(55, 100, 250));
+
+	QSharedPointer<QCPAxisTickerText> stageTicker(new QCPAxisTickerText);
+	for (int i = 0; i < OCTSignalProcessing::NUMBER_OF_PROCESSING_STAGES; ++i) {
+		stageTicker->addTick(i, OCTSignalProcessing::StageTimings::stageName(static_cast<OCTSignalProcessing::ProcessingStage>(i)));
+	}
+	this->stagePlot->yAxis->setTicker(stageTicker);
+	this->stagePlot->yAxis->setRange(-0.5, OCTSignalProcessing::NUMBER_OF_PROCESSING_STAGES - 0.5);
+	this->stagePlot->yAxis->setRangeReversed(true);
+	this->stagePlot->yAxis->grid()->setVisible(false);
+	this->stagePlot->xAxis->setLabel(tr("Stage time in ms (sum over all threads)"));
+	this->stagePlot->xAxis->setRange(0.0, 1.0);
+
+	QFont tickFont = this->font();
+	tickFont.setPointSize(8);
+	this->stagePlot->xAxis->setTickLabelFont(tickFont);
+	this->stagePlot->yAxis->setTickLabelFont(tickFont);
+	this->stagePlot->xAxis->setLabelFont(tickFont);
+}
+
+void PerformanceDashboard::updateTrackingLabel()
+{
+	if (this->averageTrackingIntervalMs < 0.0 && this->averageTrackingRunMs < 0.0 && this->skippedTrackingFrames == 0) {
+		this->labelTracking->setText(tr("-"));
+		this->labelTracking->setStyleSheet(QString());
+		return;
+	}
+
+	QStringList parts;
+	if (this->averageTrackingIntervalMs > 0.0) {
+		parts.append(tr("%1 Hz").arg(1000.0 / this->averageTrackingIntervalMs, 0, 'f', 1));
+	}
+	if (this->averageTrackingRunMs >= 0.0) {
+		parts.append(tr("%1 ms per update").arg(this->averageTrackingRunMs, 0, 'f', 1));
+	}
+	parts.append(tr("%1 frames skipped").arg(this->skippedTrackingFrames));
+
+	// The engine falls behind if it had to skip the last due frame or needs longer than the time between frames
+	bool behind = this->trackingBehind
+			|| (this->averageTrackingIntervalMs > 0.0 && this->averageTrackingRunMs > this->averageTrackingIntervalMs);
+	if (behind) {
+		parts.append(tr("falling behind"));
+	}
+	this->labelTracking->setText(parts.join(", "));
+	this->labelTracking->setStyleSheet(behind ? "color: red;" : QString());
+}
@@ -0,0 +1,54 @@
+#ifndef PERFORMANCEDASHBOARD_H
+#define PERFORMANCEDASHBOARD_H
+
+#include <QWidget>
+#include <QLabel>
+#include "qcustomplot.h"
+#include "estimationrunreport.h"
+
+// PerformanceDashboard shows the run reports of the engine: throughput, latency, thread utilization, metric cache
+// hit rate, memory and a bar chart of the time spent in every processing stage. It also shows whether live tracking
+// keeps up with the incoming frames. The reports arrive as queued signals, so the engine never waits for the panel,
+// and the chart is only redrawn while the panel is visible.
+class PerformanceDashboard : public QWidget
+{
+	Q_OBJECT
+public:
+	explicit PerformanceDashboard(QWidget *parent = nullptr);
+
+public slots:
+	void showRunReport(EstimationRunReport report);
+	// Called for every tracking frame handed to the engine. intervalMs is the time since the previous one (-1 for the
+	// first one), skippedFrames the number of frames that were dropped since the previous one because the engine was busy.
+	void showTrackingFrame(double intervalMs, int skippedFrames);
+	// Frames dropped by the frame ring between acquisition and engine since the plugin was loaded
+	void showFrameDrops(int droppedOldest, int droppedNewest);
+	void clear();
+
+protected:
+	void showEvent(QShowEvent *event) override;
+
+private:
+	QLabel* labelLatency;
+	QLabel* labelCandidates;
+	QLabel* labelAscans;
+	QLabel* labelThreads;
+	QLabel* labelCache;
+	QLabel* labelMemory;
+	QLabel* labelDrops;
+	QLabel* labelTracking;
+	QCustomPlot* stagePlot;
+	QCPBars* stageBars;
+	bool stagePlotDirty;
+
+	// Tracking rate is smoothed over several frames, single frames jitter with the acquisition
+	double averageTrackingIntervalMs;
+	double averageTrackingRunMs;
+	int skippedTrackingFrames; // since clear()
+	bool trackingBehind;
+
+	void setupStagePlot();
+	void updateTrackingLabel();
+};
+
+#endif // PERFORMANCEDASHBOARD_H
@@ -0,0 +1,86 @@
+#include "processmemory.h"
+#include <QFile>
+#include <QByteArray>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+#ifdef Q_OS_LINUX
+namespace {
+// Value of a "Name:   1234 kB" line of /proc/self/status in bytes
+qint64 procStatusBytes(const char *name)
+{
+	QFile file(QStringLiteral("/proc/self/status"));
+	if (!file.open(QIODevice::ReadOnly)) {
+		return -1;
+	}
+	const QByteArray prefix = QByteArray(name) + ':';
+	// /proc files report a size of 0, so they are read line by line
+	while (!file.atEnd()) {
+		QByteArray line = file.readLine();
+		if (line.startsWith(prefix)) {
+			QList<QByteArray> fields = line.mid(prefix.size()).simplified().split(' ');
+			bool ok = false;
+			qint64 kilobytes = fields.value(0).toLongLong(&ok);
+			return ok ? kilobytes * 1024 : -1;
+		}
+	}
+	return -1;
+}
+}
+#endif
+
+qint64 ProcessMemory::residentBytes()
+{
+#if defined(Q_OS_LINUX)
+	return procStatusBytes("VmRSS");
+#elif defined(Q_OS_WIN)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return static_cast<qint64>(counters.WorkingSetSize);
+	}
+	return -1;
+#else
+	return -1;
+#endif
+}
+
+qint64 ProcessMemory::peakResidentBytes()
+{
+#if defined(Q_OS_LINUX)
+	return procStatusBytes("VmHWM");
+#elif defined(Q_OS_WIN)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return static_cast<qint64>(counters.PeakWorkingSetSize);
+	}
+	return -1;
+#elif defined(Q_OS_UNIX)
+	// ru_maxrss is in bytes on macOS
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		return static_cast<qint64>(usage.ru_maxrss);
+	}
+	return -1;
+#else
+	return -1;
+#endif
+}
+
+bool ProcessMemory::resetPeakResidentBytes()
+{
+#ifdef Q_OS_LINUX
+	// Writing 5 to clear_refs resets VmHWM to the current RSS (Linux 4.0 and later)
+	QFile file(QStringLiteral("/proc/self/clear_refs"));
+	if (!file.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+	return file.write("5") == 1;
+#else
+	return false;
+#endif
+}
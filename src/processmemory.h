@@ -0,0 +1,19 @@
+#ifndef PROCESSMEMORY_H
+#define PROCESSMEMORY_H
+
+#include <QtGlobal>
+
+// Resident set size of the whole process (OCTproZ with all plugins when running as extension).
+// Values are in bytes, -1 if the platform does not provide them.
+class ProcessMemory
+{
+public:
+	static qint64 residentBytes();
+	static qint64 peakResidentBytes();
+
+	// Sets the peak to the current resident set size, so that peakResidentBytes covers only what follows.
+	// Only possible on Linux; returns false if the peak keeps covering the whole lifetime of the process.
+	static bool resetPeakResidentBytes();
+};
+
+#endif // PROCESSMEMORY_H
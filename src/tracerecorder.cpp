@@ -0,0 +1,234 @@
+#include "tracerecorder.h"
+#include <QCoreApplication>
+#include <QThread>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+TraceRecorder& TraceRecorder::instance()
+{
+	static TraceRecorder recorder;
+	return recorder;
+}
+
+TraceRecorder::TraceRecorder()
+	: enabled_(0),
+	capacity_(TRACE_RECORDER_DEFAULT_CAPACITY),
+	nextEvent_(0),
+	wrapped_(false),
+	realtimeEventsWritten_(0),
+	realtimeEventsCleared_(0)
+{
+	for (RealtimeEvent &event : realtimeEvents_) {
+		event.sequence.storeRelease(0);
+	}
+	clock_.start();
+}
+
+void TraceRecorder::setEnabled(bool enabled)
+{
+	// The ring buffer is only allocated once tracing is used
+	if (enabled) {
+		QMutexLocker locker(&mutex_);
+		if (events_.size() != capacity_) {
+			events_.resize(capacity_);
+			nextEvent_ = 0;
+			wrapped_ = false;
+		}
+	}
+	enabled_.storeRelease(enabled ? 1 : 0);
+}
+
+bool TraceRecorder::isEnabled() const
+{
+	return enabled_.loadAcquire() != 0;
+}
+
+void TraceRecorder::setCapacity(int numberOfEvents)
+{
+	QMutexLocker locker(&mutex_);
+	capacity_ = qMax(1, numberOfEvents);
+	events_.clear();
+	if (this->isEnabled()) {
+		events_.resize(capacity_);
+	}
+	nextEvent_ = 0;
+	wrapped_ = false;
+}
+
+void TraceRecorder::clear()
+{
+	QMutexLocker locker(&mutex_);
+	nextEvent_ = 0;
+	wrapped_ = false;
+	realtimeEventsCleared_.storeRelease(realtimeEventsWritten_.loadAcquire());
+}
+
+int TraceRecorder::eventCount() const
+{
+	QMutexLocker locker(&mutex_);
+	return (wrapped_ ? events_.size() : nextEvent_) + this->realtimeEventCount();
+}
+
+qint64 TraceRecorder::now() const
+{
+	return clock_.nsecsElapsed();
+}
+
+void TraceRecorder::addEvent(const char* name, const char* category, qint64 startNanoseconds, qint64 durationNanoseconds)
+{
+	if (!this->isEnabled()) {
+		return;
+	}
+	QMutexLocker locker(&mutex_);
+	if (events_.isEmpty()) {
+		return;
+	}
+	TraceEvent &event = events_[nextEvent_];
+	event.name = name;
+	event.category = category;
+	event.startNanoseconds = startNanoseconds;
+	event.durationNanoseconds = durationNanoseconds;
+	event.threadIndex = this->threadIndexOfCurrentThread();
+	nextEvent_++;
+	if (nextEvent_ >= events_.size()) {
+		nextEvent_ = 0;
+		wrapped_ = true;
+	}
+}
+
+void TraceRecorder::addCompletedEvent(const char* name, const char* category, qint64 durationNanoseconds)
+{
+	this->addEvent(name, category, this->now() - durationNanoseconds, durationNanoseconds);
+}
+
+void TraceRecorder::addRealtimeEvent(const char* name, const char* category, qint64 startNanoseconds, qint64 durationNanoseconds)
+{
+	if (!this->isEnabled()) {
+		return;
+	}
+	quint32 written = realtimeEventsWritten_.loadAcquire();
+	RealtimeEvent &event = realtimeEvents_[written % TRACE_RECORDER_REALTIME_CAPACITY];
+	int sequence = event.sequence.loadAcquire();
+	event.sequence.storeRelease(sequence + 1);
+	event.name.storeRelease(name);
+	event.category.storeRelease(category);
+	event.startNanoseconds.storeRelease(startNanoseconds);
+	event.durationNanoseconds.storeRelease(durationNanoseconds);
+	event.sequence.storeRelease(sequence + 2);
+	realtimeEventsWritten_.storeRelease(written + 1);
+}
+
+QJsonObject TraceRecorder::toChromeTraceJson() const
+{
+	// Only the events are copied while the mutex is held, so recording threads do not wait for the serialization
+	QVector<TraceEvent> events;
+	QVector<QString> threadNames;
+	{
+		QMutexLocker locker(&mutex_);
+		int numberOfEvents = wrapped_ ? events_.size() : nextEvent_;
+		int firstEvent = wrapped_ ? nextEvent_ : 0;
+		events.reserve(numberOfEvents);
+		for (int i = 0; i < numberOfEvents; ++i) {
+			events.append(events_.at((firstEvent + i) % events_.size()));
+		}
+		threadNames = threadNames_;
+	}
+
+	// Realtime events are read without stopping the realtime thread. An event it overwrites during the copy is skipped.
+	int realtimeThreadIndex = threadNames.size();
+	quint32 written = realtimeEventsWritten_.loadAcquire();
+	quint32 available = static_cast<quint32>(this->realtimeEventCount());
+	for (quint32 i = written - available; i != written; ++i) {
+		const RealtimeEvent &realtimeEvent = realtimeEvents_[i % TRACE_RECORDER_REALTIME_CAPACITY];
+		int sequenceBefore = realtimeEvent.sequence.loadAcquire();
+		TraceEvent event;
+		event.name = realtimeEvent.name.loadAcquire();
+		event.category = realtimeEvent.category.loadAcquire();
+		event.startNanoseconds = realtimeEvent.startNanoseconds.loadAcquire();
+		event.durationNanoseconds = realtimeEvent.durationNanoseconds.loadAcquire();
+		event.threadIndex = realtimeThreadIndex;
+		if ((sequenceBefore & 1) != 0 || realtimeEvent.sequence.loadAcquire() != sequenceBefore) {
+			continue;
+		}
+		events.append(event);
+	}
+	if (available > 0) {
+		threadNames.append(QStringLiteral("Acquisition"));
+	}
+
+	const qint64 processId = QCoreApplication::applicationPid();
+	QJsonArray traceEvents;
+
+	// Thread names are metadata events
+	for (int i = 0; i < threadNames.size(); ++i) {
+		QJsonObject args;
+		args["name"] = threadNames.at(i);
+		QJsonObject metadata;
+		metadata["name"] = QStringLiteral("thread_name");
+		metadata["ph"] = QStringLiteral("M");
+		metadata["pid"] = processId;
+		metadata["tid"] = i;
+		metadata["args"] = args;
+		traceEvents.append(metadata);
+	}
+
+	// Oldest event of every thread first, timestamps and durations in microseconds
+	for (const TraceEvent &event : events) {
+		QJsonObject json;
+		json["name"] = QString::fromLatin1(event.name);
+		json["cat"] = QString::fromLatin1(event.category);
+		json["ph"] = QStringLiteral("X");
+		json["ts"] = static_cast<double>(event.startNanoseconds) / 1000.0;
+		json["dur"] = static_cast<double>(event.durationNanoseconds) / 1000.0;
+		json["pid"] = processId;
+		json["tid"] = event.threadIndex;
+		traceEvents.append(json);
+	}
+
+	QJsonObject trace;
+	trace["traceEvents"] = traceEvents;
+	trace["displayTimeUnit"] = QStringLiteral("ms");
+	return trace;
+}
+
+bool TraceRecorder::writeChromeTrace(const QString &filePath) const
+{
+	QByteArray json = QJsonDocument(this->toChromeTraceJson()).toJson(QJsonDocument::Compact);
+	QFile file(filePath);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		return false;
+	}
+	return file.write(json) == json.size();
+}
+
+int TraceRecorder::threadIndexOfCurrentThread()
+{
+	// Called with mutex_ locked. Threads keep their index when the recorder is cleared.
+	Qt::HANDLE threadId = QThread::currentThreadId();
+	QHash<Qt::HANDLE, int>::const_iterator it = threadIndices_.constFind(threadId);
+	if (it != threadIndices_.constEnd()) {
+		return it.value();
+	}
+
+	QThread* thread = QThread::currentThread();
+	QString name = thread->objectName();
+	if (QCoreApplication::instance() != nullptr && thread == QCoreApplication::instance()->thread()) {
+		name = QStringLiteral("Main");
+	}
+	int index = threadNames_.size();
+	if (name.isEmpty()) {
+		name = QStringLiteral("Thread %1").arg(index);
+	} else {
+		name += QStringLiteral(" %1").arg(index);
+	}
+	threadNames_.append(name);
+	threadIndices_.insert(threadId, index);
+	return index;
+}
+
+int TraceRecorder::realtimeEventCount() const
+{
+	quint32 count = realtimeEventsWritten_.loadAcquire() - realtimeEventsCleared_.loadAcquire();
+	return static_cast<int>(qMin(count, static_cast<quint32>(TRACE_RECORDER_REALTIME_CAPACITY)));
+}
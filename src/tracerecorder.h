@@ -0,0 +1,123 @@
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QElapsedTimer>
+#include <QJsonObject>
+
+#define TRACE_RECORDER_DEFAULT_CAPACITY 65536
+#define TRACE_RECORDER_REALTIME_CAPACITY 4096 // power of two, so the event counter can wrap around
+
+// Records begin and duration of engine phases, candidate evaluations, worker tasks and GUI updates together with
+// the thread they ran on. Events are kept in a ring buffer, so a long session only keeps the most recent ones.
+// The recorder is shared by all threads of the process and disabled by default; disabled scopes only read a flag.
+// The recorded events can be written as Chrome trace JSON, which can be opened with Perfetto or chrome://tracing.
+// One thread that must never wait or allocate, the acquisition callback, records realtime events into a fixed ring of
+// its own without locking. They are shown as the "Acquisition" thread.
+class TraceRecorder
+{
+public:
+	static TraceRecorder& instance();
+
+	void setEnabled(bool enabled);
+	bool isEnabled() const;
+
+	// Resizes the ring buffer, recorded events are dropped
+	void setCapacity(int numberOfEvents);
+	void clear();
+	int eventCount() const;
+
+	// Nanoseconds since the recorder was created
+	qint64 now() const;
+
+	// name and category need to be string literals (or otherwise outlive the recorder), only the pointers are stored
+	void addEvent(const char* name, const char* category, qint64 startNanoseconds, qint64 durationNanoseconds);
+	// Adds an event that ends now
+	void addCompletedEvent(const char* name, const char* category, qint64 durationNanoseconds);
+	// Lock-free and allocation-free, may only be called from a single thread
+	void addRealtimeEvent(const char* name, const char* category, qint64 startNanoseconds, qint64 durationNanoseconds);
+
+	QJsonObject toChromeTraceJson() const;
+	bool writeChromeTrace(const QString &filePath) const;
+
+private:
+	struct TraceEvent {
+		const char* name;
+		const char* category;
+		qint64 startNanoseconds;
+		qint64 durationNanoseconds;
+		int threadIndex;
+	};
+
+	// Written by the realtime thread while the trace may be read, so every field is atomic. The sequence number is odd
+	// while the event is written and changes with every write, a reader that sees it change skips the event.
+	struct RealtimeEvent {
+		QAtomicInt sequence;
+		QAtomicPointer<const char> name;
+		QAtomicPointer<const char> category;
+		QAtomicInteger<qint64> startNanoseconds;
+		QAtomicInteger<qint64> durationNanoseconds;
+	};
+
+	TraceRecorder();
+	TraceRecorder(const TraceRecorder&) = delete;
+	TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+	int threadIndexOfCurrentThread();
+	int realtimeEventCount() const;
+
+	QAtomicInt enabled_;
+	QElapsedTimer clock_;
+	mutable QMutex mutex_;
+	QVector<TraceEvent> events_;
+	int capacity_;
+	int nextEvent_;
+	bool wrapped_;
+	QHash<Qt::HANDLE, int> threadIndices_;
+	QVector<QString> threadNames_;
+	RealtimeEvent realtimeEvents_[TRACE_RECORDER_REALTIME_CAPACITY];
+	QAtomicInteger<quint32> realtimeEventsWritten_;
+	QAtomicInteger<quint32> realtimeEventsCleared_; // events written before the last clear()
+};
+
+// Adds an event for its own lifetime to the trace, e.g. TraceScope trace("candidate", "evaluation"); Scopes on the
+// acquisition thread pass realtime = true.
+class TraceScope
+{
+public:
+	TraceScope(const char* name, const char* category, bool realtime = false)
+		: name_(name), category_(category), start_(-1), realtime_(realtime) {
+		TraceRecorder &recorder = TraceRecorder::instance();
+		if (recorder.isEnabled()) {
+			start_ = recorder.now();
+		}
+	}
+
+	~TraceScope() {
+		if (start_ >= 0) {
+			TraceRecorder &recorder = TraceRecorder::instance();
+			if (realtime_) {
+				recorder.addRealtimeEvent(name_, category_, start_, recorder.now() - start_);
+			} else {
+				recorder.addEvent(name_, category_, start_, recorder.now() - start_);
+			}
+		}
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	const char* name_;
+	const char* category_;
+	qint64 start_;
+	bool realtime_;
+};
+
+#endif // TRACERECORDER_H
@@ -0,0 +1,76 @@
+#include "estimatorparameterfile.h"
+#include <QSettings>
+
+DispersionEstimatorParameters EstimatorParameterFile::load(const QString &filePath)
+{
+	// OCTproZ stores the plugin settings in a group named after the extension
+	QSettings settings(filePath, QSettings::IniFormat);
+	if (settings.childGroups().contains("Dispersion Estimator")) {
+		settings.beginGroup("Dispersion Estimator");
+	}
+
+	DispersionEstimatorParameters params;
+	params.bufferSource = RAW;
+	params.frameNr = 0;
+	params.bufferNr = 0;
+	params.numberOfCenterAscans = settings.value(DISPERSION_ESTIMATOR_NUMBER_OF_CENTER_ASCANS, 20).toInt();
+	params.ascanSelection = static_cast<ASCAN_SELECTION>(settings.value(DISPERSION_ESTIMATOR_ASCAN_SELECTION, 0).toInt());
+	params.numberOfPooledFrames = settings.value(DISPERSION_ESTIMATOR_NUMBER_OF_POOLED_FRAMES, 1).toInt();
+	params.useLinearAscans = settings.value(DISPERSION_ESTIMATOR_USE_LINEAR_ASCANS, true).toBool();
+	params.numberOfAscanSamplesToIgnore = settings.value(DISPERSION_ESTIMATOR_NUMBER_OF_ASCAN_SAMPLES_TO_IGNORE, 30).toInt();
+	params.autoCalcD1 = settings.value(DISPERSION_ESTIMATOR_AUTO_CALC_D1, false).toBool();
+	params.sharpnessMetric = static_cast<ASCAN_SHARPNESS_METRIC>(settings.value(DISPERSION_ESTIMATOR_SHARPNESS_METRIC, 2).toInt());
+	params.metricThreshold = settings.value(DISPERSION_ESTIMATOR_METRIC_THRESHOLD, 0.7).toReal();
+	params.d2start = settings.value(DISPERSION_ESTIMATOR_D2_START, -50.0).toReal();
+	params.d2end = settings.value(DISPERSION_ESTIMATOR_D2_END, 50.0).toReal();
+	params.d3start = settings.value(DISPERSION_ESTIMATOR_D3_START, -50.0).toReal();
+	params.d3end = settings.value(DISPERSION_ESTIMATOR_D3_END, 50.0).toReal();
+	params.d4start = settings.value(DISPERSION_ESTIMATOR_D4_START, -50.0).toReal();
+	params.d4end = settings.value(DISPERSION_ESTIMATOR_D4_END, 50.0).toReal();
+	params.d5start = settings.value(DISPERSION_ESTIMATOR_D5_START, -50.0).toReal();
+	params.d5end = settings.value(DISPERSION_ESTIMATOR_D5_END, 50.0).toReal();
+	params.highestDispersionOrder = settings.value(DISPERSION_ESTIMATOR_HIGHEST_DISPERSION_ORDER, 3).toInt();
+	params.numberOfDispersionSamples = settings.value(DISPERSION_ESTIMATOR_NUMBER_OF_DISPERSION_SAMPLES, 100).toInt();
+	params.estimationStrategy = static_cast<ESTIMATION_STRATEGY>(settings.value(DISPERSION_ESTIMATOR_ESTIMATION_STRATEGY, 0).toInt());
+	params.peakFitting = settings.value(DISPERSION_ESTIMATOR_PEAK_FITTING, false).toBool();
+	params.parallelEvaluation = true;
+	params.numberOfThreads = settings.value(DISPERSION_ESTIMATOR_NUMBER_OF_THREADS, 0).toInt();
+	params.metricCache = settings.value(DISPERSION_ESTIMATOR_METRIC_CACHE, true).toBool();
+	params.liveTrackingNthBuffer = 1;
+	params.frameDropPolicy = DROP_OLDEST_FRAME;
+	params.tracing = false;
+	params.hardwareCounters = false;
+	params.guiVisible = false;
+	params.performancePanelVisible = false;
+	return params;
+}
+
+QMap<QString, ESTIMATION_STRATEGY> EstimatorParameterFile::strategyNames()
+{
+	return {
+		{"sweep", SEQUENTIAL_SWEEP},
+		{"nelder-mead", NELDER_MEAD_2D},
+		{"gradient", GRADIENT_LBFGS},
+		{"halving", SUCCESSIVE_HALVING},
+		{"coordinate-descent", COORDINATE_DESCENT}
+	};
+}
+
+QMap<QString, ASCAN_SHARPNESS_METRIC> EstimatorParameterFile::metricNames()
+{
+	return {
+		{"sum-above-threshold", SUM_ABOVE_THRESHOLD},
+		{"samples-above-threshold", SAMPLES_ABOVE_THRESHOLD},
+		{"peak-value", PEAK_VALUE},
+		{"mean-sobel", MEAN_SOBEL},
+		{"squared-intensity", SUM_OF_SQUARED_INTENSITY}
+	};
+}
+
+QMap<QString, ASCAN_SELECTION> EstimatorParameterFile::ascanSelectionNames()
+{
+	return {
+		{"center", CENTER_ASCANS},
+		{"best", BEST_ASCANS}
+	};
+}
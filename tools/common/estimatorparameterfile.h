@@ -0,0 +1,22 @@
+#ifndef ESTIMATORPARAMETERFILE_H
+#define ESTIMATORPARAMETERFILE_H
+
+#include <QMap>
+#include <QString>
+#include "dispersionestimatorparameters.h"
+
+// Estimator parameters for the command-line tools. Files use the keys and defaults of the plugin,
+// so the settings of an OCTproZ installation can be used directly.
+class EstimatorParameterFile
+{
+public:
+	// An empty or missing file gives the defaults of the plugin. Candidates are always evaluated in parallel.
+	static DispersionEstimatorParameters load(const QString &filePath);
+
+	// Names for command line options and reports
+	static QMap<QString, ESTIMATION_STRATEGY> strategyNames();
+	static QMap<QString, ASCAN_SHARPNESS_METRIC> metricNames();
+	static QMap<QString, ASCAN_SELECTION> ascanSelectionNames();
+};
+
+#endif // ESTIMATORPARAMETERFILE_H
@@ -0,0 +1,98 @@
+#include "rawvolumereader.h"
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+RawVolumeReader::RawVolumeReader()
+	: bytesPerFrame_(0),
+	numberOfFrames_(0)
+{
+}
+
+RawVolumeReader::~RawVolumeReader()
+{
+	close();
+}
+
+bool RawVolumeReader::open(const QString &filePath, qint64 bytesPerFrame)
+{
+	close();
+	if (bytesPerFrame <= 0) {
+		errorString_ = QStringLiteral("Invalid frame size.");
+		return false;
+	}
+
+	file_.setFileName(filePath);
+	if (!file_.open(QIODevice::ReadOnly)) {
+		errorString_ = file_.errorString();
+		return false;
+	}
+	bytesPerFrame_ = bytesPerFrame;
+	numberOfFrames_ = file_.size() / bytesPerFrame;
+	errorString_.clear();
+	return true;
+}
+
+void RawVolumeReader::close()
+{
+	// Closing the file also releases all of its mappings
+	file_.close();
+	bytesPerFrame_ = 0;
+	numberOfFrames_ = 0;
+}
+
+QString RawVolumeReader::errorString() const
+{
+	return errorString_;
+}
+
+qint64 RawVolumeReader::getNumberOfFrames() const
+{
+	return numberOfFrames_;
+}
+
+qint64 RawVolumeReader::getBytesPerFrame() const
+{
+	return bytesPerFrame_;
+}
+
+const uchar* RawVolumeReader::mapFrames(qint64 firstFrame, qint64 count)
+{
+	if (firstFrame < 0 || count <= 0 || firstFrame + count > numberOfFrames_) {
+		errorString_ = QStringLiteral("File contains only %1 frames.").arg(numberOfFrames_);
+		return nullptr;
+	}
+
+	qint64 size = count * bytesPerFrame_;
+	uchar *data = file_.map(firstFrame * bytesPerFrame_, size);
+	if (data == nullptr) {
+		errorString_ = file_.errorString();
+		return nullptr;
+	}
+	adviseSequentialRead(data, size);
+	return data;
+}
+
+void RawVolumeReader::unmapFrames(const uchar *frames)
+{
+	if (frames != nullptr) {
+		file_.unmap(const_cast<uchar*>(frames));
+	}
+}
+
+void RawVolumeReader::adviseSequentialRead(const uchar *data, qint64 size)
+{
+#ifdef Q_OS_UNIX
+	// madvise needs a page aligned address. The mapping itself starts at a page boundary, so the page that contains data is part of it.
+	quintptr pageSize = static_cast<quintptr>(sysconf(_SC_PAGESIZE));
+	quintptr address = reinterpret_cast<quintptr>(data);
+	quintptr alignedAddress = address & ~(pageSize - 1);
+	size_t length = static_cast<size_t>(size) + static_cast<size_t>(address - alignedAddress);
+	madvise(reinterpret_cast<void*>(alignedAddress), length, MADV_SEQUENTIAL);
+	madvise(reinterpret_cast<void*>(alignedAddress), length, MADV_WILLNEED);
+#else
+	Q_UNUSED(data)
+	Q_UNUSED(size)
+#endif
+}
@@ -0,0 +1,37 @@
+#ifndef RAWVOLUMEREADER_H
+#define RAWVOLUMEREADER_H
+
+#include <QFile>
+#include <QString>
+
+// Gives access to frames of a raw recording through memory mapping, so volumes that are much larger
+// than the available memory can be processed. Only the mapped frames are resident; every mapping
+// should be released with unmapFrames() once its frames are processed.
+class RawVolumeReader
+{
+public:
+	RawVolumeReader();
+	~RawVolumeReader();
+
+	bool open(const QString &filePath, qint64 bytesPerFrame);
+	void close();
+	QString errorString() const;
+
+	qint64 getNumberOfFrames() const;
+	qint64 getBytesPerFrame() const;
+
+	// Maps count consecutive frames starting at firstFrame and hints the kernel to read them ahead
+	// sequentially. Returns nullptr on failure. The memory is read-only.
+	const uchar* mapFrames(qint64 firstFrame, qint64 count);
+	void unmapFrames(const uchar *frames);
+
+private:
+	QFile file_;
+	qint64 bytesPerFrame_;
+	qint64 numberOfFrames_;
+	QString errorString_;
+
+	void adviseSequentialRead(const uchar *data, qint64 size);
+};
+
+#endif // RAWVOLUMEREADER_H
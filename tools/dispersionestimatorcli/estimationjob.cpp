@@ -0,0 +1,192 @@
+#include "estimationjob.h"
+#include <QFile>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTextStream>
+#include <QtMath>
+
+EstimationJob::EstimationJob(QObject *parent)
+	: QObject(parent),
+	estimationFinished(false)
+{
+	// The engine is called directly, possibly from a worker thread. Direct connections deliver all signals synchronously while run() is executing.
+	connect(&this->engine, &DispersionEstimationEngine::metricValuesCalculatedD2, this, [this](QVector<QPointF> points) {
+		this->currentResult.landscapeD2.append(points);
+	}, Qt::DirectConnection);
+	connect(&this->engine, &DispersionEstimationEngine::metricValuesCalculatedD3, this, [this](QVector<QPointF> points) {
+		this->currentResult.landscapeD3.append(points);
+	}, Qt::DirectConnection);
+	connect(&this->engine, &DispersionEstimationEngine::d1Calculated, this, [this](double d1) {
+		this->currentResult.hasD1 = true;
+		this->currentResult.d1 = d1;
+	}, Qt::DirectConnection);
+	connect(&this->engine, &DispersionEstimationEngine::bestD2Estimated, this, [this](double d2) {
+		this->currentResult.d2 = d2;
+		this->estimationFinished = true;
+	}, Qt::DirectConnection);
+	connect(&this->engine, &DispersionEstimationEngine::bestD3Estimated, this, [this](double d3) {
+		this->currentResult.d3 = d3;
+	}, Qt::DirectConnection);
+	connect(&this->engine, &DispersionEstimationEngine::higherOrderCoefficientsEstimated, this, [this](QVector<double> coefficients) {
+		this->currentResult.higherOrderCoefficients = coefficients;
+	}, Qt::DirectConnection);
+	connect(&this->engine, &DispersionEstimationEngine::runReportReady, this, [this](EstimationRunReport report) {
+		this->currentResult.runReport = report.toJson();
+	}, Qt::DirectConnection);
+	connect(&this->engine, &DispersionEstimationEngine::info, this, [this](QString message) {
+		this->currentResult.messages.append(message);
+	}, Qt::DirectConnection);
+	connect(&this->engine, &DispersionEstimationEngine::error, this, [this](QString message) {
+		this->currentResult.messages.append(message);
+		if (this->currentResult.errorMessage.isEmpty()) {
+			this->currentResult.errorMessage = message;
+		}
+	}, Qt::DirectConnection);
+}
+
+void EstimationJob::setSettingsFilePaths(const QString &settingsFilePath, const QString &resamplingCurveFilePath) {
+	this->engine.setSettingsFilePaths(settingsFilePath, resamplingCurveFilePath);
+}
+
+void EstimationJob::setParameters(const DispersionEstimatorParameters &params) {
+	this->params = params;
+	this->engine.setParams(params);
+}
+
+EstimationResult EstimationJob::run(const EstimationInput &input) {
+	QElapsedTimer timer;
+	timer.start();
+	size_t bytesPerSample = static_cast<size_t>(qCeil(static_cast<double>(input.bitDepth) / 8.0));
+	qint64 bytesPerFrame = static_cast<qint64>(input.samplesPerLine) * input.linesPerFrame * static_cast<qint64>(bytesPerSample);
+
+	// The frames are mapped instead of read, the engine only copies the A-scans it evaluates
+	RawVolumeReader reader;
+	const uchar *frames = nullptr;
+	if (reader.open(input.rawFilePath, bytesPerFrame)) {
+		frames = reader.mapFrames(input.firstFrame, input.numberOfFrames);
+	}
+	if (frames == nullptr) {
+		EstimationResult result;
+		result.errorMessage = tr("Could not load frames: ") + reader.errorString();
+		return result;
+	}
+	qint64 loadTimeMs = timer.elapsed();
+
+	EstimationResult result = this->runOnFrames(frames, input);
+	result.loadTimeMs = loadTimeMs;
+	reader.unmapFrames(frames);
+	return result;
+}
+
+EstimationResult EstimationJob::runOnFrames(const uchar *frames, const EstimationInput &input) {
+	this->currentResult = EstimationResult();
+	this->estimationFinished = false;
+
+	if (input.samplesPerLine == 0 || input.linesPerFrame == 0 || input.numberOfFrames == 0) {
+		this->currentResult.errorMessage = tr("Invalid frame dimensions.");
+		return this->currentResult;
+	}
+
+	// The engine only reads from the frame buffer
+	QElapsedTimer timer;
+	timer.start();
+	this->engine.startDispersionEstimation(const_cast<uchar*>(frames), input.bitDepth, input.samplesPerLine, input.linesPerFrame, input.numberOfFrames);
+	this->currentResult.estimationTimeMs = timer.elapsed();
+
+	this->currentResult.success = this->estimationFinished;
+	if (!this->currentResult.success && this->currentResult.errorMessage.isEmpty()) {
+		this->currentResult.errorMessage = tr("Estimation did not finish.");
+	}
+	return this->currentResult;
+}
+
+QJsonObject EstimationJob::toJson(const EstimationInput &input, const EstimationResult &result, const DispersionEstimatorParameters &params) {
+	QJsonObject json;
+	json["file"] = input.rawFilePath;
+	json["bit_depth"] = static_cast<int>(input.bitDepth);
+	json["samples_per_line"] = static_cast<int>(input.samplesPerLine);
+	json["lines_per_frame"] = static_cast<int>(input.linesPerFrame);
+	json["first_frame"] = static_cast<int>(input.firstFrame);
+	json["number_of_frames"] = static_cast<int>(input.numberOfFrames);
+
+	QJsonObject parameters;
+	parameters[DISPERSION_ESTIMATOR_ESTIMATION_STRATEGY] = static_cast<int>(params.estimationStrategy);
+	parameters[DISPERSION_ESTIMATOR_SHARPNESS_METRIC] = static_cast<int>(params.sharpnessMetric);
+	parameters[DISPERSION_ESTIMATOR_METRIC_THRESHOLD] = params.metricThreshold;
+	parameters[DISPERSION_ESTIMATOR_NUMBER_OF_CENTER_ASCANS] = params.numberOfCenterAscans;
+	parameters[DISPERSION_ESTIMATOR_ASCAN_SELECTION] = static_cast<int>(params.ascanSelection);
+	parameters[DISPERSION_ESTIMATOR_NUMBER_OF_DISPERSION_SAMPLES] = params.numberOfDispersionSamples;
+	parameters[DISPERSION_ESTIMATOR_D2_START] = params.d2start;
+	parameters[DISPERSION_ESTIMATOR_D2_END] = params.d2end;
+	parameters[DISPERSION_ESTIMATOR_D3_START] = params.d3start;
+	parameters[DISPERSION_ESTIMATOR_D3_END] = params.d3end;
+	parameters[DISPERSION_ESTIMATOR_HIGHEST_DISPERSION_ORDER] = params.highestDispersionOrder;
+	parameters[DISPERSION_ESTIMATOR_PEAK_FITTING] = params.peakFitting;
+	parameters[DISPERSION_ESTIMATOR_NUMBER_OF_THREADS] = params.numberOfThreads;
+	json["parameters"] = parameters;
+
+	json["success"] = result.success;
+	if (!result.errorMessage.isEmpty()) {
+		json["error"] = result.errorMessage;
+	}
+	if (result.success) {
+		if (result.hasD1) {
+			json["d1"] = result.d1;
+		}
+		json["d2"] = result.d2;
+		json["d3"] = result.d3;
+		for (int i = 0; i < result.higherOrderCoefficients.size(); i++) {
+			json[QString("d%1").arg(i + 4)] = result.higherOrderCoefficients.at(i);
+		}
+	}
+
+	QJsonObject timing;
+	timing["load_ms"] = result.loadTimeMs;
+	timing["estimation_ms"] = result.estimationTimeMs;
+	json["timing"] = timing;
+	if (!result.runReport.isEmpty()) {
+		json["run_report"] = result.runReport;
+	}
+
+	QJsonObject landscape;
+	QJsonArray landscapeD2;
+	for (const QPointF &point : result.landscapeD2) {
+		landscapeD2.append(QJsonArray{point.x(), point.y()});
+	}
+	QJsonArray landscapeD3;
+	for (const QPointF &point : result.landscapeD3) {
+		landscapeD3.append(QJsonArray{point.x(), point.y()});
+	}
+	landscape["d2"] = landscapeD2;
+	landscape["d3"] = landscapeD3;
+	json["landscape"] = landscape;
+
+	json["messages"] = QJsonArray::fromStringList(result.messages);
+	return json;
+}
+
+bool EstimationJob::writeJson(const QString &filePath, const QJsonObject &json) {
+	QFile file(filePath);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		return false;
+	}
+	return file.write(QJsonDocument(json).toJson(QJsonDocument::Indented)) >= 0;
+}
+
+bool EstimationJob::writeLandscapeCsv(const QString &filePath, const EstimationResult &result) {
+	QFile file(filePath);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+		return false;
+	}
+	QTextStream stream(&file);
+	stream.setRealNumberPrecision(10);
+	stream << "coefficient,value,metric\n";
+	for (const QPointF &point : result.landscapeD2) {
+		stream << "d2," << point.x() << "," << point.y() << "\n";
+	}
+	for (const QPointF &point : result.landscapeD3) {
+		stream << "d3," << point.x() << "," << point.y() << "\n";
+	}
+	return stream.status() == QTextStream::Ok;
+}
@@ -0,0 +1,65 @@
+#ifndef ESTIMATIONJOB_H
+#define ESTIMATIONJOB_H
+
+#include <QObject>
+#include <QVector>
+#include <QPointF>
+#include <QStringList>
+#include <QJsonObject>
+#include "dispersionestimatorparameters.h"
+#include "dispersionestimationengine.h"
+#include "rawvolumereader.h"
+
+struct EstimationInput {
+	QString rawFilePath;
+	unsigned int bitDepth;
+	unsigned int samplesPerLine;
+	unsigned int linesPerFrame;
+	unsigned int firstFrame;
+	unsigned int numberOfFrames;
+};
+
+struct EstimationResult {
+	bool success = false;
+	QString errorMessage;
+	bool hasD1 = false;
+	double d1 = 0.0;
+	double d2 = 0.0;
+	double d3 = 0.0;
+	QVector<double> higherOrderCoefficients; // d4, d5, ...
+	QVector<QPointF> landscapeD2;
+	QVector<QPointF> landscapeD3;
+	QStringList messages;
+	qint64 loadTimeMs = 0;
+	qint64 estimationTimeMs = 0;
+	QJsonObject runReport; // per-phase and per-stage timing of the engine, empty if the estimation did not finish
+};
+
+// Runs the dispersion estimation engine without GUI on frames of a recorded raw file
+// and collects everything the engine reports into an EstimationResult.
+class EstimationJob : public QObject
+{
+	Q_OBJECT
+public:
+	explicit EstimationJob(QObject *parent = nullptr);
+
+	void setSettingsFilePaths(const QString &settingsFilePath, const QString &resamplingCurveFilePath);
+	void setParameters(const DispersionEstimatorParameters &params);
+
+	// Maps the frames of input from the raw file and estimates the dispersion coefficients
+	EstimationResult run(const EstimationInput &input);
+	// Estimates on frames that are already in memory, frames points to input.numberOfFrames consecutive frames
+	EstimationResult runOnFrames(const uchar *frames, const EstimationInput &input);
+
+	static QJsonObject toJson(const EstimationInput &input, const EstimationResult &result, const DispersionEstimatorParameters &params);
+	static bool writeJson(const QString &filePath, const QJsonObject &json);
+	static bool writeLandscapeCsv(const QString &filePath, const EstimationResult &result);
+
+private:
+	DispersionEstimationEngine engine;
+	DispersionEstimatorParameters params;
+	EstimationResult currentResult;
+	bool estimationFinished;
+};
+
+#endif // ESTIMATIONJOB_H
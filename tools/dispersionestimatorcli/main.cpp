@@ -0,0 +1,297 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QSettings>
+#include <QFileInfo>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QMap>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include "estimationjob.h"
+#include "volumeestimation.h"
+#include "estimatorparameterfile.h"
+#include "tracerecorder.h"
+
+// Estimates dispersion coefficients of recorded raw files without GUI and without a running OCTproZ.
+// For every input file a JSON result (coefficients, metric landscapes, timing) and a CSV file with the
+// metric landscapes are written, a summary of all files is written to summary.csv.
+// In volume mode every block of frames of a file is estimated, the results of all blocks and their
+// statistics (mean, spread, outliers) are written instead.
+
+namespace {
+
+bool parseRange(const QString &text, qreal &start, qreal &end) {
+	QStringList values = text.split(':');
+	if (values.size() != 2) {
+		return false;
+	}
+	bool startOk = false;
+	bool endOk = false;
+	qreal parsedStart = values.at(0).toDouble(&startOk);
+	qreal parsedEnd = values.at(1).toDouble(&endOk);
+	if (!startOk || !endOk) {
+		return false;
+	}
+	start = parsedStart;
+	end = parsedEnd;
+	return true;
+}
+
+bool parseUnsigned(const QCommandLineParser &parser, const QString &name, unsigned int &value) {
+	if (!parser.isSet(name)) {
+		return true;
+	}
+	bool ok = false;
+	value = parser.value(name).toUInt(&ok);
+	return ok;
+}
+
+// Output files are named after the input file. The directory name is added if files from different directories share a name.
+QString outputBaseName(const QString &inputFilePath, const QDir &outputDir, const QString &suffix) {
+	QFileInfo inputInfo(inputFilePath);
+	QString baseName = inputInfo.completeBaseName();
+	if (QFileInfo::exists(outputDir.filePath(baseName + suffix))) {
+		baseName = inputInfo.dir().dirName() + "_" + baseName;
+	}
+	return baseName;
+}
+
+int runVolumeEstimation(const QStringList &files, EstimationInput input, const DispersionEstimatorParameters &params,
+                        const QString &settingsFilePath, const QString &resamplingCurveFilePath,
+                        int stride, int jobs, int chunkFrames, const QDir &outputDir, QTextStream &summary) {
+	QTextStream err(stderr);
+	VolumeEstimation volumeEstimation(settingsFilePath, resamplingCurveFilePath, params, jobs);
+	volumeEstimation.setFramesPerChunk(chunkFrames);
+
+	summary << "file,blocks,failed_blocks,outliers,d2_mean,d2_standard_deviation,d2_median,d3_mean,d3_standard_deviation,d3_median,time_ms,error\n";
+	int failedFiles = 0;
+	for (int i = 0; i < files.size(); i++) {
+		input.rawFilePath = files.at(i);
+		err << "[" << (i + 1) << "/" << files.size() << "] " << input.rawFilePath << "\n";
+		err.flush();
+
+		QElapsedTimer timer;
+		timer.start();
+		QVector<BlockResult> results;
+		QString errorMessage;
+		bool success = volumeEstimation.run(input, stride, results, errorMessage);
+		qint64 timeMs = timer.elapsed();
+
+		QJsonObject json = VolumeEstimation::toJson(input, results, timeMs);
+		int failedBlocks = json["failed_blocks"].toInt();
+		if (!success || failedBlocks == results.size()) {
+			failedFiles++;
+			err << "  failed: " << (errorMessage.isEmpty() ? QString("no block could be estimated") : errorMessage) << "\n";
+		} else {
+			err << "  " << results.size() << " blocks, " << failedBlocks << " failed, " << json["outliers"].toArray().size() << " outliers (" << timeMs << " ms)\n";
+		}
+
+		QString baseName = outputBaseName(input.rawFilePath, outputDir, "_volume.json");
+		if (success) {
+			EstimationJob::writeJson(outputDir.filePath(baseName + "_volume.json"), json);
+			VolumeEstimation::writeBlocksCsv(outputDir.filePath(baseName + "_blocks.csv"), results);
+		}
+
+		QJsonObject d2 = json["d2"].toObject();
+		QJsonObject d3 = json["d3"].toObject();
+		errorMessage.replace('"', "\"\"");
+		summary << "\"" << input.rawFilePath << "\"," << results.size() << "," << failedBlocks << "," << json["outliers"].toArray().size() << ","
+				<< d2["mean"].toDouble() << "," << d2["standard_deviation"].toDouble() << "," << d2["median"].toDouble() << ","
+				<< d3["mean"].toDouble() << "," << d3["standard_deviation"].toDouble() << "," << d3["median"].toDouble() << ","
+				<< timeMs << ",\"" << errorMessage << "\"\n";
+		summary.flush();
+	}
+
+	err << (files.size() - failedFiles) << " of " << files.size() << " files processed successfully.\n";
+	return failedFiles > 0 ? 1 : 0;
+}
+
+}
+
+void writeTrace(const QCommandLineParser &parser, QTextStream &err) {
+	if (!parser.isSet("trace")) {
+		return;
+	}
+	if (!TraceRecorder::instance().writeChromeTrace(parser.value("trace"))) {
+		err << "Could not write trace file: " << parser.value("trace") << "\n";
+	}
+}
+
+int main(int argc, char *argv[]) {
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("dispersionestimatorcli");
+
+	const QMap<QString, ESTIMATION_STRATEGY> strategies = EstimatorParameterFile::strategyNames();
+	const QMap<QString, ASCAN_SHARPNESS_METRIC> metrics = EstimatorParameterFile::metricNames();
+	const QMap<QString, ASCAN_SELECTION> ascanSelections = EstimatorParameterFile::ascanSelectionNames();
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Estimates dispersion coefficients of recorded OCT raw files.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("files", "Raw files to process.", "<file>...");
+	parser.addOptions({
+		{"settings", "OCTproZ settings file with the processing settings. Defaults to the settings of the local OCTproZ installation.", "settings.ini"},
+		{"resampling-curve", "Custom resampling curve, used if custom resampling is enabled in the settings file.", "curve.csv"},
+		{"params", "Estimator parameters, keys as stored by the plugin.", "params.ini"},
+		{"width", "Samples per A-scan. Defaults to the value in the settings file.", "samples"},
+		{"height", "A-scans per frame. Defaults to the value in the settings file.", "lines"},
+		{"bit-depth", "Bit depth of the raw data. Defaults to the value in the settings file.", "bits"},
+		{"frame", "First frame that is used for the estimation.", "index", "0"},
+		{"frames", "Number of consecutive frames whose A-scans are pooled.", "count"},
+		{"strategy", "Estimation strategy: " + QStringList(strategies.keys()).join(", ") + ".", "name"},
+		{"metric", "A-scan sharpness metric: " + QStringList(metrics.keys()).join(", ") + ".", "name"},
+		{"d2", "Sample range for d2.", "start:end"},
+		{"d3", "Sample range for d3.", "start:end"},
+		{"samples", "Number of dispersion samples.", "count"},
+		{"center-ascans", "Number of A-scans per frame.", "count"},
+		{"ascans", "Which A-scans of every frame are used: " + QStringList(ascanSelections.keys()).join(", ") + ". best takes the A-scans with the strongest unsaturated fringe signal.", "name"},
+		{"threads", "Number of worker threads, 0 uses one thread per logical core.", "count"},
+		{"volume", "Estimate for every block of frames from --frame to the end of the file and write per-volume statistics. --frames sets the block size."},
+		{"stride", "Volume mode: use every n-th block.", "n", "1"},
+		{"jobs", "Volume mode: number of blocks that are estimated in parallel, 0 uses one per logical core.", "count", "0"},
+		{"chunk-frames", "Volume mode: number of frames that are mapped into memory at once.", "count", "64"},
+		{"hardware-counters", "Read CPU performance counters around every processing stage and add IPC and misses per sample to the run report (Linux only)."},
+		{"trace", "Record engine phases, candidate evaluations and worker tasks of all estimations and write them as Chrome trace JSON.", "trace.json"},
+		{"output", "Output directory.", "directory", "."}
+	});
+	parser.process(app);
+
+	QTextStream err(stderr);
+	QStringList files = parser.positionalArguments();
+	if (files.isEmpty()) {
+		err << "No input files given.\n";
+		parser.showHelp(2);
+	}
+
+	// Processing settings
+	QString settingsFilePath = parser.isSet("settings") ? parser.value("settings") : QString(SETTINGS_PATH);
+	QString resamplingCurveFilePath = parser.isSet("resampling-curve") ? parser.value("resampling-curve") : QString(SETTINGS_PATH_RESAMPLING_FILE);
+	if (!QFileInfo::exists(settingsFilePath)) {
+		err << "Settings file does not exist: " << settingsFilePath << "\n";
+		return 2;
+	}
+
+	// Frame dimensions default to the values OCTproZ used for the recording
+	QSettings settingsFile(settingsFilePath, QSettings::IniFormat);
+	settingsFile.beginGroup("Virtual OCT System");
+	EstimationInput input;
+	input.bitDepth = settingsFile.value("bit_depth", 12).toUInt();
+	input.samplesPerLine = settingsFile.value("width", 1024).toUInt();
+	input.linesPerFrame = settingsFile.value("height", 512).toUInt();
+	settingsFile.endGroup();
+	input.firstFrame = 0;
+
+	// Estimator parameters, command line options override the parameter file
+	DispersionEstimatorParameters params = EstimatorParameterFile::load(parser.value("params"));
+	input.numberOfFrames = static_cast<unsigned int>(qMax(1, params.numberOfPooledFrames));
+	unsigned int samples = static_cast<unsigned int>(params.numberOfDispersionSamples);
+	unsigned int centerAscans = static_cast<unsigned int>(params.numberOfCenterAscans);
+	unsigned int threads = static_cast<unsigned int>(qMax(0, params.numberOfThreads));
+	unsigned int stride = 1;
+	unsigned int jobs = 0;
+	unsigned int chunkFrames = 64;
+	bool ok = parseUnsigned(parser, "width", input.samplesPerLine)
+			&& parseUnsigned(parser, "height", input.linesPerFrame)
+			&& parseUnsigned(parser, "bit-depth", input.bitDepth)
+			&& parseUnsigned(parser, "frame", input.firstFrame)
+			&& parseUnsigned(parser, "frames", input.numberOfFrames)
+			&& parseUnsigned(parser, "samples", samples)
+			&& parseUnsigned(parser, "center-ascans", centerAscans)
+			&& parseUnsigned(parser, "threads", threads)
+			&& parseUnsigned(parser, "stride", stride)
+			&& parseUnsigned(parser, "jobs", jobs)
+			&& parseUnsigned(parser, "chunk-frames", chunkFrames);
+	if (parser.isSet("d2")) {
+		ok = ok && parseRange(parser.value("d2"), params.d2start, params.d2end);
+	}
+	if (parser.isSet("d3")) {
+		ok = ok && parseRange(parser.value("d3"), params.d3start, params.d3end);
+	}
+	if (parser.isSet("strategy")) {
+		ok = ok && strategies.contains(parser.value("strategy"));
+		params.estimationStrategy = strategies.value(parser.value("strategy"));
+	}
+	if (parser.isSet("metric")) {
+		ok = ok && metrics.contains(parser.value("metric"));
+		params.sharpnessMetric = metrics.value(parser.value("metric"));
+	}
+	if (parser.isSet("ascans")) {
+		ok = ok && ascanSelections.contains(parser.value("ascans"));
+		params.ascanSelection = ascanSelections.value(parser.value("ascans"));
+	}
+	if (!ok) {
+		err << "Invalid command line option.\n";
+		parser.showHelp(2);
+	}
+	params.numberOfDispersionSamples = static_cast<int>(samples);
+	params.numberOfCenterAscans = static_cast<int>(centerAscans);
+	params.numberOfThreads = static_cast<int>(threads);
+	params.numberOfPooledFrames = static_cast<int>(input.numberOfFrames);
+	params.hardwareCounters = parser.isSet("hardware-counters");
+
+	QDir outputDir(parser.value("output"));
+	if (!outputDir.mkpath(".")) {
+		err << "Could not create output directory: " << outputDir.path() << "\n";
+		return 2;
+	}
+
+	QFile summaryFile(outputDir.filePath("summary.csv"));
+	if (!summaryFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+		err << "Could not create summary file: " << summaryFile.fileName() << "\n";
+		return 2;
+	}
+	QTextStream summary(&summaryFile);
+	summary.setRealNumberPrecision(10);
+
+	TraceRecorder::instance().setEnabled(parser.isSet("trace"));
+
+	if (parser.isSet("volume")) {
+		int exitCode = runVolumeEstimation(files, input, params, settingsFilePath, resamplingCurveFilePath, static_cast<int>(qMax(1u, stride)), static_cast<int>(jobs), static_cast<int>(chunkFrames), outputDir, summary);
+		writeTrace(parser, err);
+		return exitCode;
+	}
+
+	EstimationJob job;
+	job.setSettingsFilePaths(settingsFilePath, resamplingCurveFilePath);
+	job.setParameters(params);
+
+	summary << "file,success,d1,d2,d3,d4,d5,load_ms,estimation_ms,error\n";
+	int failedFiles = 0;
+	for (int i = 0; i < files.size(); i++) {
+		input.rawFilePath = files.at(i);
+		err << "[" << (i + 1) << "/" << files.size() << "] " << input.rawFilePath << "\n";
+		err.flush();
+
+		EstimationResult result = job.run(input);
+		if (!result.success) {
+			failedFiles++;
+			err << "  failed: " << result.errorMessage << "\n";
+		} else {
+			err << "  d2: " << result.d2 << "  d3: " << result.d3 << "  (" << result.estimationTimeMs << " ms)\n";
+		}
+
+		QString baseName = outputBaseName(input.rawFilePath, outputDir, ".json");
+		EstimationJob::writeJson(outputDir.filePath(baseName + ".json"), EstimationJob::toJson(input, result, params));
+		EstimationJob::writeLandscapeCsv(outputDir.filePath(baseName + "_landscape.csv"), result);
+
+		QStringList higherOrders;
+		for (int order = 4; order <= MAX_DISPERSION_ORDER; order++) {
+			int index = order - 4;
+			higherOrders.append(index < result.higherOrderCoefficients.size() ? QString::number(result.higherOrderCoefficients.at(index), 'g', 10) : QString());
+		}
+		QString errorMessage = result.errorMessage;
+		errorMessage.replace('"', "\"\"");
+		summary << "\"" << input.rawFilePath << "\"," << (result.success ? 1 : 0) << ","
+				<< (result.success && result.hasD1 ? QString::number(result.d1, 'g', 10) : QString()) << ","
+				<< (result.success ? QString::number(result.d2, 'g', 10) : QString()) << ","
+				<< (result.success ? QString::number(result.d3, 'g', 10) : QString()) << ","
+				<< higherOrders.join(",") << ","
+				<< result.loadTimeMs << "," << result.estimationTimeMs << ",\"" << errorMessage << "\"\n";
+		summary.flush();
+	}
+
+	err << (files.size() - failedFiles) << " of " << files.size() << " files processed successfully.\n";
+	writeTrace(parser, err);
+	return failedFiles > 0 ? 1 : 0;
+}
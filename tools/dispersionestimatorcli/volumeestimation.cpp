@@ -0,0 +1,262 @@
+#include "volumeestimation.h"
+#include <QFile>
+#include <QFuture>
+#include <QJsonArray>
+#include <QTextStream>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtMath>
+#include <algorithm>
+
+// Scale factor that makes the median absolute deviation comparable to the standard deviation of normally distributed values
+#define MAD_TO_STANDARD_DEVIATION 1.4826
+#define OUTLIER_THRESHOLD 3.0
+
+VolumeEstimation::VolumeEstimation(const QString &settingsFilePath, const QString &resamplingCurveFilePath, const DispersionEstimatorParameters &params, int numberOfJobs)
+	: framesPerChunk_(64)
+{
+	// Blocks are processed in parallel, so every job evaluates its candidates in its own thread only
+	DispersionEstimatorParameters jobParams = params;
+	jobParams.parallelEvaluation = false;
+
+	int jobCount = numberOfJobs > 0 ? numberOfJobs : QThread::idealThreadCount();
+	jobCount = qMax(1, jobCount);
+	for (int i = 0; i < jobCount; i++) {
+		EstimationJob *job = new EstimationJob();
+		job->setSettingsFilePaths(settingsFilePath, resamplingCurveFilePath);
+		job->setParameters(jobParams);
+		jobs_.append(job);
+	}
+	threadPool_.setMaxThreadCount(jobCount);
+}
+
+VolumeEstimation::~VolumeEstimation()
+{
+	threadPool_.waitForDone();
+	qDeleteAll(jobs_);
+}
+
+void VolumeEstimation::setFramesPerChunk(int framesPerChunk)
+{
+	framesPerChunk_ = qMax(1, framesPerChunk);
+}
+
+bool VolumeEstimation::run(const EstimationInput &input, int blockStride, QVector<BlockResult> &results, QString &errorMessage)
+{
+	results.clear();
+	size_t bytesPerSample = static_cast<size_t>(qCeil(static_cast<double>(input.bitDepth) / 8.0));
+	qint64 bytesPerFrame = static_cast<qint64>(input.samplesPerLine) * input.linesPerFrame * static_cast<qint64>(bytesPerSample);
+	RawVolumeReader reader;
+	if (input.numberOfFrames == 0 || !reader.open(input.rawFilePath, bytesPerFrame)) {
+		errorMessage = input.numberOfFrames == 0 ? QStringLiteral("Invalid block size.") : reader.errorString();
+		return false;
+	}
+
+	// Blocks of the volume
+	qint64 framesPerBlock = input.numberOfFrames;
+	qint64 blockDistance = framesPerBlock * qMax(1, blockStride);
+	for (qint64 firstFrame = input.firstFrame; firstFrame + framesPerBlock <= reader.getNumberOfFrames(); firstFrame += blockDistance) {
+		BlockResult block;
+		block.firstFrame = static_cast<unsigned int>(firstFrame);
+		block.numberOfFrames = static_cast<unsigned int>(framesPerBlock);
+		results.append(block);
+	}
+	if (results.isEmpty()) {
+		errorMessage = QStringLiteral("File contains only %1 frames.").arg(reader.getNumberOfFrames());
+		return false;
+	}
+
+	// Chunks contain whole blocks and at least one block per job
+	int blocksPerChunk = qMax(jobs_.size(), static_cast<int>(framesPerChunk_ / framesPerBlock));
+
+	QVector<const uchar*> currentFrames;
+	QVector<int> currentIndices;
+	auto mapChunk = [&](int firstBlock, QVector<const uchar*> &frames, QVector<int> &indices) {
+		frames.clear();
+		indices.clear();
+		for (int i = firstBlock; i < qMin(firstBlock + blocksPerChunk, results.size()); i++) {
+			frames.append(reader.mapFrames(results.at(i).firstFrame, framesPerBlock));
+			indices.append(i);
+		}
+	};
+	auto unmapChunk = [&](QVector<const uchar*> &frames) {
+		for (const uchar *blockFrames : frames) {
+			reader.unmapFrames(blockFrames);
+		}
+		frames.clear();
+	};
+
+	mapChunk(0, currentFrames, currentIndices);
+	for (int chunkStart = 0; chunkStart < results.size(); chunkStart += blocksPerChunk) {
+		// Mapping the next chunk starts read-ahead of its frames while the current chunk is processed
+		QVector<const uchar*> nextFrames;
+		QVector<int> nextIndices;
+		if (chunkStart + blocksPerChunk < results.size()) {
+			mapChunk(chunkStart + blocksPerChunk, nextFrames, nextIndices);
+		}
+
+		this->processChunk(currentFrames, currentIndices, input, results);
+
+		unmapChunk(currentFrames);
+		currentFrames = nextFrames;
+		currentIndices = nextIndices;
+	}
+	return true;
+}
+
+void VolumeEstimation::processChunk(const QVector<const uchar*> &blockFrames, const QVector<int> &blockIndices, const EstimationInput &input, QVector<BlockResult> &results)
+{
+	// Job j processes every jobs_.size()-th block of the chunk, so no job is used by two threads at the same time
+	BlockResult *blocks = results.data();
+	QVector<QFuture<void>> futures;
+	for (int j = 0; j < jobs_.size(); j++) {
+		futures.append(QtConcurrent::run(&threadPool_, [this, j, &blockFrames, &blockIndices, &input, blocks]() {
+			for (int i = j; i < blockIndices.size(); i += jobs_.size()) {
+				BlockResult &block = blocks[blockIndices.at(i)];
+				if (blockFrames.at(i) == nullptr) {
+					block.result.errorMessage = QStringLiteral("Could not map frames.");
+					continue;
+				}
+				EstimationInput blockInput = input;
+				blockInput.firstFrame = block.firstFrame;
+				blockInput.numberOfFrames = block.numberOfFrames;
+				block.result = jobs_.at(j)->runOnFrames(blockFrames.at(i), blockInput);
+			}
+		}));
+	}
+	for (QFuture<void> &future : futures) {
+		future.waitForFinished();
+	}
+}
+
+CoefficientStatistics VolumeEstimation::statistics(const QVector<double> &values)
+{
+	CoefficientStatistics statistics;
+	statistics.count = values.size();
+	if (values.isEmpty()) {
+		return statistics;
+	}
+
+	std::vector<double> sortedValues(values.begin(), values.end());
+	std::sort(sortedValues.begin(), sortedValues.end());
+	size_t n = sortedValues.size();
+	statistics.minimum = sortedValues.front();
+	statistics.maximum = sortedValues.back();
+	statistics.median = n % 2 == 1 ? sortedValues[n / 2] : 0.5 * (sortedValues[n / 2 - 1] + sortedValues[n / 2]);
+
+	double sum = 0.0;
+	for (double value : sortedValues) {
+		sum += value;
+	}
+	statistics.mean = sum / static_cast<double>(n);
+	double squaredDeviations = 0.0;
+	for (double value : sortedValues) {
+		squaredDeviations += (value - statistics.mean) * (value - statistics.mean);
+	}
+	statistics.standardDeviation = n > 1 ? qSqrt(squaredDeviations / static_cast<double>(n - 1)) : 0.0;
+
+	std::vector<double> deviations;
+	deviations.reserve(n);
+	for (double value : sortedValues) {
+		deviations.push_back(qAbs(value - statistics.median));
+	}
+	std::sort(deviations.begin(), deviations.end());
+	statistics.medianAbsoluteDeviation = n % 2 == 1 ? deviations[n / 2] : 0.5 * (deviations[n / 2 - 1] + deviations[n / 2]);
+	return statistics;
+}
+
+QVector<int> VolumeEstimation::outliers(const QVector<double> &values, const CoefficientStatistics &statistics)
+{
+	QVector<int> indices;
+	double limit = OUTLIER_THRESHOLD * MAD_TO_STANDARD_DEVIATION * statistics.medianAbsoluteDeviation;
+	if (limit <= 0.0) {
+		return indices;
+	}
+	for (int i = 0; i < values.size(); i++) {
+		if (qAbs(values.at(i) - statistics.median) > limit) {
+			indices.append(i);
+		}
+	}
+	return indices;
+}
+
+QJsonObject VolumeEstimation::toJson(const EstimationInput &input, const QVector<BlockResult> &results, qint64 totalTimeMs)
+{
+	QVector<double> valuesD2;
+	QVector<double> valuesD3;
+	QVector<int> successfulBlocks;
+	for (int i = 0; i < results.size(); i++) {
+		if (results.at(i).result.success) {
+			valuesD2.append(results.at(i).result.d2);
+			valuesD3.append(results.at(i).result.d3);
+			successfulBlocks.append(i);
+		}
+	}
+
+	auto statisticsToJson = [](const CoefficientStatistics &statistics) {
+		QJsonObject json;
+		json["count"] = statistics.count;
+		json["mean"] = statistics.mean;
+		json["standard_deviation"] = statistics.standardDeviation;
+		json["median"] = statistics.median;
+		json["median_absolute_deviation"] = statistics.medianAbsoluteDeviation;
+		json["min"] = statistics.minimum;
+		json["max"] = statistics.maximum;
+		return json;
+	};
+	CoefficientStatistics statisticsD2 = statistics(valuesD2);
+	CoefficientStatistics statisticsD3 = statistics(valuesD3);
+
+	// A block is an outlier if d2 or d3 is one
+	QVector<int> outlierIndices = outliers(valuesD2, statisticsD2) + outliers(valuesD3, statisticsD3);
+	std::sort(outlierIndices.begin(), outlierIndices.end());
+	outlierIndices.erase(std::unique(outlierIndices.begin(), outlierIndices.end()), outlierIndices.end());
+	QJsonArray outlierBlocks;
+	for (int index : outlierIndices) {
+		const BlockResult &block = results.at(successfulBlocks.at(index));
+		QJsonObject outlier;
+		outlier["first_frame"] = static_cast<int>(block.firstFrame);
+		outlier["d2"] = block.result.d2;
+		outlier["d3"] = block.result.d3;
+		outlierBlocks.append(outlier);
+	}
+
+	QJsonObject json;
+	json["file"] = input.rawFilePath;
+	json["bit_depth"] = static_cast<int>(input.bitDepth);
+	json["samples_per_line"] = static_cast<int>(input.samplesPerLine);
+	json["lines_per_frame"] = static_cast<int>(input.linesPerFrame);
+	json["frames_per_block"] = static_cast<int>(input.numberOfFrames);
+	json["blocks"] = results.size();
+	json["failed_blocks"] = results.size() - successfulBlocks.size();
+	json["d2"] = statisticsToJson(statisticsD2);
+	json["d3"] = statisticsToJson(statisticsD3);
+	json["outliers"] = outlierBlocks;
+	json["time_ms"] = totalTimeMs;
+	return json;
+}
+
+bool VolumeEstimation::writeBlocksCsv(const QString &filePath, const QVector<BlockResult> &results)
+{
+	QFile file(filePath);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+		return false;
+	}
+	QTextStream stream(&file);
+	stream.setRealNumberPrecision(10);
+	stream << "first_frame,frames,success,d1,d2,d3,estimation_ms\n";
+	for (const BlockResult &block : results) {
+		const EstimationResult &result = block.result;
+		stream << block.firstFrame << "," << block.numberOfFrames << "," << (result.success ? 1 : 0) << ",";
+		if (result.success) {
+			if (result.hasD1) {
+				stream << result.d1;
+			}
+			stream << "," << result.d2 << "," << result.d3;
+		} else {
+			stream << ",,";
+		}
+		stream << "," << result.estimationTimeMs << "\n";
+	}
+	return stream.status() == QTextStream::Ok;
+}
@@ -0,0 +1,56 @@
+#ifndef VOLUMEESTIMATION_H
+#define VOLUMEESTIMATION_H
+
+#include <QVector>
+#include <QJsonObject>
+#include <QThreadPool>
+#include "estimationjob.h"
+
+struct BlockResult {
+	unsigned int firstFrame;
+	unsigned int numberOfFrames;
+	EstimationResult result;
+};
+
+struct CoefficientStatistics {
+	int count = 0;
+	double mean = 0.0;
+	double standardDeviation = 0.0;
+	double median = 0.0;
+	double medianAbsoluteDeviation = 0.0;
+	double minimum = 0.0;
+	double maximum = 0.0;
+};
+
+// Estimates dispersion coefficients for every block of frames of a whole recorded volume.
+// Blocks are distributed over several estimation jobs that run in parallel, each job evaluates
+// its candidates single-threaded. The volume is mapped in chunks of frames, the next chunk is
+// mapped (and thereby read ahead) while the current one is processed, so at most two chunks are resident.
+class VolumeEstimation
+{
+public:
+	VolumeEstimation(const QString &settingsFilePath, const QString &resamplingCurveFilePath, const DispersionEstimatorParameters &params, int numberOfJobs);
+	~VolumeEstimation();
+
+	void setFramesPerChunk(int framesPerChunk);
+
+	// input.firstFrame is the first frame of the first block, input.numberOfFrames the number of frames per block.
+	// Blocks continue until the end of the file, blockStride > 1 skips blocks.
+	bool run(const EstimationInput &input, int blockStride, QVector<BlockResult> &results, QString &errorMessage);
+
+	static CoefficientStatistics statistics(const QVector<double> &values);
+	// Indices of values that deviate from the median by more than 3 scaled median absolute deviations
+	static QVector<int> outliers(const QVector<double> &values, const CoefficientStatistics &statistics);
+
+	static QJsonObject toJson(const EstimationInput &input, const QVector<BlockResult> &results, qint64 totalTimeMs);
+	static bool writeBlocksCsv(const QString &filePath, const QVector<BlockResult> &results);
+
+private:
+	QVector<EstimationJob*> jobs_;
+	QThreadPool threadPool_;
+	int framesPerChunk_;
+
+	void processChunk(const QVector<const uchar*> &blockFrames, const QVector<int> &blockIndices, const EstimationInput &input, QVector<BlockResult> &results);
+};
+
+#endif // VOLUMEESTIMATION_H
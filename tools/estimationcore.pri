@@ -0,0 +1,64 @@
+#Estimation engine without GUI and OCTproZ dependencies and raw file access. Shared by the command-line tools.
+QT += concurrent
+
+ESTIMATIONCORE_SRC = $$PWD/../src
+
+SOURCES += \
+	$$ESTIMATIONCORE_SRC/dispersionestimationengine.cpp \
+	$$ESTIMATIONCORE_SRC/octprocessor/processor.tpp \
+	$$ESTIMATIONCORE_SRC/octprocessor/processorcontroller.cpp \
+	$$ESTIMATIONCORE_SRC/octprocessor/hardwarecounters.cpp \
+	$$ESTIMATIONCORE_SRC/octprocessor/allocationtracking.cpp \
+	$$ESTIMATIONCORE_SRC/octprocessor/memoryarena.cpp \
+	$$ESTIMATIONCORE_SRC/octprocessor/fringegenerator.cpp \
+	$$ESTIMATIONCORE_SRC/ascanmetriccalculator.cpp \
+	$$ESTIMATIONCORE_SRC/neldermeadoptimizer.cpp \
+	$$ESTIMATIONCORE_SRC/peakfitter.cpp \
+	$$ESTIMATIONCORE_SRC/parallelmetricevaluator.cpp \
+	$$ESTIMATIONCORE_SRC/metriccache.cpp \
+	$$ESTIMATIONCORE_SRC/ascanselector.cpp \
+	$$ESTIMATIONCORE_SRC/lbfgsoptimizer.cpp \
+	$$ESTIMATIONCORE_SRC/estimationrunreport.cpp \
+	$$ESTIMATIONCORE_SRC/tracerecorder.cpp \
+	$$ESTIMATIONCORE_SRC/processmemory.cpp \
+	$$PWD/common/rawvolumereader.cpp \
+	$$PWD/common/estimatorparameterfile.cpp
+
+HEADERS += \
+	$$ESTIMATIONCORE_SRC/dispersionestimatorparameters.h \
+	$$ESTIMATIONCORE_SRC/dispersionestimationengine.h \
+	$$ESTIMATIONCORE_SRC/octprocessor/processor.h \
+	$$ESTIMATIONCORE_SRC/octprocessor/processorcontroller.h \
+	$$ESTIMATIONCORE_SRC/octprocessor/stagetimings.h \
+	$$ESTIMATIONCORE_SRC/octprocessor/spectrumview.h \
+	$$ESTIMATIONCORE_SRC/octprocessor/hardwarecounters.h \
+	$$ESTIMATIONCORE_SRC/octprocessor/allocationtracking.h \
+	$$ESTIMATIONCORE_SRC/octprocessor/memoryarena.h \
+	$$ESTIMATIONCORE_SRC/octprocessor/fringegenerator.h \
+	$$ESTIMATIONCORE_SRC/ascanmetriccalculator.h \
+	$$ESTIMATIONCORE_SRC/neldermeadoptimizer.h \
+	$$ESTIMATIONCORE_SRC/peakfitter.h \
+	$$ESTIMATIONCORE_SRC/parallelmetricevaluator.h \
+	$$ESTIMATIONCORE_SRC/metriccache.h \
+	$$ESTIMATIONCORE_SRC/ascanselector.h \
+	$$ESTIMATIONCORE_SRC/lbfgsoptimizer.h \
+	$$ESTIMATIONCORE_SRC/estimationrunreport.h \
+	$$ESTIMATIONCORE_SRC/tracerecorder.h \
+	$$ESTIMATIONCORE_SRC/processmemory.h \
+	$$PWD/common/rawvolumereader.h \
+	$$PWD/common/estimatorparameterfile.h
+
+INCLUDEPATH += \
+	$$ESTIMATIONCORE_SRC \
+	$$ESTIMATIONCORE_SRC/octprocessor \
+	$$ESTIMATIONCORE_SRC/thirdparty \
+	$$ESTIMATIONCORE_SRC/thirdparty/fftw \
+	$$PWD/common
+
+unix{
+	LIBS += -lfftw3
+}
+win32{
+	LIBS += -L$$ESTIMATIONCORE_SRC/thirdparty/fftw/ -llibfftw3-3 -lpsapi
+	DEPENDPATH += $$ESTIMATIONCORE_SRC/thirdparty/fftw
+}
@@ -0,0 +1,58 @@
+#ifndef BENCHMARKTIMER_H
+#define BENCHMARKTIMER_H
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Repeats a pass until at least minimumTimeNs have been measured (and at least minimumPasses passes were made)
+// and returns the median duration of one pass in nanoseconds. reset() runs before every pass and is not timed,
+// it restores data that is modified in place by the pass.
+template <typename Reset, typename Pass>
+double medianPassDurationNs(Reset reset, Pass pass, double minimumTimeNs, int minimumPasses = 5) {
+	typedef std::chrono::steady_clock Clock;
+
+	// Warm-up pass so that caches, page mappings and lazily computed tables are in place
+	reset();
+	pass();
+
+	std::vector<double> durations;
+	double totalDuration = 0.0;
+	while (totalDuration < minimumTimeNs || static_cast<int>(durations.size()) < minimumPasses) {
+		reset();
+		Clock::time_point start = Clock::now();
+		pass();
+		double duration = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+		durations.push_back(duration);
+		totalDuration += duration;
+	}
+
+	std::sort(durations.begin(), durations.end());
+	size_t n = durations.size();
+	return n % 2 == 1 ? durations[n / 2] : 0.5 * (durations[n / 2 - 1] + durations[n / 2]);
+}
+
+struct BenchmarkResult {
+	std::string stage;
+	size_t samplesPerLine;
+	int bitDepth; // 0 if the stage does not depend on the bit depth
+	size_t numberOfAscans;
+	double nsPerSample;
+	double gigabytesPerSecond;
+};
+
+// Converts the median duration of a pass over samples samples, of which every one reads and writes bytesPerSample bytes
+inline BenchmarkResult makeBenchmarkResult(const std::string &stage, size_t samplesPerLine, int bitDepth, size_t numberOfAscans,
+                                           double passDurationNs, size_t samples, double bytesPerSample) {
+	BenchmarkResult result;
+	result.stage = stage;
+	result.samplesPerLine = samplesPerLine;
+	result.bitDepth = bitDepth;
+	result.numberOfAscans = numberOfAscans;
+	result.nsPerSample = passDurationNs / static_cast<double>(samples);
+	result.gigabytesPerSecond = bytesPerSample * static_cast<double>(samples) / passDurationNs; // bytes per ns = GB/s
+	return result;
+}
+
+#endif // BENCHMARKTIMER_H
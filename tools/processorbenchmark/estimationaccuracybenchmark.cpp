@@ -0,0 +1,103 @@
+#include "estimationaccuracybenchmark.h"
+#include <QElapsedTimer>
+#include <QSettings>
+#include "fringegenerator.h"
+#include "estimatorparameterfile.h"
+
+#define SYNTHETIC_BIT_DEPTH 12
+
+EstimationAccuracyBenchmark::EstimationAccuracyBenchmark(size_t samplesPerLine, size_t numberOfAscans, double trueD2, double trueD3)
+	: samplesPerLine_(samplesPerLine),
+	numberOfAscans_(numberOfAscans),
+	trueD2_(trueD2),
+	trueD3_(trueD3)
+{
+	double lastIndex = static_cast<double>(samplesPerLine_ - 1);
+	resamplingCoefficients_ = {0.0, lastIndex, 0.05 * lastIndex, -0.02 * lastIndex};
+}
+
+bool EstimationAccuracyBenchmark::prepare(QString &errorMessage)
+{
+	if (!settingsDir_.isValid()) {
+		errorMessage = QStringLiteral("Could not create temporary directory.");
+		return false;
+	}
+
+	// Processing settings in the format OCTproZ writes, matching the synthetic data
+	QSettings settings(settingsDir_.filePath("settings.ini"), QSettings::IniFormat);
+	settings.beginGroup("Virtual OCT System");
+	settings.setValue("bit_depth", SYNTHETIC_BIT_DEPTH);
+	settings.setValue("width", static_cast<uint>(samplesPerLine_));
+	settings.setValue("height", static_cast<uint>(numberOfAscans_));
+	settings.setValue("buffers_per_volume", 1);
+	settings.endGroup();
+	settings.beginGroup("processing");
+	settings.setValue("background_removal", true);
+	settings.setValue("background_removal_window_size", 64);
+	settings.setValue("resampling", true);
+	settings.setValue("custom_resampling", false);
+	for (size_t i = 0; i < resamplingCoefficients_.size(); i++) {
+		settings.setValue(QString("resampling_c%1").arg(i), resamplingCoefficients_[i]);
+	}
+	settings.setValue("dispersion_compensation", true);
+	settings.setValue("dispersion_compensation_d0", 0.0);
+	settings.setValue("dispersion_compensation_d1", 0.0);
+	settings.setValue("windowing", true);
+	settings.setValue("log", false);
+	settings.setValue("min", 0.0);
+	settings.setValue("max", 80.0);
+	settings.setValue("coeff", 1.0);
+	settings.setValue("addend", 0.0);
+	settings.endGroup();
+	settings.sync();
+	if (settings.status() != QSettings::NoError) {
+		errorMessage = QStringLiteral("Could not write settings file.");
+		return false;
+	}
+	engine_.setSettingsFilePaths(settings.fileName(), QString());
+
+	OCTSignalProcessing::FringeGenerator::Parameters parameters;
+	parameters.samplesPerSpectrum = samplesPerLine_;
+	parameters.spectraPerFrame = numberOfAscans_;
+	parameters.bitDepth = SYNTHETIC_BIT_DEPTH;
+	parameters.reflectors = {{0.1 * samplesPerLine_, 1.0}, {0.25 * samplesPerLine_, 0.5}};
+	parameters.resamplingCoefficients = resamplingCoefficients_;
+	parameters.dispersionCoefficients = {0.0, 0.0, trueD2_, trueD3_};
+	raw_ = OCTSignalProcessing::FringeGenerator(parameters).generate();
+	return true;
+}
+
+EstimationAccuracyResult EstimationAccuracyBenchmark::run(ESTIMATION_STRATEGY strategy, const QString &strategyName)
+{
+	EstimationAccuracyResult result;
+	result.strategy = strategyName;
+	result.samplesPerLine = samplesPerLine_;
+	result.numberOfAscans = numberOfAscans_;
+
+	DispersionEstimatorParameters params = EstimatorParameterFile::load(QString());
+	params.estimationStrategy = strategy;
+	params.numberOfCenterAscans = static_cast<int>(numberOfAscans_);
+	params.metricCache = false;
+	params.peakFitting = true; // accuracy between the grid samples is part of what is measured
+	engine_.setParams(params);
+
+	QMetaObject::Connection connectionD2 = QObject::connect(&engine_, &DispersionEstimationEngine::bestD2Estimated, [&result](double d2) {
+		result.d2 = d2;
+		result.success = true;
+	});
+	QMetaObject::Connection connectionD3 = QObject::connect(&engine_, &DispersionEstimationEngine::bestD3Estimated, [&result](double d3) {
+		result.d3 = d3;
+	});
+
+	QElapsedTimer timer;
+	timer.start();
+	engine_.startDispersionEstimation(raw_.data(), SYNTHETIC_BIT_DEPTH, static_cast<unsigned int>(samplesPerLine_), static_cast<unsigned int>(numberOfAscans_), 1);
+	result.timeMs = static_cast<double>(timer.nsecsElapsed()) / 1.0e6;
+
+	QObject::disconnect(connectionD2);
+	QObject::disconnect(connectionD3);
+
+	result.errorD2 = result.d2 - trueD2_;
+	result.errorD3 = result.d3 - trueD3_;
+	return result;
+}
@@ -0,0 +1,44 @@
+#ifndef ESTIMATIONACCURACYBENCHMARK_H
+#define ESTIMATIONACCURACYBENCHMARK_H
+
+#include <QString>
+#include <QTemporaryDir>
+#include <vector>
+#include <cstdint>
+#include "dispersionestimatorparameters.h"
+#include "dispersionestimationengine.h"
+
+struct EstimationAccuracyResult {
+	QString strategy;
+	size_t samplesPerLine = 0;
+	size_t numberOfAscans = 0;
+	bool success = false;
+	double timeMs = 0.0;
+	double d2 = 0.0;
+	double d3 = 0.0;
+	double errorD2 = 0.0;
+	double errorD3 = 0.0;
+};
+
+// Runs the estimation engine on a synthetic frame with known dispersion and reports run time and estimation error.
+// The processing settings that match the synthetic data are written to a temporary settings file.
+class EstimationAccuracyBenchmark
+{
+public:
+	EstimationAccuracyBenchmark(size_t samplesPerLine, size_t numberOfAscans, double trueD2, double trueD3);
+
+	bool prepare(QString &errorMessage);
+	EstimationAccuracyResult run(ESTIMATION_STRATEGY strategy, const QString &strategyName);
+
+private:
+	size_t samplesPerLine_;
+	size_t numberOfAscans_;
+	double trueD2_;
+	double trueD3_;
+	std::vector<double> resamplingCoefficients_;
+	std::vector<uint8_t> raw_;
+	QTemporaryDir settingsDir_;
+	DispersionEstimationEngine engine_;
+};
+
+#endif // ESTIMATIONACCURACYBENCHMARK_H
@@ -0,0 +1,249 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QSysInfo>
+#include <QTextStream>
+#include "processorstagebenchmark.h"
+#include "ascanmetriccalculator.h"
+#include "estimationaccuracybenchmark.h"
+#include "estimatorparameterfile.h"
+
+// Micro-benchmarks for every processing step of the CPU processor and every A-scan metric.
+// Results (ns per sample and GB/s) are printed and can be written to a JSON file. With --baseline
+// the results are compared to an earlier JSON file, the exit code is 1 if a benchmark got slower
+// than the tolerance allows. With --estimation the whole estimation is run on synthetic frames with
+// known dispersion for every strategy, the exit code is also 1 if an estimate is further off than --max-error.
+
+namespace {
+
+const QMap<QString, ASCAN_SHARPNESS_METRIC> metrics = {
+	{"metricSumAboveThreshold", SUM_ABOVE_THRESHOLD},
+	{"metricSamplesAboveThreshold", SAMPLES_ABOVE_THRESHOLD},
+	{"metricPeakValue", PEAK_VALUE},
+	{"metricMeanSobel", MEAN_SOBEL},
+	{"metricSumOfSquaredIntensity", SUM_OF_SQUARED_INTENSITY}
+};
+
+bool parseList(const QString &text, std::vector<int> &values) {
+	values.clear();
+	for (const QString &item : text.split(',', QString::SkipEmptyParts)) {
+		bool ok = false;
+		int value = item.trimmed().toInt(&ok);
+		if (!ok || value <= 0) {
+			return false;
+		}
+		values.push_back(value);
+	}
+	return !values.empty();
+}
+
+std::vector<BenchmarkResult> benchmarkMetrics(const std::vector<float> &ascans, size_t samplesPerLine, size_t numberOfAscans, double minimumTimeMs) {
+	QVector<float> outputData = QVector<float>::fromStdVector(ascans);
+	int outputSamplesPerLine = static_cast<int>(samplesPerLine / 2);
+
+	DispersionEstimatorParameters params;
+	params.numberOfAscanSamplesToIgnore = 30;
+	params.metricThreshold = 0.7;
+
+	std::vector<BenchmarkResult> results;
+	for (auto it = metrics.constBegin(); it != metrics.constEnd(); ++it) {
+		params.sharpnessMetric = it.value();
+		AscanMetricCalculator calculator(params);
+		volatile float sink = 0.0f;
+		double duration = medianPassDurationNs([]() {}, [&]() {
+			sink = calculator.calculateMetric(outputData, outputSamplesPerLine);
+		}, minimumTimeMs * 1.0e6);
+		Q_UNUSED(sink)
+		results.push_back(makeBenchmarkResult(it.key().toStdString(), samplesPerLine, 0, numberOfAscans, duration,
+		                                      static_cast<size_t>(outputData.size()), sizeof(float)));
+	}
+	return results;
+}
+
+QString resultKey(const QJsonObject &result) {
+	return result["stage"].toString() + "|" + QString::number(result["samples_per_line"].toInt()) + "|"
+			+ QString::number(result["bit_depth"].toInt()) + "|" + QString::number(result["ascans"].toInt());
+}
+
+QJsonObject toJson(const BenchmarkResult &result) {
+	QJsonObject json;
+	json["stage"] = QString::fromStdString(result.stage);
+	json["samples_per_line"] = static_cast<int>(result.samplesPerLine);
+	json["bit_depth"] = result.bitDepth;
+	json["ascans"] = static_cast<int>(result.numberOfAscans);
+	json["ns_per_sample"] = result.nsPerSample;
+	json["gb_per_s"] = result.gigabytesPerSecond;
+	return json;
+}
+
+// Returns the number of regressions
+int compareWithBaseline(const QJsonArray &results, const QJsonArray &baselineResults, double tolerancePercent, QTextStream &out) {
+	QMap<QString, double> baseline;
+	for (const QJsonValue &value : baselineResults) {
+		QJsonObject result = value.toObject();
+		baseline.insert(resultKey(result), result["ns_per_sample"].toDouble());
+	}
+
+	int regressions = 0;
+	out << "\nComparison with baseline (tolerance " << tolerancePercent << " %):\n";
+	out << QString("%1 %2 %3 %4 %5 %6 %7\n").arg("stage", -30).arg("length", 7).arg("bits", 5).arg("ascans", 7)
+	       .arg("base ns", 10).arg("ns", 10).arg("change", 9);
+	for (const QJsonValue &value : results) {
+		QJsonObject result = value.toObject();
+		QString key = resultKey(result);
+		if (!baseline.contains(key)) {
+			continue;
+		}
+		double baselineNs = baseline.value(key);
+		double currentNs = result["ns_per_sample"].toDouble();
+		double changePercent = baselineNs > 0.0 ? 100.0 * (currentNs - baselineNs) / baselineNs : 0.0;
+		bool isRegression = changePercent > tolerancePercent;
+		regressions += isRegression ? 1 : 0;
+		out << QString("%1 %2 %3 %4 %5 %6 %7%8\n").arg(result["stage"].toString(), -30).arg(result["samples_per_line"].toInt(), 7)
+		       .arg(result["bit_depth"].toInt(), 5).arg(result["ascans"].toInt(), 7).arg(baselineNs, 10, 'f', 3).arg(currentNs, 10, 'f', 3)
+		       .arg(changePercent, 8, 'f', 1).arg(isRegression ? "%  REGRESSION" : "%");
+	}
+	return regressions;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("processorbenchmark");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Times every processing step and every A-scan metric of the dispersion estimator.");
+	parser.addHelpOption();
+	parser.addOptions({
+		{"line-lengths", "Samples per raw A-scan.", "list", "512,1024,2048,4096,8192"},
+		{"bit-depths", "Bit depths for the input conversion.", "list", "8,12,16,32"},
+		{"ascans", "Number of A-scans per pass.", "list", "64,512"},
+		{"min-time", "Minimum measured time per benchmark in ms.", "ms", "200"},
+		{"output", "Write results to this JSON file.", "file"},
+		{"baseline", "Compare results with this JSON file from an earlier run.", "file"},
+		{"tolerance", "Allowed slowdown in percent before a benchmark counts as regression.", "percent", "10"},
+		{"estimation", "Also run every estimation strategy on synthetic frames with known dispersion."},
+		{"true-dispersion", "d2 and d3 of the synthetic frames.", "d2:d3", "25:-10"},
+		{"max-error", "Largest accepted deviation of estimated d2 and d3 from the true values.", "value", "1.0"}
+	});
+	parser.process(app);
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+	std::vector<int> lineLengths;
+	std::vector<int> bitDepths;
+	std::vector<int> ascanCounts;
+	bool minimumTimeOk = false;
+	bool toleranceOk = false;
+	bool maximumErrorOk = false;
+	double minimumTimeMs = parser.value("min-time").toDouble(&minimumTimeOk);
+	double tolerancePercent = parser.value("tolerance").toDouble(&toleranceOk);
+	double maximumError = parser.value("max-error").toDouble(&maximumErrorOk);
+	QStringList trueDispersion = parser.value("true-dispersion").split(':');
+	bool trueD2Ok = false;
+	bool trueD3Ok = false;
+	double trueD2 = trueDispersion.value(0).toDouble(&trueD2Ok);
+	double trueD3 = trueDispersion.value(1).toDouble(&trueD3Ok);
+	if (!parseList(parser.value("line-lengths"), lineLengths) || !parseList(parser.value("bit-depths"), bitDepths)
+			|| !parseList(parser.value("ascans"), ascanCounts) || !minimumTimeOk || !toleranceOk
+			|| !maximumErrorOk || trueDispersion.size() != 2 || !trueD2Ok || !trueD3Ok) {
+		err << "Invalid command line option.\n";
+		parser.showHelp(2);
+	}
+
+	// Baseline is loaded first, so a wrong path is reported before the benchmarks run
+	QJsonArray baselineResults;
+	if (parser.isSet("baseline")) {
+		QFile baselineFile(parser.value("baseline"));
+		if (!baselineFile.open(QIODevice::ReadOnly)) {
+			err << "Could not open baseline: " << baselineFile.fileName() << "\n";
+			return 2;
+		}
+		baselineResults = QJsonDocument::fromJson(baselineFile.readAll()).object()["results"].toArray();
+	}
+
+	QJsonArray results;
+	out << QString("%1 %2 %3 %4 %5 %6\n").arg("stage", -30).arg("length", 7).arg("bits", 5).arg("ascans", 7).arg("ns/sample", 10).arg("GB/s", 8);
+	for (int lineLength : lineLengths) {
+		for (int ascans : ascanCounts) {
+			ProcessorStageBenchmark benchmark(static_cast<size_t>(lineLength), static_cast<size_t>(ascans), minimumTimeMs);
+			std::vector<BenchmarkResult> stageResults = benchmark.run(bitDepths);
+			std::vector<BenchmarkResult> metricResults = benchmarkMetrics(benchmark.processedAscans(), static_cast<size_t>(lineLength), static_cast<size_t>(ascans), minimumTimeMs);
+			stageResults.insert(stageResults.end(), metricResults.begin(), metricResults.end());
+
+			for (const BenchmarkResult &result : stageResults) {
+				out << QString("%1 %2 %3 %4 %5 %6\n").arg(QString::fromStdString(result.stage), -30).arg(result.samplesPerLine, 7)
+				       .arg(result.bitDepth, 5).arg(result.numberOfAscans, 7).arg(result.nsPerSample, 10, 'f', 3).arg(result.gigabytesPerSecond, 8, 'f', 2);
+				results.append(toJson(result));
+			}
+			out.flush();
+		}
+	}
+
+	// Whole estimation on synthetic data. The run time is stored like the other benchmarks, so it is part of the baseline comparison.
+	int inaccurateEstimations = 0;
+	if (parser.isSet("estimation")) {
+		const QMap<QString, ESTIMATION_STRATEGY> strategies = EstimatorParameterFile::strategyNames();
+		out << "\nEstimation on synthetic frames, true d2: " << trueD2 << ", d3: " << trueD3 << "\n";
+		out << QString("%1 %2 %3 %4 %5 %6\n").arg("strategy", -30).arg("length", 7).arg("ascans", 7).arg("ms", 10).arg("d2 error", 10).arg("d3 error", 10);
+		for (int lineLength : lineLengths) {
+			for (int ascans : ascanCounts) {
+				EstimationAccuracyBenchmark benchmark(static_cast<size_t>(lineLength), static_cast<size_t>(ascans), trueD2, trueD3);
+				QString errorMessage;
+				if (!benchmark.prepare(errorMessage)) {
+					err << errorMessage << "\n";
+					return 2;
+				}
+				for (auto it = strategies.constBegin(); it != strategies.constEnd(); ++it) {
+					EstimationAccuracyResult result = benchmark.run(it.value(), it.key());
+					bool isAccurate = result.success && qAbs(result.errorD2) <= maximumError && qAbs(result.errorD3) <= maximumError;
+					inaccurateEstimations += isAccurate ? 0 : 1;
+					out << QString("%1 %2 %3 %4 %5 %6%7\n").arg(result.strategy, -30).arg(lineLength, 7).arg(ascans, 7)
+					       .arg(result.timeMs, 10, 'f', 1).arg(result.errorD2, 10, 'f', 3).arg(result.errorD3, 10, 'f', 3)
+					       .arg(isAccurate ? "" : "  INACCURATE");
+					out.flush();
+
+					size_t samples = static_cast<size_t>(lineLength) * static_cast<size_t>(ascans);
+					QJsonObject json = toJson(makeBenchmarkResult(("estimation/" + result.strategy).toStdString(), static_cast<size_t>(lineLength), 0,
+					                                              static_cast<size_t>(ascans), result.timeMs * 1.0e6, samples, 2.0));
+					json["success"] = result.success;
+					json["d2_error"] = result.errorD2;
+					json["d3_error"] = result.errorD3;
+					results.append(json);
+				}
+			}
+		}
+		out << inaccurateEstimations << " inaccurate estimation(s).\n";
+	}
+
+	if (parser.isSet("output")) {
+		QJsonObject json;
+		json["date"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+		json["host"] = QSysInfo::machineHostName();
+		json["cpu_architecture"] = QSysInfo::currentCpuArchitecture();
+		json["os"] = QSysInfo::prettyProductName();
+		json["min_time_ms"] = minimumTimeMs;
+		json["true_d2"] = trueD2;
+		json["true_d3"] = trueD3;
+		json["results"] = results;
+		QFile outputFile(parser.value("output"));
+		if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+			err << "Could not write results: " << outputFile.fileName() << "\n";
+			return 2;
+		}
+		outputFile.write(QJsonDocument(json).toJson(QJsonDocument::Indented));
+	}
+
+	int regressions = 0;
+	if (parser.isSet("baseline")) {
+		regressions = compareWithBaseline(results, baselineResults, tolerancePercent, out);
+		out << regressions << " regression(s).\n";
+	}
+	return regressions > 0 || inaccurateEstimations > 0 ? 1 : 0;
+}
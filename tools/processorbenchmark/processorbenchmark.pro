@@ -0,0 +1,21 @@
+QT = core
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = processorbenchmark
+TEMPLATE = app
+
+DEFINES += \
+	QT_DEPRECATED_WARNINGS #emit warnings if depracted Qt features are used
+
+include(../estimationcore.pri)
+
+SOURCES += \
+	main.cpp \
+	processorstagebenchmark.cpp \
+	estimationaccuracybenchmark.cpp
+
+HEADERS += \
+	benchmarktimer.h \
+	processorstagebenchmark.h \
+	estimationaccuracybenchmark.h
@@ -0,0 +1,151 @@
+#include "processorstagebenchmark.h"
+#include <cstring>
+#include "fringegenerator.h"
+
+// Slightly nonlinear k-sampling, relative to the spectrum length
+#define RESAMPLING_C2 0.05f
+#define RESAMPLING_C3 -0.02f
+
+ProcessorStageBenchmark::ProcessorStageBenchmark(size_t samplesPerLine, size_t numberOfAscans, double minimumTimeMs)
+	: samplesPerLine_(samplesPerLine),
+	numberOfAscans_(numberOfAscans),
+	minimumTimeNs_(minimumTimeMs * 1.0e6)
+{
+	processor_.reset(new OCTSignalProcessing::Processor<T>(samplesPerLine_));
+
+	// Settings as in a typical OCTproZ configuration: all steps enabled, fixed log scaling range, slightly nonlinear resampling
+	OCTSignalProcessing::Processor<T>::ProcessingOptions options;
+	processor_->setProcessingOptions(options);
+	T lastIndex = static_cast<T>(samplesPerLine_ - 1);
+	processor_->setResamplingCoefficients({0.0f, lastIndex, RESAMPLING_C2 * lastIndex, RESAMPLING_C3 * lastIndex});
+	processor_->setDispersionCoefficients({0.0f, 0.0f, 20.0f, -5.0f});
+	processor_->setLogScaleParameters(1.0f, 0.0f, 80.0f, 0.0f, false);
+	processor_->updateResampleCurveIfNeeded();
+
+	// Converted 12 bit spectra are the input of all following steps
+	std::vector<uint8_t> raw = syntheticRawData(12);
+	Spectrum converted;
+	processor_->convertInputData(raw.data(), totalSamples(), 12, converted);
+	spectra_.resize(numberOfAscans_);
+	for (size_t i = 0; i < numberOfAscans_; ++i) {
+		spectra_[i].assign(converted.begin() + i * samplesPerLine_, converted.begin() + (i + 1) * samplesPerLine_);
+	}
+}
+
+std::vector<BenchmarkResult> ProcessorStageBenchmark::run(const std::vector<int> &bitDepths)
+{
+	typedef OCTSignalProcessing::Processor<T> P;
+	std::vector<BenchmarkResult> results;
+	for (int bitDepth : bitDepths) {
+		results.push_back(benchmarkConversion(bitDepth));
+	}
+
+	// Bytes per sample: complex samples that are read and written, plus tables (window, phase, resampling curve) that are read
+	const double complexBytes = 2.0 * sizeof(T);
+	results.push_back(benchmarkInPlaceStage("rollingAverageDCRemoval", 2.0 * complexBytes + 2.0 * sizeof(T), &P::rollingAverageDCRemoval));
+	results.push_back(benchmarkKLinearization());
+	results.push_back(benchmarkInPlaceStage("dispersionCompensation", 2.0 * complexBytes + complexBytes, &P::dispersionCompensation));
+	results.push_back(benchmarkInPlaceStage("applyWindow", 2.0 * complexBytes + sizeof(T), &P::applyWindow));
+	std::vector<Spectrum> ifftOutput;
+	results.push_back(benchmarkIFFT(ifftOutput));
+	results.push_back(benchmarkLogScale(ifftOutput));
+	return results;
+}
+
+std::vector<float> ProcessorStageBenchmark::processedAscans()
+{
+	std::vector<AScan> processed;
+	OCTSignalProcessing::Processor<T>::ProcessingOptions options;
+	options.logScale = false;
+	processor_->setProcessingOptions(options);
+	processor_->processPreparedSpectra(spectra_, processed);
+	processor_->setProcessingOptions(OCTSignalProcessing::Processor<T>::ProcessingOptions());
+
+	std::vector<float> ascans;
+	ascans.reserve(numberOfAscans_ * (samplesPerLine_ / 2));
+	for (const AScan &ascan : processed) {
+		ascans.insert(ascans.end(), ascan.begin(), ascan.end());
+	}
+	return ascans;
+}
+
+BenchmarkResult ProcessorStageBenchmark::benchmarkConversion(int bitDepth)
+{
+	std::vector<uint8_t> raw = syntheticRawData(bitDepth);
+	Spectrum converted;
+	double duration = medianPassDurationNs([]() {}, [&]() {
+		processor_->convertInputData(raw.data(), totalSamples(), bitDepth, converted);
+	}, minimumTimeNs_);
+
+	double bytesPerSample = static_cast<double>(raw.size()) / static_cast<double>(totalSamples()) + 2.0 * sizeof(T);
+	return makeBenchmarkResult("convertInputData", samplesPerLine_, bitDepth, numberOfAscans_, duration, totalSamples(), bytesPerSample);
+}
+
+BenchmarkResult ProcessorStageBenchmark::benchmarkInPlaceStage(const std::string &stage, double bytesPerSample, void (OCTSignalProcessing::Processor<T>::*step)(Spectrum&))
+{
+	std::vector<Spectrum> work = spectra_;
+	double duration = medianPassDurationNs([&]() {
+		for (size_t i = 0; i < numberOfAscans_; ++i) {
+			std::memcpy(work[i].data(), spectra_[i].data(), samplesPerLine_ * sizeof(std::complex<T>));
+		}
+	}, [&]() {
+		for (Spectrum &spectrum : work) {
+			((*processor_).*step)(spectrum);
+		}
+	}, minimumTimeNs_);
+	return makeBenchmarkResult(stage, samplesPerLine_, 0, numberOfAscans_, duration, totalSamples(), bytesPerSample);
+}
+
+BenchmarkResult ProcessorStageBenchmark::benchmarkKLinearization()
+{
+	std::vector<Spectrum> output(numberOfAscans_);
+	double duration = medianPassDurationNs([]() {}, [&]() {
+		for (size_t i = 0; i < numberOfAscans_; ++i) {
+			processor_->klinearizationCubic(spectra_[i], processor_->resamplePositions_, output[i]);
+		}
+	}, minimumTimeNs_);
+	double bytesPerSample = 2.0 * 2.0 * sizeof(T) + sizeof(T);
+	return makeBenchmarkResult("klinearizationCubic", samplesPerLine_, 0, numberOfAscans_, duration, totalSamples(), bytesPerSample);
+}
+
+BenchmarkResult ProcessorStageBenchmark::benchmarkIFFT(std::vector<Spectrum> &ifftOutput)
+{
+	ifftOutput.assign(numberOfAscans_, Spectrum());
+	double duration = medianPassDurationNs([]() {}, [&]() {
+		for (size_t i = 0; i < numberOfAscans_; ++i) {
+			processor_->computeIFFT(spectra_[i], ifftOutput[i]);
+		}
+	}, minimumTimeNs_);
+	double bytesPerSample = 2.0 * 2.0 * sizeof(T);
+	return makeBenchmarkResult("computeIFFT", samplesPerLine_, 0, numberOfAscans_, duration, totalSamples(), bytesPerSample);
+}
+
+BenchmarkResult ProcessorStageBenchmark::benchmarkLogScale(const std::vector<Spectrum> &ifftOutput)
+{
+	std::vector<AScan> output(numberOfAscans_);
+	double duration = medianPassDurationNs([]() {}, [&]() {
+		for (size_t i = 0; i < numberOfAscans_; ++i) {
+			processor_->logScale(ifftOutput[i], output[i]);
+		}
+	}, minimumTimeNs_);
+	double bytesPerSample = 2.0 * sizeof(T) + sizeof(T);
+	return makeBenchmarkResult("logScale", samplesPerLine_, 0, numberOfAscans_, duration, totalSamples(), bytesPerSample);
+}
+
+size_t ProcessorStageBenchmark::totalSamples() const
+{
+	return samplesPerLine_ * numberOfAscans_;
+}
+
+std::vector<uint8_t> ProcessorStageBenchmark::syntheticRawData(int bitDepth) const
+{
+	OCTSignalProcessing::FringeGenerator::Parameters parameters;
+	parameters.samplesPerSpectrum = samplesPerLine_;
+	parameters.spectraPerFrame = numberOfAscans_;
+	parameters.bitDepth = bitDepth;
+	parameters.reflectors = {{0.1 * samplesPerLine_, 1.0}, {0.2 * samplesPerLine_, 0.4}, {0.3 * samplesPerLine_, 0.2}};
+	double lastIndex = static_cast<double>(samplesPerLine_ - 1);
+	parameters.resamplingCoefficients = {0.0, lastIndex, RESAMPLING_C2 * lastIndex, RESAMPLING_C3 * lastIndex};
+	parameters.dispersionCoefficients = {0.0, 0.0, 20.0, -5.0};
+	return OCTSignalProcessing::FringeGenerator(parameters).generate();
+}
@@ -0,0 +1,45 @@
+#ifndef PROCESSORSTAGEBENCHMARK_H
+#define PROCESSORSTAGEBENCHMARK_H
+
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "processor.h"
+#include "benchmarktimer.h"
+
+// Times every processing step of OCTSignalProcessing::Processor separately on synthetic spectra.
+// Each step runs on all A-scans per pass, steps that work in place get fresh input before every pass.
+class ProcessorStageBenchmark
+{
+public:
+	ProcessorStageBenchmark(size_t samplesPerLine, size_t numberOfAscans, double minimumTimeMs);
+
+	// convertInputData is timed for every bit depth, the other steps once
+	std::vector<BenchmarkResult> run(const std::vector<int> &bitDepths);
+
+	// Linear A-scans (first half, as used by the metric calculator) of all synthetic spectra
+	std::vector<float> processedAscans();
+
+private:
+	typedef float T;
+	typedef OCTSignalProcessing::Processor<T>::ComplexBuffer Spectrum;
+	typedef OCTSignalProcessing::Processor<T>::RealBuffer AScan;
+
+	size_t samplesPerLine_;
+	size_t numberOfAscans_;
+	double minimumTimeNs_;
+	std::unique_ptr<OCTSignalProcessing::Processor<T>> processor_;
+	std::vector<Spectrum> spectra_;
+
+	BenchmarkResult benchmarkConversion(int bitDepth);
+	BenchmarkResult benchmarkInPlaceStage(const std::string &stage, double bytesPerSample, void (OCTSignalProcessing::Processor<T>::*step)(Spectrum&));
+	BenchmarkResult benchmarkKLinearization();
+	BenchmarkResult benchmarkIFFT(std::vector<Spectrum> &ifftOutput);
+	BenchmarkResult benchmarkLogScale(const std::vector<Spectrum> &ifftOutput);
+
+	size_t totalSamples() const;
+	std::vector<uint8_t> syntheticRawData(int bitDepth) const;
+};
+
+#endif // PROCESSORSTAGEBENCHMARK_H
@@ -0,0 +1,101 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include "processorverification.h"
+
+// Compares every processing step and the whole processing of OCTSignalProcessing::Processor with a frozen
+// scalar reference implementation, see processorverification.h for the compared outputs and tolerances.
+// Run it before merging changes to processor.tpp, the exit code is 1 if any comparison exceeds its tolerance.
+
+namespace {
+
+bool parseList(const QString &text, std::vector<int> &values) {
+	values.clear();
+	for (const QString &item : text.split(',', QString::SkipEmptyParts)) {
+		bool ok = false;
+		int value = item.trimmed().toInt(&ok);
+		if (!ok || value <= 0) {
+			return false;
+		}
+		values.push_back(value);
+	}
+	return !values.empty();
+}
+
+QJsonObject toJson(const VerificationResult &result) {
+	QJsonObject json;
+	json["check"] = QString::fromStdString(result.check);
+	json["precision"] = QString::fromStdString(result.precision);
+	json["samples_per_line"] = static_cast<int>(result.samplesPerLine);
+	json["bit_depth"] = result.bitDepth;
+	json["error"] = result.error;
+	json["tolerance"] = result.tolerance;
+	json["passed"] = result.passed;
+	return json;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	QCoreApplication app(argc, argv);
+	QCoreApplication::setApplicationName("processorverification");
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Compares the processor with a frozen reference implementation.");
+	parser.addHelpOption();
+	parser.addOptions({
+		{"line-lengths", "Samples per raw A-scan.", "list", "512,1024,2048,4096,8192"},
+		{"bit-depths", "Bit depths of the synthetic raw data.", "list", "8,12,16,32"},
+		{"ascans", "Number of A-scans per frame.", "count", "16"},
+		{"output", "Write results to this JSON file.", "file"},
+		{"failures-only", "Print failed comparisons only."}
+	});
+	parser.process(app);
+
+	QTextStream out(stdout);
+	QTextStream err(stderr);
+	std::vector<int> lineLengths;
+	std::vector<int> bitDepths;
+	bool ascansOk = false;
+	int ascans = parser.value("ascans").toInt(&ascansOk);
+	if (!parseList(parser.value("line-lengths"), lineLengths) || !parseList(parser.value("bit-depths"), bitDepths) || !ascansOk || ascans <= 0) {
+		err << "Invalid command line option.\n";
+		parser.showHelp(2);
+	}
+
+	QJsonArray results;
+	int failures = 0;
+	out << QString("%1 %2 %3 %4 %5 %6\n").arg("check", -48).arg("type", 7).arg("length", 7).arg("bits", 5).arg("error", 11).arg("tolerance", 11);
+	for (int lineLength : lineLengths) {
+		ProcessorVerification verification(static_cast<size_t>(lineLength), static_cast<size_t>(ascans));
+		for (const VerificationResult &result : verification.run(bitDepths)) {
+			failures += result.passed ? 0 : 1;
+			results.append(toJson(result));
+			if (result.passed && parser.isSet("failures-only")) {
+				continue;
+			}
+			out << QString("%1 %2 %3 %4 %5 %6%7\n").arg(QString::fromStdString(result.check), -48).arg(QString::fromStdString(result.precision), 7)
+			       .arg(result.samplesPerLine, 7).arg(result.bitDepth, 5).arg(result.error, 11, 'e', 3).arg(result.tolerance, 11, 'e', 1)
+			       .arg(result.passed ? "" : "  FAILED");
+		}
+		out.flush();
+	}
+	out << failures << " of " << results.size() << " comparison(s) failed.\n";
+
+	if (parser.isSet("output")) {
+		QJsonObject json;
+		json["ascans"] = ascans;
+		json["results"] = results;
+		QFile outputFile(parser.value("output"));
+		if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+			err << "Could not write results: " << outputFile.fileName() << "\n";
+			return 2;
+		}
+		outputFile.write(QJsonDocument(json).toJson(QJsonDocument::Indented));
+	}
+	return failures > 0 ? 1 : 0;
+}
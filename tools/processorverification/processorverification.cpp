@@ -0,0 +1,402 @@
+#include "processorverification.h"
+#include <QVector>
+#include <algorithm>
+#include <cmath>
+#include "fringegenerator.h"
+#include "ascanmetriccalculator.h"
+
+// Same window size as the OCTproZ default
+#define VERIFICATION_DC_WINDOW_SIZE 64
+
+// Fixed log scaling range that covers noise floor and peaks of the synthetic fringes
+#define VERIFICATION_LOG_MIN -40.0
+#define VERIFICATION_LOG_MAX 20.0
+
+// Grid of the best d2/d3 comparison
+#define VERIFICATION_DISPERSION_RANGE 50.0
+#define VERIFICATION_DISPERSION_STEP 1.0
+
+namespace {
+
+struct Tolerance {
+	double singlePrecision;
+	double doublePrecision;
+
+	double forPrecision(const std::string &precision) const {
+		return precision == "float" ? singlePrecision : doublePrecision;
+	}
+};
+
+const Tolerance conversionTolerance = {0.0, 0.0};
+const Tolerance stepTolerance = {1.0e-5, 1.0e-12};
+const Tolerance klinearizationTolerance = {1.0e-3, 1.0e-9};
+const Tolerance endToEndTolerance = {5.0e-3, 1.0e-8};
+const Tolerance metricTolerance = {1.0e-3, 1.0e-9};
+
+struct OptionCombination {
+	const char *name;
+	bool removeDC;
+	bool resample;
+	bool compensateDispersion;
+	bool applyWindow;
+	bool logScale;
+};
+
+const OptionCombination optionCombinations[] = {
+	{"all", true, true, true, true, true},
+	{"noDCRemoval", false, true, true, true, true},
+	{"noResampling", true, false, true, true, true},
+	{"noDispersionCompensation", true, true, false, true, true},
+	{"noWindow", true, true, true, false, true},
+	{"linear", true, true, true, true, false},
+	{"ifftOnly", false, false, false, false, false}
+};
+
+const struct {
+	const char *name;
+	ASCAN_SHARPNESS_METRIC metric;
+} metrics[] = {
+	{"sumAboveThreshold", SUM_ABOVE_THRESHOLD},
+	{"samplesAboveThreshold", SAMPLES_ABOVE_THRESHOLD},
+	{"peakValue", PEAK_VALUE},
+	{"meanSobel", MEAN_SOBEL},
+	{"sumOfSquaredIntensity", SUM_OF_SQUARED_INTENSITY}
+};
+
+template <typename T>
+double normalizedMaxError(const std::vector<T> &reference, const std::vector<T> &values) {
+	if (values.size() != reference.size()) {
+		return HUGE_VAL;
+	}
+	double maxReference = 0.0;
+	double maxError = 0.0;
+	for (size_t i = 0; i < reference.size(); ++i) {
+		double difference = std::abs(static_cast<double>(reference[i]) - static_cast<double>(values[i]));
+		maxReference = std::max(maxReference, std::abs(static_cast<double>(reference[i])));
+		maxError = std::max(maxError, std::isnan(difference) ? HUGE_VAL : difference);
+	}
+	return maxReference > 0.0 ? maxError / maxReference : maxError;
+}
+
+template <typename T>
+double normalizedMaxError(const std::vector<std::complex<T>> &reference, const std::vector<std::complex<T>> &values) {
+	std::vector<T> referenceParts;
+	std::vector<T> valueParts;
+	for (const std::complex<T> &value : reference) {
+		referenceParts.push_back(value.real());
+		referenceParts.push_back(value.imag());
+	}
+	for (const std::complex<T> &value : values) {
+		valueParts.push_back(value.real());
+		valueParts.push_back(value.imag());
+	}
+	return normalizedMaxError(referenceParts, valueParts);
+}
+
+// Log scaled values below the lower end of the scaling range are displayed black. Their exact value is the log of a
+// deep minimum of the A-scan, which depends on rounding only, so they are compared after clamping to the lower end.
+template <typename T>
+double normalizedMaxError(const std::vector<std::vector<T>> &reference, const std::vector<std::vector<T>> &values, bool isLogScaled) {
+	std::vector<T> referenceFlat;
+	std::vector<T> valuesFlat;
+	for (const std::vector<T> &ascan : reference) {
+		referenceFlat.insert(referenceFlat.end(), ascan.begin(), ascan.end());
+	}
+	for (const std::vector<T> &ascan : values) {
+		valuesFlat.insert(valuesFlat.end(), ascan.begin(), ascan.end());
+	}
+	if (isLogScaled) {
+		for (T &value : referenceFlat) {
+			value = std::max(value, static_cast<T>(0));
+		}
+		for (T &value : valuesFlat) {
+			value = std::max(value, static_cast<T>(0));
+		}
+	}
+	return normalizedMaxError(referenceFlat, valuesFlat);
+}
+
+template <typename AScans>
+QVector<float> flatten(const AScans &ascans) {
+	QVector<float> data;
+	for (const auto &ascan : ascans) {
+		for (auto value : ascan) {
+			data.append(static_cast<float>(value));
+		}
+	}
+	return data;
+}
+
+// The processor buffers use their own allocator, the comparisons work on std::vector like the reference
+template <typename Buffer>
+std::vector<typename Buffer::value_type> toStdVector(const Buffer &buffer) {
+	return std::vector<typename Buffer::value_type>(buffer.begin(), buffer.end());
+}
+
+template <typename Buffer>
+std::vector<std::vector<typename Buffer::value_type>> toStdVectors(const std::vector<Buffer> &buffers) {
+	std::vector<std::vector<typename Buffer::value_type>> vectors;
+	for (const Buffer &buffer : buffers) {
+		vectors.push_back(toStdVector(buffer));
+	}
+	return vectors;
+}
+
+VerificationResult makeResult(const std::string &check, const std::string &precision, size_t samplesPerLine, int bitDepth, double error, double tolerance) {
+	VerificationResult result;
+	result.check = check;
+	result.precision = precision;
+	result.samplesPerLine = samplesPerLine;
+	result.bitDepth = bitDepth;
+	result.error = error;
+	result.tolerance = tolerance;
+	result.passed = error <= tolerance;
+	return result;
+}
+
+}
+
+ProcessorVerification::ProcessorVerification(size_t samplesPerLine, size_t numberOfAscans)
+	: samplesPerLine_(samplesPerLine),
+	numberOfAscans_(numberOfAscans)
+{
+	double lastIndex = static_cast<double>(samplesPerLine_ - 1);
+	resamplingCoefficients_ = {0.0, lastIndex, 0.05 * lastIndex, -0.02 * lastIndex};
+	dispersionCoefficients_ = {0.0, 0.0, 20.0, -5.0};
+}
+
+std::vector<VerificationResult> ProcessorVerification::run(const std::vector<int> &bitDepths)
+{
+	std::vector<VerificationResult> results;
+	verifyPrecision<float>("float", bitDepths, results);
+	verifyPrecision<double>("double", bitDepths, results);
+	return results;
+}
+
+template <typename T>
+void ProcessorVerification::verifyPrecision(const std::string &precision, const std::vector<int> &bitDepths, std::vector<VerificationResult> &results)
+{
+	verifySteps<T>(precision, results);
+	for (int bitDepth : bitDepths) {
+		verifyEndToEnd<T>(precision, bitDepth, results);
+	}
+	verifyBestDispersion<T>(precision, results);
+}
+
+template <typename T>
+void ProcessorVerification::verifySteps(const std::string &precision, std::vector<VerificationResult> &results)
+{
+	typedef std::vector<std::complex<T>> Spectrum;
+	typedef typename OCTSignalProcessing::Processor<T>::ComplexBuffer Buffer;
+	OCTSignalProcessing::Processor<T> processor(samplesPerLine_, 0, 8, VERIFICATION_DC_WINDOW_SIZE);
+	ReferenceProcessor<T> reference(samplesPerLine_, VERIFICATION_DC_WINDOW_SIZE);
+	configure(processor, reference);
+	processor.updateResampleCurveIfNeeded();
+
+	// Every step gets the reference output of the previous step as input
+	std::vector<uint8_t> raw = syntheticRawData(12);
+	size_t bytesPerAscan = samplesPerLine_ * OCTSignalProcessing::FringeGenerator::bytesPerSample(12);
+	double errorDC = 0.0;
+	double errorKLinearization = 0.0;
+	double errorDispersion = 0.0;
+	double errorWindow = 0.0;
+	double errorIFFT = 0.0;
+	double errorLogScale = 0.0;
+	for (size_t ascan = 0; ascan < numberOfAscans_; ++ascan) {
+		Spectrum referenceSpectrum;
+		reference.convert(raw.data() + ascan * bytesPerAscan, samplesPerLine_, 12, referenceSpectrum);
+
+		Buffer spectrum(referenceSpectrum.begin(), referenceSpectrum.end());
+		processor.rollingAverageDCRemoval(spectrum);
+		reference.removeDC(referenceSpectrum);
+		errorDC = std::max(errorDC, normalizedMaxError(referenceSpectrum, toStdVector(spectrum)));
+
+		Spectrum referenceResampled;
+		processor.klinearizationCubic(Buffer(referenceSpectrum.begin(), referenceSpectrum.end()), processor.resamplePositions_, spectrum);
+		reference.klinearize(referenceSpectrum, referenceResampled);
+		errorKLinearization = std::max(errorKLinearization, normalizedMaxError(referenceResampled, toStdVector(spectrum)));
+
+		spectrum.assign(referenceResampled.begin(), referenceResampled.end());
+		processor.dispersionCompensation(spectrum);
+		reference.compensateDispersion(referenceResampled);
+		errorDispersion = std::max(errorDispersion, normalizedMaxError(referenceResampled, toStdVector(spectrum)));
+
+		spectrum.assign(referenceResampled.begin(), referenceResampled.end());
+		processor.applyWindow(spectrum);
+		reference.applyWindow(referenceResampled);
+		errorWindow = std::max(errorWindow, normalizedMaxError(referenceResampled, toStdVector(spectrum)));
+
+		Spectrum referenceAscan;
+		processor.computeIFFT(Buffer(referenceResampled.begin(), referenceResampled.end()), spectrum);
+		reference.ifft(referenceResampled, referenceAscan);
+		errorIFFT = std::max(errorIFFT, normalizedMaxError(referenceAscan, toStdVector(spectrum)));
+
+		typename OCTSignalProcessing::Processor<T>::RealBuffer logScaled;
+		std::vector<T> referenceLogScaled;
+		processor.logScale(Buffer(referenceAscan.begin(), referenceAscan.end()), logScaled);
+		reference.logScale(referenceAscan, referenceLogScaled);
+		errorLogScale = std::max(errorLogScale, normalizedMaxError(std::vector<std::vector<T>>{referenceLogScaled}, std::vector<std::vector<T>>{toStdVector(logScaled)}, true));
+	}
+
+	results.push_back(makeResult("rollingAverageDCRemoval", precision, samplesPerLine_, 0, errorDC, stepTolerance.forPrecision(precision)));
+	results.push_back(makeResult("klinearizationCubic", precision, samplesPerLine_, 0, errorKLinearization, klinearizationTolerance.forPrecision(precision)));
+	results.push_back(makeResult("dispersionCompensation", precision, samplesPerLine_, 0, errorDispersion, stepTolerance.forPrecision(precision)));
+	results.push_back(makeResult("applyWindow", precision, samplesPerLine_, 0, errorWindow, stepTolerance.forPrecision(precision)));
+	results.push_back(makeResult("computeIFFT", precision, samplesPerLine_, 0, errorIFFT, stepTolerance.forPrecision(precision)));
+	results.push_back(makeResult("logScale", precision, samplesPerLine_, 0, errorLogScale, stepTolerance.forPrecision(precision)));
+}
+
+template <typename T>
+void ProcessorVerification::verifyEndToEnd(const std::string &precision, int bitDepth, std::vector<VerificationResult> &results)
+{
+	typedef typename OCTSignalProcessing::Processor<T>::ProcessingOptions ProcessingOptions;
+	typedef typename OCTSignalProcessing::Processor<T>::ComplexBuffer Buffer;
+	typedef typename OCTSignalProcessing::Processor<T>::RealBuffer RealBuffer;
+	OCTSignalProcessing::Processor<T> processor(samplesPerLine_, 0, 8, VERIFICATION_DC_WINDOW_SIZE);
+	ReferenceProcessor<T> reference(samplesPerLine_, VERIFICATION_DC_WINDOW_SIZE);
+	configure(processor, reference);
+	std::vector<uint8_t> raw = syntheticRawData(bitDepth);
+
+	Buffer converted;
+	std::vector<std::complex<T>> referenceConverted;
+	processor.convertInputData(raw.data(), totalSamples(), bitDepth, converted);
+	reference.convert(raw.data(), totalSamples(), bitDepth, referenceConverted);
+	results.push_back(makeResult("convertInputData", precision, samplesPerLine_, bitDepth, normalizedMaxError(referenceConverted, toStdVector(converted)),
+	                             conversionTolerance.forPrecision(precision)));
+
+	for (const OptionCombination &combination : optionCombinations) {
+		ProcessingOptions options;
+		options.removeDC = combination.removeDC;
+		options.resample = combination.resample;
+		options.compensateDispersion = combination.compensateDispersion;
+		options.applyWindow = combination.applyWindow;
+		options.logScale = combination.logScale;
+		processor.setProcessingOptions(options);
+		typename ReferenceProcessor<T>::Options referenceOptions;
+		referenceOptions.removeDC = combination.removeDC;
+		referenceOptions.resample = combination.resample;
+		referenceOptions.compensateDispersion = combination.compensateDispersion;
+		referenceOptions.applyWindow = combination.applyWindow;
+		referenceOptions.logScale = combination.logScale;
+		reference.setOptions(referenceOptions);
+
+		std::vector<std::vector<T>> referenceAscans = reference.process(raw.data(), totalSamples(), bitDepth);
+		std::vector<std::vector<RealBuffer>> processed;
+		processor.processRawData(raw.data(), totalSamples(), bitDepth, numberOfAscans_, processed);
+		results.push_back(makeResult(std::string("processRawData/") + combination.name, precision, samplesPerLine_, bitDepth,
+		                             processed.size() == 1 ? normalizedMaxError(referenceAscans, toStdVectors(processed[0]), combination.logScale) : HUGE_VAL,
+		                             endToEndTolerance.forPrecision(precision)));
+
+		std::vector<Buffer> prepared;
+		std::vector<RealBuffer> preparedAscans;
+		processor.prepareSpectra(raw.data(), totalSamples(), bitDepth, prepared);
+		processor.processPreparedSpectra(prepared, preparedAscans);
+		results.push_back(makeResult(std::string("processPreparedSpectra/") + combination.name, precision, samplesPerLine_, bitDepth,
+		                             normalizedMaxError(referenceAscans, toStdVectors(preparedAscans), combination.logScale), endToEndTolerance.forPrecision(precision)));
+	}
+
+	// Metric of the gradient based estimation
+	processor.setProcessingOptions(ProcessingOptions());
+	reference.setOptions(typename ReferenceProcessor<T>::Options());
+	std::vector<T> gradient;
+	double metric = static_cast<double>(processor.computeIntensityMetricGradient(raw.data(), totalSamples(), bitDepth, 30, {2, 3}, gradient));
+	double referenceMetric = reference.intensityMetric(raw.data(), totalSamples(), bitDepth, 30);
+	results.push_back(makeResult("computeIntensityMetricGradient", precision, samplesPerLine_, bitDepth,
+	                             std::abs(metric - referenceMetric) / referenceMetric, metricTolerance.forPrecision(precision)));
+}
+
+template <typename T>
+void ProcessorVerification::verifyBestDispersion(const std::string &precision, std::vector<VerificationResult> &results)
+{
+	const int bitDepth = 12;
+	const size_t numberOfMetrics = sizeof(metrics) / sizeof(metrics[0]);
+	OCTSignalProcessing::Processor<T> processor(samplesPerLine_, 0, 8, VERIFICATION_DC_WINDOW_SIZE);
+	ReferenceProcessor<T> reference(samplesPerLine_, VERIFICATION_DC_WINDOW_SIZE);
+	configure(processor, reference);
+	std::vector<uint8_t> raw = syntheticRawData(bitDepth);
+
+	std::vector<AscanMetricCalculator> calculators;
+	for (size_t m = 0; m < numberOfMetrics; ++m) {
+		DispersionEstimatorParameters params;
+		params.sharpnessMetric = metrics[m].metric;
+		params.numberOfAscanSamplesToIgnore = 30;
+		params.metricThreshold = 0.7;
+		calculators.push_back(AscanMetricCalculator(params));
+	}
+
+	// Sequential sweep as in the estimation engine: d2 with d3 = 0, then d3 with the best d2 of the reference,
+	// so that both sweeps over d3 evaluate the same candidates
+	int outputSamplesPerLine = static_cast<int>(samplesPerLine_ / 2);
+	int numberOfSteps = static_cast<int>(std::lround(2.0 * VERIFICATION_DISPERSION_RANGE / VERIFICATION_DISPERSION_STEP)) + 1;
+	std::vector<double> bestReferenceD2(numberOfMetrics, 0.0);
+	for (int order = 2; order <= 3; ++order) {
+		for (size_t m = 0; m < numberOfMetrics; ++m) {
+			float bestMetric = -HUGE_VALF;
+			float bestReferenceMetric = -HUGE_VALF;
+			double bestValue = 0.0;
+			double bestReferenceValue = 0.0;
+			for (int step = 0; step < numberOfSteps; ++step) {
+				double value = -VERIFICATION_DISPERSION_RANGE + step * VERIFICATION_DISPERSION_STEP;
+				double d2 = order == 2 ? value : bestReferenceD2[m];
+				double d3 = order == 3 ? value : 0.0;
+				std::vector<T> coefficients = {0, 0, static_cast<T>(d2), static_cast<T>(d3)};
+				processor.setDispersionCoefficients(coefficients);
+				reference.setDispersionCoefficients(coefficients);
+
+				std::vector<std::vector<typename OCTSignalProcessing::Processor<T>::RealBuffer>> processed;
+				processor.processRawData(raw.data(), totalSamples(), bitDepth, numberOfAscans_, processed);
+				float metricValue = calculators[m].calculateMetric(flatten(processed[0]), outputSamplesPerLine);
+				float referenceMetricValue = calculators[m].calculateMetric(flatten(reference.process(raw.data(), totalSamples(), bitDepth)), outputSamplesPerLine);
+				if (metricValue > bestMetric) {
+					bestMetric = metricValue;
+					bestValue = value;
+				}
+				if (referenceMetricValue > bestReferenceMetric) {
+					bestReferenceMetric = referenceMetricValue;
+					bestReferenceValue = value;
+				}
+			}
+			if (order == 2) {
+				bestReferenceD2[m] = bestReferenceValue;
+			}
+			results.push_back(makeResult(std::string(order == 2 ? "bestD2/" : "bestD3/") + metrics[m].name, precision, samplesPerLine_, bitDepth,
+			                             std::abs(bestValue - bestReferenceValue), VERIFICATION_DISPERSION_STEP));
+		}
+	}
+}
+
+template <typename T>
+void ProcessorVerification::configure(OCTSignalProcessing::Processor<T> &processor, ReferenceProcessor<T> &reference) const
+{
+	std::vector<T> resamplingCoefficients(resamplingCoefficients_.begin(), resamplingCoefficients_.end());
+	std::vector<T> dispersionCoefficients(dispersionCoefficients_.begin(), dispersionCoefficients_.end());
+	T logMin = static_cast<T>(VERIFICATION_LOG_MIN);
+	T logMax = static_cast<T>(VERIFICATION_LOG_MAX);
+
+	processor.setProcessingOptions(typename OCTSignalProcessing::Processor<T>::ProcessingOptions());
+	processor.setResamplingCoefficients(resamplingCoefficients);
+	processor.setDispersionCoefficients(dispersionCoefficients);
+	processor.setLogScaleParameters(1, logMin, logMax, 0, false);
+
+	reference.setOptions(typename ReferenceProcessor<T>::Options());
+	reference.setResamplingCoefficients(resamplingCoefficients);
+	reference.setDispersionCoefficients(dispersionCoefficients);
+	reference.setLogScaleParameters(1, logMin, logMax, 0, false);
+}
+
+size_t ProcessorVerification::totalSamples() const
+{
+	return samplesPerLine_ * numberOfAscans_;
+}
+
+std::vector<uint8_t> ProcessorVerification::syntheticRawData(int bitDepth) const
+{
+	OCTSignalProcessing::FringeGenerator::Parameters parameters;
+	parameters.samplesPerSpectrum = samplesPerLine_;
+	parameters.spectraPerFrame = numberOfAscans_;
+	parameters.bitDepth = bitDepth;
+	parameters.reflectors = {{0.1 * samplesPerLine_, 1.0}, {0.2 * samplesPerLine_, 0.4}, {0.3 * samplesPerLine_, 0.2}};
+	parameters.resamplingCoefficients = resamplingCoefficients_;
+	parameters.dispersionCoefficients = dispersionCoefficients_;
+	return OCTSignalProcessing::FringeGenerator(parameters).generate();
+}
@@ -0,0 +1,64 @@
+#ifndef PROCESSORVERIFICATION_H
+#define PROCESSORVERIFICATION_H
+
+#include <complex>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "processor.h"
+#include "referenceprocessor.h"
+
+struct VerificationResult {
+	std::string check;
+	std::string precision; // "float" or "double", the template argument of the processor under test
+	size_t samplesPerLine = 0;
+	int bitDepth = 0; // 0 if the check does not depend on the input bit depth
+	double error = 0.0;
+	double tolerance = 0.0;
+	bool passed = false;
+};
+
+// Compares OCTSignalProcessing::Processor<float> and Processor<double> with the frozen ReferenceProcessor of the same
+// precision on synthetic fringes. The current processor matches the reference exactly, the tolerances are the room
+// that faster implementations get for reordered arithmetic (SIMD, FMA, other FFT plans).
+//
+// Errors are the largest absolute difference divided by the largest absolute reference value of the compared output
+// (complex outputs: real and imaginary parts, log scaled outputs: clamped to the lower end of the scaling range).
+// Single steps get the reference output of the previous step as input. Tolerances:
+//   comparison                  float    double
+//   convertInputData            0        0          conversion to floating point is exact or correctly rounded
+//   single steps                1e-5     1e-12
+//   klinearizationCubic         1e-3     1e-9       resampling positions above 2^12 have a float resolution of 2^-11
+//   processRawData, prepared    5e-3     1e-8       all option combinations, every bit depth
+//   intensity metric            1e-3     1e-9       relative error of the sum of squared intensities
+//   best d2 / best d3           1 grid step         sequential grid search with every A-scan metric, 1 step = 1.0
+class ProcessorVerification
+{
+public:
+	ProcessorVerification(size_t samplesPerLine, size_t numberOfAscans);
+
+	std::vector<VerificationResult> run(const std::vector<int> &bitDepths);
+
+private:
+	size_t samplesPerLine_;
+	size_t numberOfAscans_;
+	std::vector<double> resamplingCoefficients_;
+	std::vector<double> dispersionCoefficients_;
+
+	template <typename T>
+	void verifyPrecision(const std::string &precision, const std::vector<int> &bitDepths, std::vector<VerificationResult> &results);
+	template <typename T>
+	void verifySteps(const std::string &precision, std::vector<VerificationResult> &results);
+	template <typename T>
+	void verifyEndToEnd(const std::string &precision, int bitDepth, std::vector<VerificationResult> &results);
+	template <typename T>
+	void verifyBestDispersion(const std::string &precision, std::vector<VerificationResult> &results);
+
+	template <typename T>
+	void configure(OCTSignalProcessing::Processor<T> &processor, ReferenceProcessor<T> &reference) const;
+
+	size_t totalSamples() const;
+	std::vector<uint8_t> syntheticRawData(int bitDepth) const;
+};
+
+#endif // PROCESSORVERIFICATION_H
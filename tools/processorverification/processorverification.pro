@@ -0,0 +1,20 @@
+QT = core
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = processorverification
+TEMPLATE = app
+
+DEFINES += \
+	QT_DEPRECATED_WARNINGS #emit warnings if depracted Qt features are used
+
+include(../estimationcore.pri)
+
+SOURCES += \
+	main.cpp \
+	processorverification.cpp
+
+HEADERS += \
+	referenceprocessor.h \
+	referenceprocessor.tpp \
+	processorverification.h
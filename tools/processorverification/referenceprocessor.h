@@ -0,0 +1,71 @@
+#ifndef REFERENCEPROCESSOR_H
+#define REFERENCEPROCESSOR_H
+
+#include <complex>
+#include <cstdint>
+#include <vector>
+#include <fftw3.h>
+
+// Frozen copy of the scalar processing path of OCTSignalProcessing::Processor<T>, operation for operation and in the same
+// precision. It is the reference that faster rewrites of processor.tpp (SIMD, batched, fused steps) are compared against,
+// so it must not be changed together with the processor. Behavior that looks odd is kept on purpose, e.g. the mirrored
+// left neighbor in the k-linearization, the float casts in the resampling curve and the resampling curve clamped to N - 3.
+template <typename T>
+class ReferenceProcessor
+{
+public:
+	struct Options {
+		bool removeDC = true;
+		bool resample = true;
+		bool compensateDispersion = true;
+		bool applyWindow = true;
+		bool logScale = true;
+	};
+
+	typedef std::vector<std::complex<T>> Spectrum;
+
+	ReferenceProcessor(size_t samplesPerSpectrum, size_t rollingAverageWindowSize);
+	~ReferenceProcessor();
+
+	void setOptions(const Options &options);
+	void setDispersionCoefficients(const std::vector<T> &coefficients);
+	void setResamplingCoefficients(const std::vector<T> &coefficients);
+	void setLogScaleParameters(T coeff, T minVal, T maxVal, T addend, bool autoComputeMinMax);
+
+	// Single processing steps
+	void convert(const void *inputData, size_t totalSamples, int bitDepth, Spectrum &output) const;
+	void removeDC(Spectrum &spectrum) const;
+	void klinearize(const Spectrum &input, Spectrum &output) const;
+	void compensateDispersion(Spectrum &spectrum) const;
+	void applyWindow(Spectrum &spectrum) const;
+	void ifft(const Spectrum &input, Spectrum &output);
+	void logScale(const Spectrum &input, std::vector<T> &output) const;
+
+	// All enabled steps, returns the first half of every A-scan
+	std::vector<std::vector<T>> process(const void *inputData, size_t totalSamples, int bitDepth);
+
+	// Sum of squared linear intensities over the first half of all A-scans, see Processor::computeIntensityMetricGradient
+	double intensityMetric(const void *inputData, size_t totalSamples, int bitDepth, size_t ignoredSamples);
+
+private:
+	size_t samplesPerSpectrum_;
+	size_t rollingAverageWindowSize_;
+	Options options_;
+	std::vector<T> window_;
+	std::vector<T> resamplingCurve_;
+	std::vector<std::complex<T>> phase_;
+	T logScaleCoeff_;
+	T logScaleMin_;
+	T logScaleMax_;
+	T logScaleAddend_;
+	bool autoComputeLogScaleMinMax_;
+	fftw_plan plan_;
+	fftw_complex *fftIn_;
+	fftw_complex *fftOut_;
+
+	void processSpectrum(Spectrum &spectrum, Spectrum &ascan);
+};
+
+#include "referenceprocessor.tpp"
+
+#endif // REFERENCEPROCESSOR_H
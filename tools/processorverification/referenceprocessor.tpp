@@ -0,0 +1,279 @@
+#ifndef REFERENCEPROCESSOR_TPP
+#define REFERENCEPROCESSOR_TPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include "processor.h"
+
+template <typename T>
+ReferenceProcessor<T>::ReferenceProcessor(size_t samplesPerSpectrum, size_t rollingAverageWindowSize)
+	: samplesPerSpectrum_(samplesPerSpectrum),
+	rollingAverageWindowSize_(rollingAverageWindowSize),
+	logScaleCoeff_(static_cast<T>(1.0)),
+	logScaleMin_(static_cast<T>(0.0)),
+	logScaleMax_(static_cast<T>(0.0)),
+	logScaleAddend_(static_cast<T>(0.0)),
+	autoComputeLogScaleMinMax_(true)
+{
+	{
+		std::lock_guard<std::mutex> plannerLock(OCTSignalProcessing::fftwPlannerMutex());
+		fftIn_ = static_cast<fftw_complex*>(fftw_malloc(sizeof(fftw_complex) * samplesPerSpectrum_));
+		fftOut_ = static_cast<fftw_complex*>(fftw_malloc(sizeof(fftw_complex) * samplesPerSpectrum_));
+		plan_ = fftw_plan_dft_1d(static_cast<int>(samplesPerSpectrum_), fftIn_, fftOut_, FFTW_BACKWARD, FFTW_ESTIMATE);
+	}
+
+	// Hann window
+	const T pi = static_cast<T>(3.14159265358979323846);
+	window_.resize(samplesPerSpectrum_);
+	T factor = static_cast<T>(2.0 * pi / (samplesPerSpectrum_ - 1));
+	for (size_t i = 0; i < samplesPerSpectrum_; ++i) {
+		window_[i] = static_cast<T>(0.5) * (1 - std::cos(factor * i));
+	}
+}
+
+template <typename T>
+ReferenceProcessor<T>::~ReferenceProcessor()
+{
+	std::lock_guard<std::mutex> plannerLock(OCTSignalProcessing::fftwPlannerMutex());
+	fftw_destroy_plan(plan_);
+	fftw_free(fftIn_);
+	fftw_free(fftOut_);
+}
+
+template <typename T>
+void ReferenceProcessor<T>::setOptions(const Options &options)
+{
+	options_ = options;
+}
+
+template <typename T>
+void ReferenceProcessor<T>::setDispersionCoefficients(const std::vector<T> &coefficients)
+{
+	// phase = sum_j d_j * (k/(N-1))^j, Horner scheme on the normalized wavenumber
+	phase_.resize(samplesPerSpectrum_);
+	float denom = static_cast<float>(samplesPerSpectrum_ - 1);
+	for (size_t i = 0; i < samplesPerSpectrum_; ++i) {
+		T k = static_cast<T>(i) / denom;
+		T phaseValue = static_cast<T>(0);
+		for (size_t j = coefficients.size(); j-- > 0;) {
+			phaseValue = phaseValue * k + coefficients[j];
+		}
+		phase_[i] = std::complex<T>(cos(phaseValue), sin(phaseValue));
+	}
+}
+
+template <typename T>
+void ReferenceProcessor<T>::setResamplingCoefficients(const std::vector<T> &coefficients)
+{
+	// r(i) = c0 + c1 * i/(N-1) + c2 * (i/(N-1))^2 + c3 * (i/(N-1))^3, clamped to [0, N-3]
+	size_t size = samplesPerSpectrum_;
+	resamplingCurve_.resize(size);
+	T coeff0 = coefficients[0];
+	T coeff1 = coefficients[1] / ((float)size - 1.0);
+	T coeff2 = coefficients[2] / ((float)(size - 1.0) * (float)(size - 1.0));
+	T coeff3 = coefficients[3] / ((float)(size - 1.0) * (float)(size - 1.0) * (float)(size - 1.0));
+	T minIndex = static_cast<T>(0);
+	T maxIndex = static_cast<T>(size - 3);
+	for (size_t i = 0; i < size; ++i) {
+		T x = static_cast<T>(i);
+		T value = coeff0 + x * (coeff1 + x * (coeff2 + x * coeff3));
+		resamplingCurve_[i] = value < minIndex ? minIndex : (maxIndex < value ? maxIndex : value);
+	}
+}
+
+template <typename T>
+void ReferenceProcessor<T>::setLogScaleParameters(T coeff, T minVal, T maxVal, T addend, bool autoComputeMinMax)
+{
+	logScaleCoeff_ = coeff;
+	logScaleMin_ = minVal;
+	logScaleMax_ = maxVal;
+	logScaleAddend_ = addend;
+	autoComputeLogScaleMinMax_ = autoComputeMinMax;
+}
+
+template <typename T>
+void ReferenceProcessor<T>::convert(const void *inputData, size_t totalSamples, int bitDepth, Spectrum &output) const
+{
+	output.resize(totalSamples);
+	for (size_t i = 0; i < totalSamples; ++i) {
+		T value;
+		if (bitDepth <= 8) {
+			value = static_cast<T>(static_cast<const uint8_t*>(inputData)[i]);
+		} else if (bitDepth <= 16) {
+			value = static_cast<T>(static_cast<const uint16_t*>(inputData)[i]);
+		} else {
+			value = static_cast<T>(static_cast<const uint32_t*>(inputData)[i]);
+		}
+		output[i] = std::complex<T>(value, static_cast<T>(0));
+	}
+}
+
+template <typename T>
+void ReferenceProcessor<T>::removeDC(Spectrum &spectrum) const
+{
+	// Mean over [i - (w - 1), i + w], cut at the spectrum borders, from a cumulative sum
+	size_t numSamples = spectrum.size();
+	std::vector<T> cumulativeSum(numSamples + 1, static_cast<T>(0));
+	for (size_t i = 0; i < numSamples; ++i) {
+		cumulativeSum[i + 1] = cumulativeSum[i] + spectrum[i].real();
+	}
+	for (size_t i = 0; i < numSamples; ++i) {
+		size_t start = i >= rollingAverageWindowSize_ - 1 ? i - (rollingAverageWindowSize_ - 1) : 0;
+		size_t end = std::min(i + rollingAverageWindowSize_, numSamples - 1);
+		T mean = (cumulativeSum[end + 1] - cumulativeSum[start]) / static_cast<T>(end - start + 1);
+		spectrum[i] -= std::complex<T>(mean, static_cast<T>(0));
+	}
+}
+
+template <typename T>
+void ReferenceProcessor<T>::klinearize(const Spectrum &input, Spectrum &output) const
+{
+	// Cubic Hermite (Catmull-Rom) interpolation of the real part
+	int lastInputIndex = static_cast<int>(input.size()) - 1;
+	output.resize(resamplingCurve_.size());
+	for (size_t j = 0; j < resamplingCurve_.size(); ++j) {
+		T position = resamplingCurve_[j];
+		int n1 = static_cast<int>(position);
+		int n0 = std::min(std::abs(n1 - 1), lastInputIndex);
+		int n2 = std::min(n1 + 1, lastInputIndex);
+		int n3 = std::min(n1 + 2, lastInputIndex);
+		n1 = std::min(n1, lastInputIndex);
+		T y0 = input[n0].real();
+		T y1 = input[n1].real();
+		T y2 = input[n2].real();
+		T y3 = input[n3].real();
+		const T a = -y0 + 3.0 * (y1 - y2) + y3;
+		const T b = 2.0 * y0 - 5.0 * y1 + 4.0 * y2 - y3;
+		const T c = -y0 + y2;
+		const T t = position - n1;
+		const T t2 = t * t;
+		output[j] = std::complex<T>(static_cast<T>(0.5) * t * (a * t2 + b * t + c) + y1, static_cast<T>(0));
+	}
+}
+
+template <typename T>
+void ReferenceProcessor<T>::compensateDispersion(Spectrum &spectrum) const
+{
+	// Only the real part of the spectrum is used, as in the processor
+	for (size_t i = 0; i < spectrum.size(); ++i) {
+		T real = spectrum[i].real();
+		spectrum[i] = std::complex<T>(real * phase_[i].real(), real * phase_[i].imag());
+	}
+}
+
+template <typename T>
+void ReferenceProcessor<T>::applyWindow(Spectrum &spectrum) const
+{
+	for (size_t i = 0; i < spectrum.size(); ++i) {
+		spectrum[i] *= window_[i];
+	}
+}
+
+template <typename T>
+void ReferenceProcessor<T>::ifft(const Spectrum &input, Spectrum &output)
+{
+	for (size_t i = 0; i < samplesPerSpectrum_; ++i) {
+		fftIn_[i][0] = input[i].real();
+		fftIn_[i][1] = input[i].imag();
+	}
+	fftw_execute(plan_);
+	output.resize(samplesPerSpectrum_);
+	T normFactor = static_cast<T>(1) / static_cast<T>(samplesPerSpectrum_);
+	for (size_t i = 0; i < samplesPerSpectrum_; ++i) {
+		output[i] = std::complex<T>(fftOut_[i][0], fftOut_[i][1]) * normFactor;
+	}
+}
+
+template <typename T>
+void ReferenceProcessor<T>::logScale(const Spectrum &input, std::vector<T> &output) const
+{
+	size_t size = input.size();
+	output.resize(size);
+	for (size_t i = 0; i < size; ++i) {
+		T magnitudeSquared = input[i].real() * input[i].real() + input[i].imag() * input[i].imag();
+		output[i] = static_cast<T>(10.0) * std::log10(magnitudeSquared / static_cast<T>(size));
+	}
+	T minVal = logScaleMin_;
+	T maxVal = logScaleMax_;
+	if (autoComputeLogScaleMinMax_) {
+		minVal = *std::min_element(output.begin(), output.end());
+		maxVal = *std::max_element(output.begin(), output.end());
+	}
+	T range = maxVal - minVal;
+	for (size_t i = 0; i < size; ++i) {
+		output[i] = logScaleCoeff_ * ((output[i] - minVal) / range + logScaleAddend_);
+	}
+}
+
+template <typename T>
+std::vector<std::vector<T>> ReferenceProcessor<T>::process(const void *inputData, size_t totalSamples, int bitDepth)
+{
+	Spectrum converted;
+	convert(inputData, totalSamples, bitDepth, converted);
+
+	size_t numSpectra = totalSamples / samplesPerSpectrum_;
+	std::vector<std::vector<T>> ascans(numSpectra);
+	Spectrum spectrum;
+	Spectrum ascan;
+	for (size_t s = 0; s < numSpectra; ++s) {
+		spectrum.assign(converted.begin() + s * samplesPerSpectrum_, converted.begin() + (s + 1) * samplesPerSpectrum_);
+		processSpectrum(spectrum, ascan);
+		std::vector<T> &output = ascans[s];
+		if (options_.logScale) {
+			logScale(ascan, output);
+		} else {
+			output.resize(ascan.size());
+			for (size_t i = 0; i < ascan.size(); ++i) {
+				output[i] = std::abs(ascan[i]);
+			}
+		}
+		output.resize(samplesPerSpectrum_ / 2);
+	}
+	return ascans;
+}
+
+template <typename T>
+double ReferenceProcessor<T>::intensityMetric(const void *inputData, size_t totalSamples, int bitDepth, size_t ignoredSamples)
+{
+	Spectrum converted;
+	convert(inputData, totalSamples, bitDepth, converted);
+
+	size_t numSpectra = totalSamples / samplesPerSpectrum_;
+	size_t halfSize = samplesPerSpectrum_ / 2;
+	double metric = 0.0;
+	Spectrum spectrum;
+	Spectrum ascan;
+	for (size_t s = 0; s < numSpectra; ++s) {
+		spectrum.assign(converted.begin() + s * samplesPerSpectrum_, converted.begin() + (s + 1) * samplesPerSpectrum_);
+		processSpectrum(spectrum, ascan);
+		for (size_t i = std::min(ignoredSamples, halfSize); i < halfSize; ++i) {
+			double intensity = static_cast<double>(std::norm(ascan[i]));
+			metric += intensity * intensity;
+		}
+	}
+	return metric;
+}
+
+template <typename T>
+void ReferenceProcessor<T>::processSpectrum(Spectrum &spectrum, Spectrum &ascan)
+{
+	if (options_.removeDC) {
+		removeDC(spectrum);
+	}
+	if (options_.resample) {
+		Spectrum resampled;
+		klinearize(spectrum, resampled);
+		spectrum.swap(resampled);
+	}
+	if (options_.compensateDispersion) {
+		compensateDispersion(spectrum);
+	}
+	if (options_.applyWindow) {
+		applyWindow(spectrum);
+	}
+	ifft(spectrum, ascan);
+}
+
+#endif // REFERENCEPROCESSOR_TPP